@@ -0,0 +1,57 @@
+#!/bin/sh
+# Run the GtkVlcPlayer benchmark headless.
+# Usage: bench.sh <benchmark-program> [<benchmark-options>]
+#
+# The benchmark media is generated with FFmpeg unless $BENCH_MEDIA points
+# to an existing file. If there is no $DISPLAY, the benchmark is run under
+# Xvfb. Results (JSON lines) are written to stdout.
+# Exit code 77 means the benchmark was skipped.
+
+BENCHMARK=$1
+shift
+
+if [ -z "$BENCH_MEDIA" ]; then
+	BENCH_MEDIA=bench-media.mp4
+
+	if [ ! -f "$BENCH_MEDIA" ]; then
+		if ! command -v ffmpeg >/dev/null; then
+			echo "FFmpeg not found, set BENCH_MEDIA to run the benchmark" >&2
+			exit 77
+		fi
+
+		# 20 s of 720p30 H.264 with a keyframe every second, and AAC audio
+		ffmpeg -loglevel error -y \
+		       -f lavfi -i testsrc=size=1280x720:rate=30:duration=20 \
+		       -f lavfi -i sine=frequency=440:duration=20 \
+		       -c:v libx264 -pix_fmt yuv420p -g 30 -c:a aac \
+		       "$BENCH_MEDIA" || exit 1
+	fi
+fi
+
+# Seek accuracy is measured on long-GOP H.264 (a keyframe every 10 s),
+# unless $BENCH_LONG_GOP_MEDIA points to an existing file
+if [ -z "$BENCH_LONG_GOP_MEDIA" ] && command -v ffmpeg >/dev/null; then
+	BENCH_LONG_GOP_MEDIA=bench-media-long-gop.mp4
+
+	if [ ! -f "$BENCH_LONG_GOP_MEDIA" ]; then
+		ffmpeg -loglevel error -y \
+		       -f lavfi -i testsrc=size=1280x720:rate=30:duration=60 \
+		       -c:v libx264 -pix_fmt yuv420p -g 300 -keyint_min 300 \
+		       -sc_threshold 0 -bf 2 \
+		       "$BENCH_LONG_GOP_MEDIA" || exit 1
+	fi
+fi
+if [ -n "$BENCH_LONG_GOP_MEDIA" ]; then
+	set -- --long-gop-media="$BENCH_LONG_GOP_MEDIA" "$@"
+fi
+
+if [ -z "$DISPLAY" ]; then
+	if ! command -v xvfb-run >/dev/null; then
+		echo "No display and xvfb-run not found, skipping benchmark" >&2
+		exit 77
+	fi
+	exec xvfb-run -a -s "-screen 0 1280x1024x24" \
+	     "$BENCHMARK" "$@" "$BENCH_MEDIA"
+fi
+
+exec "$BENCHMARK" "$@" "$BENCH_MEDIA"
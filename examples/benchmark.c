@@ -0,0 +1,1782 @@
+/*
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Headless benchmark of the GtkVlcPlayer widget, run by "make bench".
+ * Results are printed to stdout as one JSON object per line, e.g.
+ * {"benchmark": "load", "unit": "us", "samples": 20, "min": ..., ...}
+ * Diagnostics are printed to stderr.
+ * Some results are also checked for correctness. The benchmark exits
+ * unsuccessfully if any check failed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gprintf.h>
+#include <glib/gstdio.h>
+
+#include <gdk/gdk.h>
+#include <gtk/gtk.h>
+
+#include <vlc/vlc.h>
+#include <vlc/libvlc_version.h>
+
+#include <gtk-vlc-player.h>
+#include <gtk-vlc-player-group.h>
+#include <gtk-vlc-thumbnailer.h>
+/* for benchmarking the colour conversion and audio level kernels */
+#include <gtk-vlc-player-private.h>
+
+/* widths of rows checked per conversion kernel, beyond two AVX2 vectors */
+#define CONVERT_CHECK_WIDTH	100
+/* random rows per width checked per conversion kernel */
+#define CONVERT_CHECK_RANDOM	16
+/* frames of audio blocks checked per level kernel (odd counts only) */
+#define LEVELS_CHECK_FRAMES	65
+/* relative error of sums of squares, accumulated in a different order */
+#define LEVELS_CHECK_EPSILON	1e-4
+
+/* all timeouts in milliseconds */
+#define WAIT_TIMEOUT	10000
+#define TICK_INTERVAL	10
+
+/* every toggle is measured by the player for one second */
+#define FULLSCREEN_TOGGLES	10
+#define FULLSCREEN_PERIOD	1100	/* milliseconds */
+
+/* players constructed per sample of the idle construction benchmark */
+#define IDLE_PLAYERS	32
+
+/* players shown per sample of the instance pool benchmark */
+#define POOLED_PLAYERS	8
+
+/* playback before the end of the first playlist item */
+#define PLAYLIST_TAIL	1000	/* milliseconds */
+
+/* playback per preset during which CPU use is measured */
+#define PRESET_CPU_PERIOD	2000	/* milliseconds */
+
+/* loopback live stream: UDP port and measured period per mode */
+#define LIVE_PORT	5004
+#define LIVE_PERIOD	8000	/* milliseconds */
+#define LIVE_SAMPLE_INTERVAL	500	/* milliseconds */
+
+/* width of snapshots (the height preserves the aspect ratio) */
+#define SNAPSHOT_WIDTH	320
+
+/* thumbnail batches: requests (of the same file) times positions */
+#define THUMBNAIL_REQUESTS	8
+#define THUMBNAIL_TIMES		4
+#define THUMBNAIL_BATCHES	5
+
+/* segments exported concurrently while playing */
+#define EXPORT_JOBS	4
+
+#define GROUP_SIZE	4
+#define GROUP_DURATION	10	/* seconds */
+
+static gint iterations = 20;
+static gchar *long_gop_file = NULL;
+
+static guint failed_checks = 0;
+
+static GOptionEntry option_entries[] = {
+	{"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+	 "Number of samples per benchmark (default: 20)", "N"},
+	{"long-gop-media", 0, 0, G_OPTION_ARG_FILENAME, &long_gop_file,
+	 "Long-GOP H.264 media for measuring seek accuracy "
+	 "(default: <media-file>)", "FILE"},
+	{NULL}
+};
+
+/*
+ * Samples and results
+ */
+typedef struct {
+	const gchar	*name;
+	const gchar	*unit;
+	GArray		*values;	/* of gdouble */
+} Samples;
+
+static void
+samples_init(Samples *samples, const gchar *name, const gchar *unit)
+{
+	samples->name = name;
+	samples->unit = unit;
+	samples->values = g_array_new(FALSE, FALSE, sizeof(gdouble));
+}
+
+static inline void
+samples_add(Samples *samples, gdouble value)
+{
+	g_array_append_val(samples->values, value);
+}
+
+static gint
+compare_doubles(gconstpointer a, gconstpointer b)
+{
+	gdouble x = *(const gdouble *)a, y = *(const gdouble *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void
+samples_report(Samples *samples)
+{
+	GArray *values = samples->values;
+	gdouble sum = 0.;
+
+	if (values->len == 0) {
+		g_fprintf(stderr, "No samples for \"%s\"\n", samples->name);
+		g_array_free(values, TRUE);
+		return;
+	}
+
+	g_array_sort(values, compare_doubles);
+	for (guint i = 0; i < values->len; i++)
+		sum += g_array_index(values, gdouble, i);
+
+	g_printf("{\"benchmark\": \"%s\", \"unit\": \"%s\", \"samples\": %u, "
+		 "\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"max\": %.3f}\n",
+		 samples->name, samples->unit, values->len,
+		 g_array_index(values, gdouble, 0),
+		 g_array_index(values, gdouble, values->len/2),
+		 sum/values->len,
+		 g_array_index(values, gdouble, values->len - 1));
+
+	g_array_free(values, TRUE);
+}
+
+/*
+ * Checks, reported on stderr
+ */
+static gboolean
+check(gboolean condition, const gchar *format, ...)
+{
+	va_list ap;
+
+	if (condition)
+		return TRUE;
+
+	g_fprintf(stderr, "Check failed: ");
+	va_start(ap, format);
+	g_vfprintf(stderr, format, ap);
+	va_end(ap);
+	g_fprintf(stderr, "\n");
+	failed_checks++;
+
+	return FALSE;
+}
+
+/*
+ * Main loop helpers
+ */
+static gboolean
+tick_cb(gpointer data)
+{
+	/* only makes sure the main loop wakes up regularly */
+	return TRUE;
+}
+
+/*
+ * Iterates the main loop (without holding the Gdk lock) until cond()
+ * returns TRUE. Returns FALSE on timeout.
+ */
+static gboolean
+wait_for(gboolean (*cond)(GtkVlcPlayer *player), GtkVlcPlayer *player)
+{
+	gint64 deadline = g_get_monotonic_time() + WAIT_TIMEOUT*1000;
+
+	while (!cond(player)) {
+		if (g_get_monotonic_time() > deadline) {
+			g_fprintf(stderr, "Timeout while waiting for player\n");
+			return FALSE;
+		}
+
+		gdk_threads_leave();
+		g_main_context_iteration(NULL, TRUE);
+		gdk_threads_enter();
+	}
+
+	return TRUE;
+}
+
+static void
+run_main_loop(guint milliseconds)
+{
+	gint64 deadline = g_get_monotonic_time() + milliseconds*1000;
+
+	while (g_get_monotonic_time() < deadline) {
+		gdk_threads_leave();
+		g_main_context_iteration(NULL, TRUE);
+		gdk_threads_enter();
+	}
+}
+
+/*
+ * Resident set size in KiB (0 if unknown)
+ */
+static gdouble
+get_rss(void)
+{
+	gchar *contents;
+	gulong size, resident = 0;
+
+	if (!g_file_get_contents("/proc/self/statm", &contents, NULL, NULL))
+		return 0.;
+	if (sscanf(contents, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	g_free(contents);
+
+	return (gdouble)resident*sysconf(_SC_PAGESIZE)/1024.;
+}
+
+/*
+ * Player conditions
+ */
+static guint time_changed_count = 0;
+
+static void
+player_on_time_changed(GtkVlcPlayer *player, gint64 new_time, gpointer data)
+{
+	time_changed_count++;
+}
+
+/* frame statistics are cumulative */
+static guint frames_decoded;
+
+static void
+reset_frames(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerFrameStats stats;
+
+	gtk_vlc_player_get_frame_stats(player, &stats);
+	frames_decoded = stats.decoded;
+}
+
+static gboolean
+has_frame(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerFrameStats stats;
+
+	gtk_vlc_player_get_frame_stats(player, &stats);
+	return stats.decoded > frames_decoded;
+}
+
+static guint seeks_completed;
+
+static gboolean
+seek_completed(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerSeekStats stats;
+
+	gtk_vlc_player_get_seek_stats(player, &stats);
+	return stats.completed + stats.timed_out > seeks_completed;
+}
+
+/*
+ * Benchmarks
+ */
+static void
+bench_construct(GtkWidget *window, libvlc_instance_t *inst)
+{
+	Samples samples;
+
+	samples_init(&samples, "construct", "us");
+
+	for (gint i = 0; i < iterations; i++) {
+		gint64 start = g_get_monotonic_time();
+		GtkWidget *player = gtk_vlc_player_new_with_instance(inst);
+
+		gtk_container_add(GTK_CONTAINER(window), player);
+		gtk_widget_show(player);
+		samples_add(&samples, g_get_monotonic_time() - start);
+
+		gtk_widget_destroy(player);
+	}
+
+	samples_report(&samples);
+}
+
+/*
+ * Time to the first and to all of POOLED_PLAYERS realized players and
+ * their memory, with the players sharing one instance from the pool
+ * compared to one libVLC instance per player.
+ * Realizing a player creates its media player, acquiring the pooled
+ * instance.
+ */
+static void
+bench_construct_pooled(const char *const *vlc_argv, gint vlc_argc)
+{
+	static const gchar *const options[] = {
+		"--aout=dummy", "--no-video-title-show", "--quiet", NULL
+	};
+
+	Samples first[2], all[2], memory[2];
+
+	samples_init(&first[0], "pooled_first_widget", "us");
+	samples_init(&all[0], "pooled_players", "us");
+	samples_init(&memory[0], "pooled_memory", "KiB");
+	samples_init(&first[1], "unpooled_first_widget", "us");
+	samples_init(&all[1], "unpooled_players", "us");
+	samples_init(&memory[1], "unpooled_memory", "KiB");
+
+	for (gint i = 0; i < MIN(iterations, 5); i++) {
+		/* k == 0: pooled, k == 1: one instance per player */
+		for (gint k = 0; k < 2; k++) {
+			GtkWidget *window, *box;
+			GtkWidget *players[POOLED_PLAYERS];
+			gdouble rss = get_rss();
+			gint64 start = g_get_monotonic_time();
+
+			window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+			box = gtk_vbox_new(TRUE, 0);
+			gtk_container_add(GTK_CONTAINER(window), box);
+			gtk_widget_show_all(window);
+
+			for (gint j = 0; j < POOLED_PLAYERS; j++) {
+				if (k == 0) {
+					players[j] = gtk_vlc_player_new_with_options(options);
+				} else {
+					libvlc_instance_t *inst;
+
+					inst = libvlc_new(vlc_argc, vlc_argv);
+					players[j] = gtk_vlc_player_new_with_instance(inst);
+					/* the player holds its own reference */
+					libvlc_release(inst);
+				}
+				gtk_box_pack_start(GTK_BOX(box), players[j],
+						   TRUE, TRUE, 0);
+				/* realizes the player in the visible window */
+				gtk_widget_show(players[j]);
+
+				if (j == 0)
+					samples_add(&first[k],
+						    g_get_monotonic_time() - start);
+			}
+			samples_add(&all[k], g_get_monotonic_time() - start);
+			if (rss > 0.)
+				samples_add(&memory[k],
+					    (get_rss() - rss)/POOLED_PLAYERS);
+
+			/* releases the pooled instance with the last player */
+			gtk_widget_destroy(window);
+			run_main_loop(TICK_INTERVAL);
+		}
+	}
+
+	for (gint i = 0; i < 2; i++) {
+		samples_report(&first[i]);
+		samples_report(&all[i]);
+		samples_report(&memory[i]);
+	}
+}
+
+/*
+ * Cost of widgets that are constructed (e.g. by GtkBuilder) but never
+ * shown or given media. They use the pooled libVLC instance.
+ */
+static void
+bench_construct_idle(void)
+{
+	Samples time, memory;
+	GtkWidget *players[IDLE_PLAYERS];
+
+	samples_init(&time, "construct_idle", "us");
+	samples_init(&memory, "construct_idle_memory", "KiB");
+
+	for (gint i = 0; i < iterations; i++) {
+		gdouble rss = get_rss();
+		gint64 start = g_get_monotonic_time();
+
+		for (gint j = 0; j < IDLE_PLAYERS; j++) {
+			players[j] = gtk_vlc_player_new();
+			g_object_ref_sink(players[j]);
+		}
+		samples_add(&time, (gdouble)(g_get_monotonic_time() - start) /
+				   IDLE_PLAYERS);
+		if (rss > 0.)
+			samples_add(&memory, (get_rss() - rss)/IDLE_PLAYERS);
+
+		for (gint j = 0; j < IDLE_PLAYERS; j++) {
+			gtk_widget_destroy(players[j]);
+			g_object_unref(players[j]);
+		}
+	}
+
+	samples_report(&time);
+	samples_report(&memory);
+}
+
+static void
+bench_load(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples samples;
+
+	samples_init(&samples, "load", "us");
+
+	for (gint i = 0; i < iterations; i++) {
+		gint64 start = g_get_monotonic_time();
+
+		if (!gtk_vlc_player_load_filename(player, file)) {
+			g_fprintf(stderr, "Could not load file \"%s\"\n", file);
+			exit(EXIT_FAILURE);
+		}
+		samples_add(&samples, g_get_monotonic_time() - start);
+	}
+
+	samples_report(&samples);
+}
+
+/*
+ * Media loaded from memory must play like the file it was read from
+ */
+static void
+check_load_bytes(GtkVlcPlayer *player, const gchar *file)
+{
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3,0,0,0)
+	gchar *contents;
+	gsize size;
+	gint64 length;
+	GdkPixbuf *pixbuf;
+	gint width = 0, height = 0;
+
+	if (!check(g_file_get_contents(file, &contents, &size, NULL),
+		   "Could not read file \"%s\"", file))
+		return;
+
+	gtk_vlc_player_load_filename(player, file);
+	length = gtk_vlc_player_get_length(player);
+	reset_frames(player);
+	gtk_vlc_player_play(player);
+	if (wait_for(has_frame, player)) {
+		pixbuf = gtk_vlc_player_snapshot(player, 0, 0);
+		if (pixbuf != NULL) {
+			width = gdk_pixbuf_get_width(pixbuf);
+			height = gdk_pixbuf_get_height(pixbuf);
+			g_object_unref(pixbuf);
+		}
+	}
+	gtk_vlc_player_stop(player);
+
+	/* contents are freed when the media is replaced */
+	if (!check(gtk_vlc_player_load_bytes(player, contents, size,
+					     g_free, contents),
+		   "Could not load \"%s\" from memory", file))
+		return;
+	check(gtk_vlc_player_get_length(player) == length,
+	      "Length loaded from memory is %" G_GINT64_FORMAT " ms "
+	      "instead of %" G_GINT64_FORMAT " ms",
+	      gtk_vlc_player_get_length(player), length);
+
+	reset_frames(player);
+	gtk_vlc_player_play(player);
+	if (check(wait_for(has_frame, player),
+		  "No frame decoded from memory")) {
+		pixbuf = gtk_vlc_player_snapshot(player, 0, 0);
+		if (check(pixbuf != NULL, "No snapshot of media in memory")) {
+			check(gdk_pixbuf_get_width(pixbuf) == width &&
+			      gdk_pixbuf_get_height(pixbuf) == height,
+			      "Frame loaded from memory is %dx%d instead of %dx%d",
+			      gdk_pixbuf_get_width(pixbuf),
+			      gdk_pixbuf_get_height(pixbuf), width, height);
+			g_object_unref(pixbuf);
+		}
+	}
+	gtk_vlc_player_stop(player);
+#endif
+}
+
+static void
+bench_first_frame_and_stop(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples first_frame, stop;
+
+	samples_init(&first_frame, "first_frame", "us");
+	samples_init(&stop, "stop", "us");
+
+	for (gint i = 0; i < iterations; i++) {
+		gint64 start;
+
+		gtk_vlc_player_load_filename(player, file);
+		/* drop stale events */
+		run_main_loop(TICK_INTERVAL);
+		reset_frames(player);
+
+		start = g_get_monotonic_time();
+		gtk_vlc_player_play(player);
+		/* first frame delivered to the software renderer */
+		if (wait_for(has_frame, player))
+			samples_add(&first_frame, g_get_monotonic_time() - start);
+
+		start = g_get_monotonic_time();
+		gtk_vlc_player_stop(player);
+		samples_add(&stop, g_get_monotonic_time() - start);
+	}
+
+	samples_report(&first_frame);
+	samples_report(&stop);
+}
+
+/* monotonic time of the latest frame decoded (us) */
+static gint64 last_frame_time;
+static guint last_frame_decoded;
+static gboolean item_changed;
+
+static gboolean
+frame_poll_cb(gpointer data)
+{
+	GtkVlcPlayerFrameStats stats;
+
+	gtk_vlc_player_get_frame_stats(GTK_VLC_PLAYER(data), &stats);
+	if (stats.decoded != last_frame_decoded) {
+		last_frame_decoded = stats.decoded;
+		last_frame_time = g_get_monotonic_time();
+	}
+
+	return TRUE;
+}
+
+static void
+player_on_playlist_item_changed(GtkVlcPlayer *player, gint position,
+				gpointer data)
+{
+	item_changed = TRUE;
+	/* the frames of the new item are counted from here */
+	reset_frames(player);
+}
+
+static gboolean
+has_item_changed(GtkVlcPlayer *player)
+{
+	return item_changed;
+}
+
+/*
+ * Gap between the last frame of a playlist item and the first frame of
+ * the next one, which is pre-rolled by the standby media player.
+ * Frames are polled every millisecond.
+ */
+static void
+bench_playlist_gap(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples gap;
+	gulong handler;
+	guint poll_id;
+
+	samples_init(&gap, "playlist_gap", "us");
+
+	handler = g_signal_connect(player, "playlist-item-changed",
+				   G_CALLBACK(player_on_playlist_item_changed),
+				   NULL);
+	poll_id = gdk_threads_add_timeout(1, frame_poll_cb, player);
+
+	for (gint i = 0; i < MIN(iterations, 5); i++) {
+		gint64 length, before;
+
+		gtk_vlc_player_playlist_clear(player);
+		gtk_vlc_player_playlist_append_filename(player, file);
+		gtk_vlc_player_playlist_append_filename(player, file);
+
+		item_changed = FALSE;
+		reset_frames(player);
+		gtk_vlc_player_playlist_jump(player, 0);
+		if (!wait_for(has_frame, player))
+			break;
+		/* the first item was loaded */
+		item_changed = FALSE;
+
+		length = gtk_vlc_player_get_length(player);
+		if (length > PLAYLIST_TAIL)
+			gtk_vlc_player_seek(player, length - PLAYLIST_TAIL);
+
+		if (!wait_for(has_item_changed, player))
+			break;
+		before = last_frame_time;
+		if (!wait_for(has_frame, player))
+			break;
+		/* polled after the first frame of the next item */
+		frame_poll_cb(player);
+		samples_add(&gap, last_frame_time - before);
+	}
+
+	g_source_remove(poll_id);
+	g_signal_handler_disconnect(player, handler);
+	gtk_vlc_player_stop(player);
+	gtk_vlc_player_playlist_clear(player);
+	samples_report(&gap);
+}
+
+static void
+bench_presets(GtkVlcPlayer *player, const gchar *file)
+{
+	static const struct {
+		GtkVlcPlayerPreset	preset;
+		const gchar		*name;
+	} presets[] = {
+		{GTK_VLC_PLAYER_PRESET_DEFAULT, "default"},
+		{GTK_VLC_PLAYER_PRESET_LOW_LATENCY_LIVE, "low_latency_live"},
+		{GTK_VLC_PLAYER_PRESET_FAST_START, "fast_start"},
+		{GTK_VLC_PLAYER_PRESET_LOW_CPU, "low_cpu"}
+	};
+
+	for (guint p = 0; p < G_N_ELEMENTS(presets); p++) {
+		gchar *first_frame_name, *cpu_name;
+		Samples first_frame, cpu;
+
+		first_frame_name = g_strconcat("first_frame_", presets[p].name, NULL);
+		cpu_name = g_strconcat("cpu_", presets[p].name, NULL);
+		samples_init(&first_frame, first_frame_name, "us");
+		/* process CPU time per wall-clock time, 100 is one core */
+		samples_init(&cpu, cpu_name, "%");
+
+		gtk_vlc_player_set_preset(player, presets[p].preset);
+
+		for (gint i = 0; i < iterations; i++) {
+			gint64 start;
+			clock_t cpu_start;
+
+			gtk_vlc_player_load_filename(player, file);
+			run_main_loop(TICK_INTERVAL);
+			reset_frames(player);
+
+			start = g_get_monotonic_time();
+			gtk_vlc_player_play(player);
+			if (!wait_for(has_frame, player))
+				break;
+			samples_add(&first_frame, g_get_monotonic_time() - start);
+
+			/* CPU use is sampled less often, it takes much longer */
+			if (i < 3) {
+				start = g_get_monotonic_time();
+				cpu_start = clock();
+				run_main_loop(PRESET_CPU_PERIOD);
+				samples_add(&cpu, 100.*(clock() - cpu_start)/CLOCKS_PER_SEC/
+						  ((g_get_monotonic_time() - start)/1e6));
+			}
+
+			gtk_vlc_player_stop(player);
+		}
+		gtk_vlc_player_stop(player);
+
+		samples_report(&first_frame);
+		samples_report(&cpu);
+		g_free(first_frame_name);
+		g_free(cpu_name);
+	}
+
+	gtk_vlc_player_set_preset(player, GTK_VLC_PLAYER_PRESET_DEFAULT);
+}
+
+/*
+ * The file is streamed to the loopback interface by a second libVLC
+ * instance, so sender and receiver start at the same media time.
+ * Latency is approximated as the difference of the sender's and the
+ * receiver's playback times.
+ */
+static void
+bench_live(GtkVlcPlayer *player, const gchar *file)
+{
+	static const gchar *const sender_argv[] = {
+		"--quiet", "--no-video", "--aout=dummy"
+	};
+	libvlc_instance_t *sender_inst;
+	libvlc_media_player_t *sender;
+	gchar *sout, *uri;
+
+	sender_inst = libvlc_new(G_N_ELEMENTS(sender_argv), sender_argv);
+	if (sender_inst == NULL) {
+		g_fprintf(stderr, "Could not create sender libVLC instance\n");
+		return;
+	}
+	sender = libvlc_media_player_new(sender_inst);
+
+	sout = g_strdup_printf(":sout=#std{access=udp,mux=ts,dst=127.0.0.1:%d}",
+			       LIVE_PORT);
+	uri = g_strdup_printf("udp://@127.0.0.1:%d", LIVE_PORT);
+
+	for (gint live = 0; live <= 1; live++) {
+		Samples latency;
+		libvlc_media_t *media;
+
+		samples_init(&latency, live ? "live_latency" : "live_latency_default",
+			     "ms");
+
+		gtk_vlc_player_set_live_mode(player, live);
+		gtk_vlc_player_load_uri(player, uri);
+		reset_frames(player);
+		gtk_vlc_player_play(player);
+
+		media = libvlc_media_new_path(sender_inst, file);
+		libvlc_media_add_option(media, sout);
+		libvlc_media_player_set_media(sender, media);
+		libvlc_media_release(media);
+		libvlc_media_player_play(sender);
+
+		if (wait_for(has_frame, player)) {
+			for (gint t = 0; t < LIVE_PERIOD; t += LIVE_SAMPLE_INTERVAL) {
+				gint64 sent, received;
+
+				run_main_loop(LIVE_SAMPLE_INTERVAL);
+				sent = libvlc_media_player_get_time(sender);
+				received = gtk_vlc_player_get_time(player);
+				if (sent > 0 && received > 0)
+					samples_add(&latency, sent - received);
+			}
+		}
+
+		libvlc_media_player_stop(sender);
+		gtk_vlc_player_stop(player);
+
+		samples_report(&latency);
+		if (live) {
+			GtkVlcPlayerLiveStats stats;
+			Samples stalls;
+
+			gtk_vlc_player_get_live_stats(player, &stats);
+			samples_init(&stalls, "live_stalls", "stalls");
+			samples_add(&stalls, stats.stalls);
+			samples_report(&stalls);
+		}
+	}
+
+	gtk_vlc_player_set_live_mode(player, FALSE);
+
+	g_free(uri);
+	g_free(sout);
+	libvlc_media_player_release(sender);
+	libvlc_release(sender_inst);
+}
+
+static void
+bench_seek(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples samples;
+	gint64 length;
+	GRand *rand = g_rand_new_with_seed(0);
+
+	samples_init(&samples, "seek", "us");
+
+	gtk_vlc_player_load_filename(player, file);
+	reset_frames(player);
+	gtk_vlc_player_play(player);
+	if (!wait_for(has_frame, player))
+		goto cleanup;
+
+	length = MAX(gtk_vlc_player_get_length(player), 4);
+	gtk_vlc_player_reset_seek_stats(player);
+
+	for (gint i = 0; i < iterations; i++) {
+		GtkVlcPlayerSeekStats stats;
+
+		gtk_vlc_player_get_seek_stats(player, &stats);
+		seeks_completed = stats.completed + stats.timed_out;
+
+		/* avoid seeking close to the end */
+		gtk_vlc_player_seek(player,
+				    g_rand_int_range(rand, 0, (gint32)(length*3/4)));
+		if (!wait_for(seek_completed, player))
+			break;
+
+		gtk_vlc_player_get_seek_stats(player, &stats);
+		/* latency as measured by the player's seek scheduler */
+		samples_add(&samples, stats.last_latency);
+	}
+
+cleanup:
+	gtk_vlc_player_stop(player);
+	g_rand_free(rand);
+	samples_report(&samples);
+}
+
+/*
+ * Stepping by one frame with gtk_vlc_player_next_frame() compared to
+ * seeking one frame ahead
+ */
+static void
+bench_step(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples next_frame, step_seek;
+	gint64 frames;
+
+	samples_init(&next_frame, "next_frame", "us");
+	samples_init(&step_seek, "step_seek", "us");
+
+	gtk_vlc_player_load_filename(player, file);
+	reset_frames(player);
+	gtk_vlc_player_play(player);
+	if (!wait_for(has_frame, player))
+		goto cleanup;
+	gtk_vlc_player_pause(player);
+	run_main_loop(100);
+
+	/* every frame's start time must map back to the frame */
+	frames = gtk_vlc_player_time_to_frame(player,
+					      gtk_vlc_player_get_length(player));
+	for (gint64 frame = 0; frame <= frames; frame++) {
+		gint64 time = gtk_vlc_player_frame_to_time(player, frame);
+
+		if (!check(gtk_vlc_player_time_to_frame(player, time) == frame,
+			   "Frame %" G_GINT64_FORMAT " starts at "
+			   "%" G_GINT64_FORMAT " ms, which is frame "
+			   "%" G_GINT64_FORMAT, frame, time,
+			   gtk_vlc_player_time_to_frame(player, time)))
+			break;
+	}
+
+	for (gint i = 0; i < iterations; i++) {
+		gint64 start;
+
+		reset_frames(player);
+		start = g_get_monotonic_time();
+		gtk_vlc_player_next_frame(player);
+		if (!wait_for(has_frame, player))
+			break;
+		samples_add(&next_frame, g_get_monotonic_time() - start);
+	}
+
+	for (gint i = 0; i < iterations; i++) {
+		GtkVlcPlayerSeekStats stats;
+		gint64 frame;
+
+		frame = gtk_vlc_player_time_to_frame(player,
+						     gtk_vlc_player_get_time(player));
+		if (frame < 0)
+			break;
+
+		gtk_vlc_player_get_seek_stats(player, &stats);
+		seeks_completed = stats.completed + stats.timed_out;
+
+		gtk_vlc_player_seek_frame(player, frame + 1);
+		if (!wait_for(seek_completed, player))
+			break;
+
+		gtk_vlc_player_get_seek_stats(player, &stats);
+		samples_add(&step_seek, stats.last_latency);
+	}
+
+cleanup:
+	gtk_vlc_player_stop(player);
+	samples_report(&next_frame);
+	samples_report(&step_seek);
+}
+
+/*
+ * Memory released by suspending a paused player and the latency of
+ * resuming it to the same frame
+ */
+static void
+bench_suspend(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples memory, resume, error;
+
+	samples_init(&memory, "suspend_memory", "KiB");
+	samples_init(&resume, "resume", "us");
+	samples_init(&error, "resume_time_error", "ms");
+
+	gtk_vlc_player_load_filename(player, file);
+	reset_frames(player);
+	gtk_vlc_player_play(player);
+	if (!wait_for(has_frame, player))
+		goto cleanup;
+
+	for (gint i = 0; i < MIN(iterations, 5); i++) {
+		gdouble rss, fps;
+		gint64 time, start, restored;
+
+		gtk_vlc_player_pause(player);
+		run_main_loop(500);
+		time = gtk_vlc_player_get_time(player);
+
+		rss = get_rss();
+		gtk_vlc_player_suspend(player);
+		run_main_loop(500);
+		if (rss > 0.)
+			samples_add(&memory, rss - get_rss());
+
+		reset_frames(player);
+		start = g_get_monotonic_time();
+		gtk_vlc_player_resume(player);
+		if (!wait_for(has_frame, player))
+			break;
+		samples_add(&resume, g_get_monotonic_time() - start);
+
+		/* wait for the restored frame */
+		run_main_loop(500);
+		restored = gtk_vlc_player_get_time(player);
+		samples_add(&error, ABS(restored - time));
+
+		/*
+		 * resuming may land on a neighbouring frame at most,
+		 * frame times being rounded to milliseconds
+		 */
+		fps = gtk_vlc_player_get_frame_rate(player);
+		if (fps > 0.)
+			check(ABS(restored - time) < 1000./fps + 1.,
+			      "Resumed at %" G_GINT64_FORMAT " ms instead of "
+			      "%" G_GINT64_FORMAT " ms", restored, time);
+
+		gtk_vlc_player_play(player);
+		run_main_loop(500);
+	}
+
+	/*
+	 * inserting into the playlist keeps the player suspended,
+	 * jumping in it plays the item on resume
+	 */
+	gtk_vlc_player_suspend(player);
+	check(gtk_vlc_player_playlist_append_filename(player, file) &&
+	      gtk_vlc_player_is_suspended(player),
+	      "Playlist insertion resumed the suspended player");
+	check(gtk_vlc_player_playlist_jump(player, 0) &&
+	      gtk_vlc_player_is_suspended(player) &&
+	      gtk_vlc_player_get_time(player) == 0,
+	      "Playlist jump did not update the suspended player");
+	reset_frames(player);
+	gtk_vlc_player_resume(player);
+	check(wait_for(has_frame, player) &&
+	      gtk_vlc_player_playlist_get_position(player) == 0,
+	      "Playlist item did not play after resuming");
+	gtk_vlc_player_playlist_clear(player);
+
+cleanup:
+	gtk_vlc_player_stop(player);
+	samples_report(&memory);
+	samples_report(&resume);
+	samples_report(&error);
+}
+
+static GtkVlcFrameIndex *reference_index;
+
+static gboolean
+reference_index_complete(GtkVlcPlayer *player)
+{
+	return gtk_vlc_frame_index_is_complete(reference_index);
+}
+
+static gboolean
+frame_index_complete(GtkVlcPlayer *player)
+{
+	GtkVlcFrameIndex *index = gtk_vlc_player_get_frame_index(player);
+
+	return index != NULL && gtk_vlc_frame_index_is_complete(index);
+}
+
+/*
+ * Seeks while paused, without and with frame-accurate seeking.
+ * The error is the distance between the frame landed on and the frame
+ * displayed at the requested time, according to a separately built
+ * frame index.
+ */
+static void
+bench_seek_accuracy(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples build;
+
+	samples_init(&build, "frame_index_build", "us");
+
+	reference_index = gtk_vlc_frame_index_new(file, NULL);
+	if (!wait_for(reference_index_complete, player))
+		goto cleanup;
+
+	for (gint accurate = 0; accurate <= 1; accurate++) {
+		Samples latency, error;
+		GRand *rand = g_rand_new_with_seed(0);
+		gint64 length, start;
+
+		samples_init(&latency, accurate ? "seek_indexed" : "seek_unindexed",
+			     "us");
+		samples_init(&error, accurate ? "seek_error_indexed"
+					      : "seek_error_unindexed", "ms");
+
+		gtk_vlc_player_set_frame_accurate(player, accurate);
+		start = g_get_monotonic_time();
+		gtk_vlc_player_load_filename(player, file);
+		if (accurate) {
+			if (!wait_for(frame_index_complete, player))
+				goto next;
+			samples_add(&build, g_get_monotonic_time() - start);
+		}
+
+		reset_frames(player);
+		gtk_vlc_player_play(player);
+		if (!wait_for(has_frame, player))
+			goto next;
+		gtk_vlc_player_pause(player);
+		run_main_loop(100);
+
+		length = MAX(gtk_vlc_player_get_length(player), 4);
+		gtk_vlc_player_reset_seek_stats(player);
+
+		for (gint i = 0; i < iterations; i++) {
+			GtkVlcPlayerSeekStats stats;
+			gint64 time, expected, landed;
+			gdouble fps;
+
+			time = g_rand_int_range(rand, 0, (gint32)(length*3/4));
+			if (!gtk_vlc_frame_index_lookup(reference_index, time,
+							&expected, NULL))
+				continue;
+
+			gtk_vlc_player_get_seek_stats(player, &stats);
+			seeks_completed = stats.completed + stats.timed_out;
+
+			gtk_vlc_player_seek(player, time);
+			if (!wait_for(seek_completed, player))
+				break;
+			gtk_vlc_player_get_seek_stats(player, &stats);
+			samples_add(&latency, stats.last_latency);
+
+			/* let frame stepping settle */
+			run_main_loop(200);
+			landed = gtk_vlc_player_get_time(player);
+			samples_add(&error, ABS(landed - expected));
+
+			/*
+			 * Indexed seeks must land on the expected frame,
+			 * its time being rounded to milliseconds
+			 */
+			fps = gtk_vlc_player_get_frame_rate(player);
+			if (accurate && fps > 0.)
+				check(ABS(landed - expected) < 500./fps,
+				      "Seek to %" G_GINT64_FORMAT " ms landed at "
+				      "%" G_GINT64_FORMAT " ms instead of "
+				      "%" G_GINT64_FORMAT " ms",
+				      time, landed, expected);
+		}
+
+next:
+		gtk_vlc_player_stop(player);
+		g_rand_free(rand);
+		samples_report(&latency);
+		samples_report(&error);
+	}
+
+cleanup:
+	gtk_vlc_player_set_frame_accurate(player, FALSE);
+	gtk_vlc_frame_index_free(reference_index);
+	samples_report(&build);
+}
+
+static void
+bench_snapshot(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples direct, via_file;
+	libvlc_media_player_t *media_player;
+	GdkPixbuf *full;
+	gint height;
+	gchar *filename;
+	gint fd;
+
+	samples_init(&direct, "snapshot", "us");
+	samples_init(&via_file, "snapshot_file", "us");
+
+	gtk_vlc_player_load_filename(player, file);
+	reset_frames(player);
+	gtk_vlc_player_play(player);
+	if (!wait_for(has_frame, player))
+		goto cleanup;
+	gtk_vlc_player_pause(player);
+	run_main_loop(TICK_INTERVAL);
+
+	/* the height is derived from the video's aspect ratio */
+	full = gtk_vlc_player_snapshot(player, 0, 0);
+	if (!check(full != NULL, "No snapshot of paused video"))
+		goto cleanup;
+	height = MAX(gdk_pixbuf_get_height(full)*SNAPSHOT_WIDTH/
+		     gdk_pixbuf_get_width(full), 1);
+	g_object_unref(full);
+
+	/* straight from the software renderer's frame buffers */
+	for (gint i = 0; i < iterations; i++) {
+		gint64 start = g_get_monotonic_time();
+		GdkPixbuf *pixbuf = gtk_vlc_player_snapshot(player,
+							    SNAPSHOT_WIDTH, 0);
+
+		if (pixbuf == NULL)
+			break;
+		samples_add(&direct, g_get_monotonic_time() - start);
+		check(gdk_pixbuf_get_width(pixbuf) == SNAPSHOT_WIDTH &&
+		      gdk_pixbuf_get_height(pixbuf) == height,
+		      "Snapshot is %dx%d instead of %dx%d",
+		      gdk_pixbuf_get_width(pixbuf),
+		      gdk_pixbuf_get_height(pixbuf), SNAPSHOT_WIDTH, height);
+		g_object_unref(pixbuf);
+	}
+
+	/* libVLC's snapshot, encoded to PNG and read back */
+	fd = g_file_open_tmp("benchmark-XXXXXX.png", &filename, NULL);
+	if (fd < 0)
+		goto cleanup;
+	close(fd);
+	media_player = _gtk_vlc_player_get_media_player(player);
+
+	for (gint i = 0; i < iterations; i++) {
+		gint64 start = g_get_monotonic_time();
+		GdkPixbuf *pixbuf;
+
+		if (libvlc_video_take_snapshot(media_player, 0, filename,
+					       SNAPSHOT_WIDTH, 0))
+			break;
+		pixbuf = gdk_pixbuf_new_from_file(filename, NULL);
+		if (pixbuf == NULL)
+			break;
+		samples_add(&via_file, g_get_monotonic_time() - start);
+		g_object_unref(pixbuf);
+	}
+
+	g_unlink(filename);
+	g_free(filename);
+
+cleanup:
+	gtk_vlc_player_stop(player);
+	samples_report(&direct);
+	samples_report(&via_file);
+}
+
+static gboolean thumbnails_done;
+
+static void
+thumbnailer_on_done(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	thumbnails_done = TRUE;
+}
+
+static gboolean
+has_thumbnails(GtkVlcPlayer *player)
+{
+	return thumbnails_done;
+}
+
+static void
+bench_thumbnailer(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples samples;
+	GtkVlcThumbnailer *thumbnailer;
+	GtkVlcThumbnailRequest requests[THUMBNAIL_REQUESTS];
+	gint64 times[THUMBNAIL_TIMES];
+	gint64 length;
+
+	samples_init(&samples, "thumbnails", "1/s");
+
+	gtk_vlc_player_load_filename(player, file);
+	length = MAX(gtk_vlc_player_get_length(player), 0);
+	for (gint i = 0; i < THUMBNAIL_TIMES; i++)
+		times[i] = length*i/THUMBNAIL_TIMES;
+
+	for (gint i = 0; i < THUMBNAIL_REQUESTS; i++) {
+		requests[i].file = file;
+		requests[i].times = times;
+		requests[i].n_times = THUMBNAIL_TIMES;
+		requests[i].width = SNAPSHOT_WIDTH;
+		requests[i].height = 0;
+	}
+
+	/* one worker per processor */
+	thumbnailer = gtk_vlc_thumbnailer_new(0);
+	if (thumbnailer == NULL)
+		return;
+
+	for (gint i = 0; i < THUMBNAIL_BATCHES; i++) {
+		gint64 start = g_get_monotonic_time();
+
+		thumbnails_done = FALSE;
+		gtk_vlc_thumbnailer_submit_async(thumbnailer, requests,
+						 THUMBNAIL_REQUESTS,
+						 G_PRIORITY_DEFAULT, NULL,
+						 NULL, NULL,
+						 thumbnailer_on_done, NULL);
+		if (!wait_for(has_thumbnails, NULL))
+			break;
+
+		samples_add(&samples, THUMBNAIL_REQUESTS*THUMBNAIL_TIMES*1e6/
+				      (g_get_monotonic_time() - start));
+	}
+
+	gtk_vlc_thumbnailer_free(thumbnailer);
+	/* deliver the result of an aborted batch */
+	run_main_loop(TICK_INTERVAL);
+	samples_report(&samples);
+}
+
+static guint exports_finished;
+
+static void
+player_on_export_finished(GtkVlcPlayer *player, guint job, gboolean success,
+			  gpointer data)
+{
+	check(success, "Export %u failed", job);
+	exports_finished++;
+}
+
+static gboolean
+has_exports(GtkVlcPlayer *player)
+{
+	return exports_finished >= EXPORT_JOBS;
+}
+
+/*
+ * Throughput of segment exports (media time written per wall-clock time)
+ * and frames dropped by playback meanwhile
+ */
+static void
+bench_export(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples throughput, dropped;
+	gchar *filenames[EXPORT_JOBS];
+	gint64 length, segment;
+	gulong handler;
+
+	samples_init(&throughput, "export_throughput", "x");
+	samples_init(&dropped, "export_playback_dropped", "frames");
+
+	for (gint i = 0; i < EXPORT_JOBS; i++) {
+		gchar *name = g_strdup_printf("gtk-vlc-export-%d-%d.ts",
+					      (gint)getpid(), i);
+
+		filenames[i] = g_build_filename(g_get_tmp_dir(), name, NULL);
+		g_free(name);
+	}
+	handler = g_signal_connect(player, "export-finished",
+				   G_CALLBACK(player_on_export_finished), NULL);
+
+	gtk_vlc_player_load_filename(player, file);
+	reset_frames(player);
+	gtk_vlc_player_play(player);
+	if (!wait_for(has_frame, player))
+		goto cleanup;
+	length = gtk_vlc_player_get_length(player);
+	if (length <= 0)
+		goto cleanup;
+	segment = length/EXPORT_JOBS;
+
+	for (gint i = 0; i < MIN(iterations, 3); i++) {
+		GtkVlcPlayerFrameStats stats;
+		guint dropped_before;
+		gint64 start;
+
+		gtk_vlc_player_get_frame_stats(player, &stats);
+		dropped_before = stats.dropped;
+
+		exports_finished = 0;
+		start = g_get_monotonic_time();
+		for (gint j = 0; j < EXPORT_JOBS; j++)
+			gtk_vlc_player_export_segment(player, filenames[j],
+						      j*segment, (j + 1)*segment);
+		if (!wait_for(has_exports, player))
+			break;
+		samples_add(&throughput, EXPORT_JOBS*segment*1000. /
+					 (g_get_monotonic_time() - start));
+
+		for (gint j = 0; j < EXPORT_JOBS; j++) {
+			GStatBuf st;
+
+			check(!g_stat(filenames[j], &st) && st.st_size > 0,
+			      "Exported segment \"%s\" is missing or empty",
+			      filenames[j]);
+		}
+
+		gtk_vlc_player_get_frame_stats(player, &stats);
+		samples_add(&dropped, stats.dropped - dropped_before);
+
+		/* restart playback if the media ended meanwhile */
+		gtk_vlc_player_play(player);
+	}
+
+cleanup:
+	gtk_vlc_player_stop(player);
+	g_signal_handler_disconnect(player, handler);
+	for (gint i = 0; i < EXPORT_JOBS; i++) {
+		g_unlink(filenames[i]);
+		g_free(filenames[i]);
+	}
+	samples_report(&throughput);
+	samples_report(&dropped);
+}
+
+static void
+bench_time_changed(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples emit, rate;
+
+	samples_init(&emit, "time_changed_emit", "us");
+	samples_init(&rate, "time_changed_rate", "1/s");
+
+	/* cost of dispatching one time-changed signal to its handlers */
+	for (gint i = 0; i < iterations; i++) {
+		gint64 start = g_get_monotonic_time();
+
+		for (gint j = 0; j < 1000; j++)
+			g_signal_emit_by_name(player, "time-changed", (gint64)j);
+		samples_add(&emit, (g_get_monotonic_time() - start)/1000.);
+	}
+
+	/* number of time-changed signals during playback */
+	gtk_vlc_player_load_filename(player, file);
+	reset_frames(player);
+	gtk_vlc_player_play(player);
+	if (wait_for(has_frame, player)) {
+		for (gint i = 0; i < 5; i++) {
+			time_changed_count = 0;
+			run_main_loop(1000);
+			samples_add(&rate, time_changed_count);
+		}
+	}
+	gtk_vlc_player_stop(player);
+
+	samples_report(&emit);
+	samples_report(&rate);
+}
+
+static void
+bench_fullscreen(GtkVlcPlayer *player, const gchar *file)
+{
+	Samples latency, dropped;
+
+	samples_init(&latency, "fullscreen_toggle", "us");
+	samples_init(&dropped, "fullscreen_dropped_frames", "frames");
+
+	/* toggles are only measured while collecting statistics */
+	gtk_vlc_player_set_stats_interval(player, FULLSCREEN_PERIOD);
+
+	gtk_vlc_player_load_filename(player, file);
+	reset_frames(player);
+	gtk_vlc_player_play(player);
+	if (wait_for(has_frame, player)) {
+		for (gint i = 0; i < FULLSCREEN_TOGGLES; i++) {
+			GtkVlcPlayerFullscreenStats stats;
+
+			gtk_vlc_player_set_fullscreen(player, i % 2 == 0);
+			run_main_loop(FULLSCREEN_PERIOD);
+
+			gtk_vlc_player_get_fullscreen_stats(player, &stats);
+			samples_add(&latency, stats.last_latency);
+			samples_add(&dropped, stats.last_dropped_frames);
+		}
+	}
+	gtk_vlc_player_set_fullscreen(player, FALSE);
+	gtk_vlc_player_stop(player);
+	gtk_vlc_player_set_stats_interval(player, 0);
+
+	samples_report(&latency);
+	samples_report(&dropped);
+}
+
+static gboolean group_started;
+
+static void
+group_on_started(GtkVlcPlayerGroup *group, gpointer data)
+{
+	group_started = TRUE;
+}
+
+static gboolean
+has_group_started(GtkVlcPlayer *player)
+{
+	return group_started;
+}
+
+/*
+ * Skew between the members of a player group (video wall) over time
+ */
+static void
+bench_group(const gchar *file)
+{
+	Samples start, skew;
+	GtkVlcPlayerGroup *group = gtk_vlc_player_group_new();
+	GtkWidget *window, *table;
+	gint64 started_at;
+
+	samples_init(&start, "group_start", "us");
+	samples_init(&skew, "group_skew", "ms");
+
+	window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	gtk_window_set_default_size(GTK_WINDOW(window), 640, 360);
+	table = gtk_table_new(2, GROUP_SIZE/2, TRUE);
+	gtk_container_add(GTK_CONTAINER(window), table);
+
+	for (gint i = 0; i < GROUP_SIZE; i++) {
+		GtkWidget *player = gtk_vlc_player_group_new_player(group);
+
+		gtk_vlc_player_set_render_mode(GTK_VLC_PLAYER(player),
+					       GTK_VLC_PLAYER_RENDER_SOFTWARE);
+		gtk_vlc_player_load_filename(GTK_VLC_PLAYER(player), file);
+		gtk_table_attach_defaults(GTK_TABLE(table), player,
+					  i % 2, i % 2 + 1, i / 2, i / 2 + 1);
+	}
+	gtk_widget_show_all(window);
+	run_main_loop(TICK_INTERVAL);
+
+	g_signal_connect(group, "started", G_CALLBACK(group_on_started), NULL);
+	group_started = FALSE;
+
+	started_at = g_get_monotonic_time();
+	gtk_vlc_player_group_play(group);
+	if (wait_for(has_group_started, NULL)) {
+		samples_add(&start, g_get_monotonic_time() - started_at);
+
+		/* skew is measured while correcting drift */
+		for (gint i = 0; i < GROUP_DURATION; i++) {
+			run_main_loop(1000);
+			samples_add(&skew, gtk_vlc_player_group_get_skew(group));
+		}
+	}
+
+	gtk_vlc_player_group_stop(group);
+	gtk_widget_destroy(window);
+	g_object_unref(group);
+
+	samples_report(&start);
+	samples_report(&skew);
+}
+
+static void
+bench_convert(void)
+{
+	const GtkVlcConvertKernel *kernels = _gtk_vlc_convert_get_kernels();
+	const guint width = 1920, height = 1080;
+
+	guint8 *y = g_malloc(width*height);
+	guint8 *u = g_malloc(width*height/4);
+	guint8 *v = g_malloc(width*height/4);
+	guint8 *uv = g_malloc(width*height/2);
+	guint8 *dst = g_malloc(width*height*4);
+
+	guint8 *i420_planes[] = {y, u, v};
+	guint i420_pitches[] = {width, width/2, width/2};
+	guint8 *nv12_planes[] = {y, uv};
+	guint nv12_pitches[] = {width, width};
+
+	GRand *rand = g_rand_new_with_seed(0);
+
+	for (guint i = 0; i < width*height; i++)
+		y[i] = g_rand_int(rand);
+	for (guint i = 0; i < width*height/4; i++)
+		u[i] = v[i] = g_rand_int(rand);
+	for (guint i = 0; i < width*height/2; i++)
+		uv[i] = g_rand_int(rand);
+
+	for (guint k = 0; kernels[k].name != NULL; k++) {
+		Samples i420, nv12;
+
+		samples_init(&i420, g_strdup_printf("convert_i420_%s", kernels[k].name),
+			     "Mpixel/s");
+		samples_init(&nv12, g_strdup_printf("convert_nv12_%s", kernels[k].name),
+			     "Mpixel/s");
+
+		for (gint i = 0; i < iterations; i++) {
+			gint64 start;
+
+			start = g_get_monotonic_time();
+			_gtk_vlc_convert_frame(kernels + k, GTK_VLC_CONVERT_I420,
+					       i420_planes, i420_pitches,
+					       width, height, dst, width*4, height);
+			samples_add(&i420, (gdouble)width*height /
+					   MAX(g_get_monotonic_time() - start, 1));
+
+			start = g_get_monotonic_time();
+			_gtk_vlc_convert_frame(kernels + k, GTK_VLC_CONVERT_NV12,
+					       nv12_planes, nv12_pitches,
+					       width, height, dst, width*4, height);
+			samples_add(&nv12, (gdouble)width*height /
+					   MAX(g_get_monotonic_time() - start, 1));
+		}
+
+		samples_report(&i420);
+		samples_report(&nv12);
+		g_free((gchar *)i420.name);
+		g_free((gchar *)nv12.name);
+	}
+
+	g_rand_free(rand);
+	g_free(dst);
+	g_free(uv);
+	g_free(v);
+	g_free(u);
+	g_free(y);
+}
+
+/*
+ * Every conversion kernel must produce the same pixels as the
+ * scalar one, for all widths up to beyond two vectors of the widest
+ * kernel (covering every remainder) and for random as well as
+ * extreme samples (exercising the clamping).
+ */
+static void
+check_convert(void)
+{
+	const GtkVlcConvertKernel *kernels = _gtk_vlc_convert_get_kernels();
+	/* Y, U and V of the extreme patterns */
+	static const guint8 extremes[][3] = {
+		{0, 0, 0}, {0, 0, 255}, {0, 255, 0}, {0, 255, 255},
+		{255, 0, 0}, {255, 0, 255}, {255, 255, 0}, {255, 255, 255},
+		{16, 128, 128}, {235, 16, 240}
+	};
+
+	guint8 y[CONVERT_CHECK_WIDTH], u[CONVERT_CHECK_WIDTH];
+	guint8 v[CONVERT_CHECK_WIDTH], uv[2*CONVERT_CHECK_WIDTH];
+	guint32 expected[CONVERT_CHECK_WIDTH], dst[CONVERT_CHECK_WIDTH];
+	GRand *rand = g_rand_new_with_seed(0);
+
+	/* the first kernel is the scalar one */
+	for (guint k = 1; kernels[k].name != NULL; k++) {
+		for (guint width = 1; width <= CONVERT_CHECK_WIDTH; width++) {
+			/* random rows, then rows of extremes */
+			for (guint pattern = 0;
+			     pattern < CONVERT_CHECK_RANDOM + G_N_ELEMENTS(extremes) + 1;
+			     pattern++) {
+				guint e = pattern - CONVERT_CHECK_RANDOM;
+
+				for (guint x = 0; x < width; x++) {
+					if (pattern < CONVERT_CHECK_RANDOM) {
+						y[x] = g_rand_int(rand);
+						u[x] = g_rand_int(rand);
+						v[x] = g_rand_int(rand);
+					} else if (e < G_N_ELEMENTS(extremes)) {
+						y[x] = extremes[e][0];
+						u[x] = extremes[e][1];
+						v[x] = extremes[e][2];
+					} else {
+						/* random extremes per sample */
+						y[x] = g_rand_boolean(rand) ? 255 : 0;
+						u[x] = g_rand_boolean(rand) ? 255 : 0;
+						v[x] = g_rand_boolean(rand) ? 255 : 0;
+					}
+					uv[2*x] = u[x];
+					uv[2*x + 1] = v[x];
+				}
+
+				kernels[0].i420_row(expected, y, u, v, width);
+				kernels[k].i420_row(dst, y, u, v, width);
+				check(!memcmp(dst, expected, width*sizeof(*dst)),
+				      "I420 kernel \"%s\" differs from \"%s\" "
+				      "(width %u, pattern %u)",
+				      kernels[k].name, kernels[0].name,
+				      width, pattern);
+
+				kernels[0].nv12_row(expected, y, uv, width);
+				kernels[k].nv12_row(dst, y, uv, width);
+				check(!memcmp(dst, expected, width*sizeof(*dst)),
+				      "NV12 kernel \"%s\" differs from \"%s\" "
+				      "(width %u, pattern %u)",
+				      kernels[k].name, kernels[0].name,
+				      width, pattern);
+			}
+		}
+	}
+
+	g_rand_free(rand);
+}
+
+/*
+ * Every audio level kernel must measure the same peaks as the scalar
+ * one and about the same sums of squares, for the channel layouts it
+ * vectorizes and odd numbers of frames (leaving remainders).
+ */
+static void
+check_audio_levels(void)
+{
+	const GtkVlcAudioLevelsKernel *kernels = _gtk_vlc_audio_get_levels_kernels();
+	static const guint channel_counts[] = {1, 2, 4, 8};
+
+	gfloat samples[LEVELS_CHECK_FRAMES*GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS];
+	GRand *rand = g_rand_new_with_seed(0);
+
+	for (guint i = 0; i < G_N_ELEMENTS(samples); i++)
+		samples[i] = (gfloat)g_rand_double_range(rand, -1., 1.);
+
+	/* the first kernel is the scalar one */
+	for (guint k = 1; kernels[k].name != NULL; k++) {
+		for (guint n = 0; n < G_N_ELEMENTS(channel_counts); n++) {
+			guint channels = channel_counts[n];
+
+			for (guint frames = 1; frames <= LEVELS_CHECK_FRAMES;
+			     frames += 2) {
+				gfloat peak[GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS];
+				gfloat expected_peak[GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS];
+				gdouble sum_sq[GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS];
+				gdouble expected_sum_sq[GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS];
+
+				/* levels are accumulated into previous ones */
+				for (guint c = 0; c < channels; c++) {
+					peak[c] = expected_peak[c] = .25;
+					sum_sq[c] = expected_sum_sq[c] = 1.;
+				}
+
+				kernels[0].func(samples, frames, channels,
+						expected_peak, expected_sum_sq);
+				kernels[k].func(samples, frames, channels,
+						peak, sum_sq);
+
+				for (guint c = 0; c < channels; c++)
+					check(peak[c] == expected_peak[c] &&
+					      ABS(sum_sq[c] - expected_sum_sq[c]) <=
+					      LEVELS_CHECK_EPSILON*expected_sum_sq[c],
+					      "Level kernel \"%s\" differs from \"%s\" "
+					      "(%u channels, %u frames, channel %u)",
+					      kernels[k].name, kernels[0].name,
+					      channels, frames, c);
+			}
+		}
+	}
+
+	g_rand_free(rand);
+}
+
+/*
+ * Audio level kernels on one second of 48 kHz stereo audio
+ */
+static void
+bench_audio_levels(void)
+{
+	const GtkVlcAudioLevelsKernel *kernels = _gtk_vlc_audio_get_levels_kernels();
+	const guint frames = 48000, channels = 2;
+
+	gfloat *samples = g_new(gfloat, frames*channels);
+	GRand *rand = g_rand_new_with_seed(0);
+
+	for (guint i = 0; i < frames*channels; i++)
+		samples[i] = (gfloat)g_rand_double_range(rand, -1., 1.);
+
+	for (guint k = 0; kernels[k].name != NULL; k++) {
+		Samples levels;
+
+		samples_init(&levels, g_strdup_printf("audio_levels_%s", kernels[k].name),
+			     "Mframe/s");
+
+		for (gint i = 0; i < iterations; i++) {
+			gfloat peak[2] = {0., 0.};
+			gdouble sum_sq[2] = {0., 0.};
+			gint64 start = g_get_monotonic_time();
+
+			kernels[k].func(samples, frames, channels, peak, sum_sq);
+			samples_add(&levels, (gdouble)frames /
+					     MAX(g_get_monotonic_time() - start, 1));
+		}
+
+		samples_report(&levels);
+		g_free((gchar *)levels.name);
+	}
+
+	g_rand_free(rand);
+	g_free(samples);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const char *const vlc_argv[] = {
+		"--aout=dummy", "--no-video-title-show", "--quiet"
+	};
+
+	GOptionContext *context;
+	GError *error = NULL;
+	GtkWidget *window, *player;
+	libvlc_instance_t *inst;
+	const gchar *file;
+
+	g_thread_init(NULL);
+	gdk_threads_init();
+
+	context = g_option_context_new("<media-file> - benchmark GtkVlcPlayer");
+	g_option_context_add_main_entries(context, option_entries, NULL);
+	g_option_context_add_group(context, gtk_get_option_group(TRUE));
+	if (!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_fprintf(stderr, "%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free(context);
+
+	if (argc != 2) {
+		g_fprintf(stderr, "Usage: benchmark [-n N] <media-file>\n");
+		return EXIT_FAILURE;
+	}
+	file = argv[1];
+
+	gdk_threads_enter();
+
+	check_convert();
+	check_audio_levels();
+	bench_convert();
+	bench_audio_levels();
+
+	inst = libvlc_new(G_N_ELEMENTS(vlc_argv), vlc_argv);
+	if (inst == NULL) {
+		g_fprintf(stderr, "Could not create libVLC instance\n");
+		return EXIT_FAILURE;
+	}
+
+	window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	gtk_window_set_default_size(GTK_WINDOW(window), 640, 360);
+	gtk_widget_show(window);
+
+	bench_construct(window, inst);
+	bench_construct_idle();
+	bench_construct_pooled(vlc_argv, G_N_ELEMENTS(vlc_argv));
+
+	player = gtk_vlc_player_new_with_instance(inst);
+	/* the software renderer does not depend on X video extensions */
+	gtk_vlc_player_set_render_mode(GTK_VLC_PLAYER(player),
+				       GTK_VLC_PLAYER_RENDER_SOFTWARE);
+	g_signal_connect(player, "time-changed",
+			 G_CALLBACK(player_on_time_changed), NULL);
+	gtk_container_add(GTK_CONTAINER(window), player);
+	gtk_widget_show(player);
+	run_main_loop(TICK_INTERVAL);
+
+	g_timeout_add(TICK_INTERVAL, tick_cb, NULL);
+
+	bench_load(GTK_VLC_PLAYER(player), file);
+	check_load_bytes(GTK_VLC_PLAYER(player), file);
+	bench_first_frame_and_stop(GTK_VLC_PLAYER(player), file);
+	bench_playlist_gap(GTK_VLC_PLAYER(player), file);
+	bench_presets(GTK_VLC_PLAYER(player), file);
+	bench_live(GTK_VLC_PLAYER(player), file);
+	bench_seek(GTK_VLC_PLAYER(player), file);
+	bench_step(GTK_VLC_PLAYER(player), file);
+	bench_suspend(GTK_VLC_PLAYER(player), file);
+	bench_seek_accuracy(GTK_VLC_PLAYER(player),
+			    long_gop_file != NULL ? long_gop_file : file);
+	bench_snapshot(GTK_VLC_PLAYER(player), file);
+	bench_thumbnailer(GTK_VLC_PLAYER(player), file);
+	bench_export(GTK_VLC_PLAYER(player), file);
+	bench_time_changed(GTK_VLC_PLAYER(player), file);
+	bench_fullscreen(GTK_VLC_PLAYER(player), file);
+	bench_group(file);
+
+	gtk_widget_destroy(window);
+	libvlc_release(inst);
+
+	gdk_threads_leave();
+
+	if (failed_checks > 0) {
+		g_fprintf(stderr, "%u checks failed\n", failed_checks);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
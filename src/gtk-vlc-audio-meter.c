@@ -0,0 +1,408 @@
+/**
+ * @file
+ * Audio level meter of \e GtkVlcPlayer widgets.
+ * Decoded audio is tapped by duplicating the media's streams into libVLC's
+ * memory stream output (libVLC 2.0 and later), while the original streams
+ * are played back as usual.
+ * Per-channel peak and RMS levels are computed on the stream output's
+ * thread and handed over to the main loop without locking, using three
+ * alternating measurement windows.
+ * An SSE2 kernel is selected at runtime if supported by the CPU.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include <glib.h>
+
+#include <vlc/vlc.h>
+#include <vlc/libvlc_version.h>
+
+#include "gtk-vlc-player-private.h"
+
+/* see gtk-vlc-convert.c */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define LEVELS_X86
+#include <immintrin.h>
+#endif
+
+/** @private */
+#define MAX_CHANNELS GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS
+
+/**
+ * @private
+ * Levels accumulated since the last read
+ */
+typedef struct {
+	guint	channels;
+	guint64	frames;
+	gfloat	peak[MAX_CHANNELS];
+	gdouble	sum_sq[MAX_CHANNELS];
+} LevelsWindow;
+
+struct _GtkVlcAudioMeter {
+	const GtkVlcAudioLevelsKernel *kernel;
+
+	/** Sample buffer lent to libVLC, used by the input thread only */
+	gpointer	buffer;
+	gsize		buffer_size;
+
+	/*
+	 * Each window is owned by either the input thread (back), the
+	 * reader (front) or neither of them (the one handed over).
+	 */
+	LevelsWindow	windows[3];
+	/** Window written by the input thread */
+	guint		back;
+	/** Window read by the reader */
+	guint		front;
+	/**
+	 * Window handed over to the reader (shifted by one bit).
+	 * Bit 0 is set while it has not been read.
+	 */
+	volatile gint	handover;
+
+	/** Copy of the window handed over last, used by the input thread */
+	LevelsWindow	pending;
+};
+
+static void levels_c(const gfloat *samples, guint frames, guint channels,
+		     gfloat *peak, gdouble *sum_sq);
+#ifdef LEVELS_X86
+static void levels_sse2(const gfloat *samples, guint frames, guint channels,
+			gfloat *peak, gdouble *sum_sq);
+#endif
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2,0,0,0)
+static void prerender_cb(void *data, uint8_t **buffer, size_t size);
+static void postrender_cb(void *data, uint8_t *buffer, unsigned channels,
+			  unsigned rate, unsigned count, unsigned bits,
+			  size_t size, int64_t pts);
+#endif
+
+/** @private */
+static const GtkVlcAudioLevelsKernel levels_kernels[] = {
+	{"c", levels_c},
+#ifdef LEVELS_X86
+	{"sse2", levels_sse2},
+#endif
+	{NULL}
+};
+
+/*
+ * Kernels: accumulate the peak of absolute sample values and the sum of
+ * squares per channel of interleaved 32-bit float samples
+ */
+static void
+levels_c(const gfloat *samples, guint frames, guint channels,
+	 gfloat *peak, gdouble *sum_sq)
+{
+	for (guint c = 0; c < channels; c++) {
+		gfloat p = peak[c];
+		gfloat sq = 0.;
+
+		for (guint i = 0; i < frames; i++) {
+			gfloat x = samples[i*channels + c];
+
+			p = MAX(p, fabsf(x));
+			sq += x*x;
+		}
+
+		peak[c] = p;
+		sum_sq[c] += sq;
+	}
+}
+
+#ifdef LEVELS_X86
+
+/*
+ * If the number of channels divides 4 (or 4 divides it), every vector
+ * lane always carries the same channel, so lanes can be accumulated
+ * independently and folded at the end.
+ * Other layouts (e.g. 5.1) use the scalar kernel.
+ */
+__attribute__((target("sse2")))
+static void
+levels_sse2(const gfloat *samples, guint frames, guint channels,
+	    gfloat *peak, gdouble *sum_sq)
+{
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 pk[2], sq[2];
+	gfloat lanes_pk[8], lanes_sq[8];
+	guint vectors, n, i;
+
+	if (channels > 8 || (4 % channels && channels % 4)) {
+		levels_c(samples, frames, channels, peak, sum_sq);
+		return;
+	}
+
+	/* vectors per period of the channel layout */
+	vectors = channels == 8 ? 2 : 1;
+	n = frames*channels;
+
+	pk[0] = pk[1] = sq[0] = sq[1] = _mm_setzero_ps();
+	for (i = 0; i + 4*vectors <= n; i += 4*vectors) {
+		for (guint v = 0; v < vectors; v++) {
+			__m128 x = _mm_loadu_ps(samples + i + 4*v);
+
+			pk[v] = _mm_max_ps(pk[v], _mm_and_ps(x, abs_mask));
+			sq[v] = _mm_add_ps(sq[v], _mm_mul_ps(x, x));
+		}
+	}
+
+	for (guint v = 0; v < vectors; v++) {
+		_mm_storeu_ps(lanes_pk + 4*v, pk[v]);
+		_mm_storeu_ps(lanes_sq + 4*v, sq[v]);
+	}
+	for (guint l = 0; l < 4*vectors; l++) {
+		peak[l % channels] = MAX(peak[l % channels], lanes_pk[l]);
+		sum_sq[l % channels] += lanes_sq[l];
+	}
+
+	/* i is a multiple of channels */
+	levels_c(samples + i, (n - i)/channels, channels, peak, sum_sq);
+}
+
+#endif /* LEVELS_X86 */
+
+/**
+ * @private
+ * @brief Get all audio level kernels supported by the CPU.
+ *
+ * @return Array of kernels, terminated by an entry with a \c NULL name.
+ *         The fastest kernel comes last.
+ */
+const GtkVlcAudioLevelsKernel *
+_gtk_vlc_audio_get_levels_kernels(void)
+{
+	static gsize kernels_initialized = 0;
+	static GtkVlcAudioLevelsKernel kernels[G_N_ELEMENTS(levels_kernels)];
+
+	if (g_once_init_enter(&kernels_initialized)) {
+		guint n = 0;
+
+#ifdef LEVELS_X86
+		__builtin_cpu_init();
+#endif
+		for (guint i = 0; levels_kernels[i].name != NULL; i++) {
+#ifdef LEVELS_X86
+			if (!strcmp(levels_kernels[i].name, "sse2") &&
+			    !__builtin_cpu_supports("sse2"))
+				continue;
+#endif
+			kernels[n++] = levels_kernels[i];
+		}
+		kernels[n].name = NULL;
+
+		g_once_init_leave(&kernels_initialized, 1);
+	}
+
+	return kernels;
+}
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2,0,0,0)
+
+/*
+ * Memory stream output callbacks (invoked from the input thread).
+ * libVLC copies every audio block into a buffer provided by the
+ * prerender callback before passing it to the postrender callback.
+ */
+static void
+prerender_cb(void *data, uint8_t **buffer, size_t size)
+{
+	GtkVlcAudioMeter *meter = data;
+
+	if (size > meter->buffer_size) {
+		g_free(meter->buffer);
+		meter->buffer = g_malloc(size);
+		meter->buffer_size = size;
+	}
+
+	*buffer = meter->buffer;
+}
+
+/*
+ * Every audio block is handed over in a new window. If the previous
+ * window has not been read yet, it is replaced by one that also contains
+ * its levels. Otherwise the reader took it, and the new window only
+ * contains the block.
+ */
+static void
+postrender_cb(void *data, uint8_t *buffer, unsigned channels,
+	      unsigned rate, unsigned count, unsigned bits,
+	      size_t size, int64_t pts)
+{
+	GtkVlcAudioMeter *meter = data;
+	LevelsWindow block, *window = &meter->windows[meter->back];
+	gint handover;
+
+	/* the stream is transcoded to native-endian 32-bit float */
+	if (bits != 32 || channels == 0 || channels > MAX_CHANNELS)
+		return;
+
+	memset(&block, 0, sizeof(block));
+	block.channels = channels;
+	block.frames = count;
+	meter->kernel->func((const gfloat *)buffer, count, channels,
+			    block.peak, block.sum_sq);
+
+	do {
+		handover = g_atomic_int_get(&meter->handover);
+
+		*window = block;
+		/* unread levels of another channel layout are dropped */
+		if (handover & 1 && meter->pending.channels == channels) {
+			window->frames += meter->pending.frames;
+			for (guint c = 0; c < channels; c++) {
+				window->peak[c] = MAX(window->peak[c],
+						      meter->pending.peak[c]);
+				window->sum_sq[c] += meter->pending.sum_sq[c];
+			}
+		}
+		/* fails only if the reader took the window meanwhile */
+	} while (!g_atomic_int_compare_and_exchange(&meter->handover, handover,
+						    meter->back << 1 | 1));
+
+	meter->pending = *window;
+	meter->back = handover >> 1;
+}
+
+#endif
+
+/**
+ * @private
+ * @brief Create a new audio level meter.
+ *
+ * @return New meter, free with \ref _gtk_vlc_audio_meter_free
+ */
+GtkVlcAudioMeter *
+_gtk_vlc_audio_meter_new(void)
+{
+	GtkVlcAudioMeter *meter = g_new0(GtkVlcAudioMeter, 1);
+	const GtkVlcAudioLevelsKernel *kernels = _gtk_vlc_audio_get_levels_kernels();
+	guint i;
+
+	for (i = 0; kernels[i].name != NULL; i++);
+	meter->kernel = kernels + i - 1;
+
+	meter->back = 0;
+	meter->handover = 1 << 1;
+	meter->front = 2;
+
+	return meter;
+}
+
+/**
+ * @private
+ * @brief Free an audio level meter.
+ *
+ * It must no longer be attached to any media player.
+ */
+void
+_gtk_vlc_audio_meter_free(GtkVlcAudioMeter *meter)
+{
+	g_free(meter->buffer);
+	g_free(meter);
+}
+
+/**
+ * @private
+ * @brief Meter the audio of media.
+ *
+ * The media's streams are duplicated: One copy is played back as usual,
+ * the audio of the other one is decoded and passed to the meter.
+ * Only the first stream of every kind is played back.
+ * The meter must not be freed while the media is played and must be
+ * tapped only by media played one at a time, since there is only one
+ * measurement window. Tapping the same media again replaces the meter.
+ * This has no effect before libVLC 2.0.
+ *
+ * @param meter Audio level meter
+ * @param media Media about to be played
+ */
+void
+_gtk_vlc_audio_meter_tap(GtkVlcAudioMeter *meter, libvlc_media_t *media)
+{
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2,0,0,0)
+	gchar *option;
+
+	/* smem parses its callbacks and data from decimal addresses */
+	option = g_strdup_printf(":sout=#duplicate{dst=display,"
+				 "dst=transcode{acodec=fl32}:smem{"
+				 "audio-prerender-callback=%" G_GINT64_FORMAT ","
+				 "audio-postrender-callback=%" G_GINT64_FORMAT ","
+				 "audio-data=%" G_GINT64_FORMAT ","
+				 "no-time-sync},select=audio}",
+				 (gint64)(gintptr)prerender_cb,
+				 (gint64)(gintptr)postrender_cb,
+				 (gint64)(gintptr)meter);
+	libvlc_media_add_option(media, option);
+	g_free(option);
+#endif
+}
+
+/**
+ * @private
+ * @brief Read levels measured since the last read.
+ *
+ * This does not block the input thread. Every audio block is reported
+ * by exactly one read.
+ *
+ * @param meter  Audio level meter
+ * @param levels Location to store levels in
+ * @return \c FALSE if no audio was measured since the last read
+ */
+gboolean
+_gtk_vlc_audio_meter_read(GtkVlcAudioMeter *meter,
+			  GtkVlcPlayerAudioLevels *levels)
+{
+	const LevelsWindow *window;
+	gint handover;
+
+	/* take the window handed over, giving back the one read last */
+	do {
+		handover = g_atomic_int_get(&meter->handover);
+		if (!(handover & 1))
+			/* no audio block since the last read */
+			return FALSE;
+	} while (!g_atomic_int_compare_and_exchange(&meter->handover, handover,
+						    meter->front << 1));
+	meter->front = handover >> 1;
+
+	window = &meter->windows[meter->front];
+	if (window->frames == 0)
+		return FALSE;
+
+	levels->channels = window->channels;
+	for (guint c = 0; c < window->channels; c++) {
+		levels->peak[c] = window->peak[c];
+		levels->rms[c] = (gfloat)sqrt(window->sum_sq[c]/window->frames);
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,465 @@
+/**
+ * @file
+ * Colour space conversion kernels of the software renderer.
+ * Planar YUV (I420 and NV12, BT.601 limited range) is converted to
+ * cairo's 32-bit RGB format. SSE2 and AVX2 kernels are selected at runtime
+ * if supported by the CPU. All kernels produce exactly the same output as the
+ * scalar reference implementation.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "gtk-vlc-player-private.h"
+
+/*
+ * x86 kernels are compiled using function target attributes,
+ * so no special compiler flags are required
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define CONVERT_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Fixed-point BT.601 coefficients (scaled by 64).
+ * With 6 fractional bits, all intermediate values fit into 16 bits,
+ * except for the blue channel which may only saturate towards values that
+ * are clipped anyway. This allows 16-bit SIMD arithmetics that is
+ * bit-exact with the scalar reference.
+ */
+#define COEF_Y	75	/* 1.164, rounded up so that white saturates */
+#define COEF_RV	102	/* 1.596 */
+#define COEF_GU	25	/* 0.391 */
+#define COEF_GV	52	/* 0.813 */
+#define COEF_BU	129	/* 2.018 */
+#define ROUND	32
+
+/** @private */
+#define PIXEL(R, G, B) \
+	(0xFF000000U | ((guint32)(R) << 16) | ((guint32)(G) << 8) | (guint32)(B))
+
+static void convert_i420_row_c(guint32 *dst, const guint8 *y,
+			       const guint8 *u, const guint8 *v, guint width);
+static void convert_nv12_row_c(guint32 *dst, const guint8 *y,
+			       const guint8 *uv, guint width);
+#ifdef CONVERT_X86
+static void convert_i420_row_sse2(guint32 *dst, const guint8 *y,
+				  const guint8 *u, const guint8 *v, guint width);
+static void convert_nv12_row_sse2(guint32 *dst, const guint8 *y,
+				  const guint8 *uv, guint width);
+static void convert_i420_row_avx2(guint32 *dst, const guint8 *y,
+				  const guint8 *u, const guint8 *v, guint width);
+static void convert_nv12_row_avx2(guint32 *dst, const guint8 *y,
+				  const guint8 *uv, guint width);
+#endif
+
+/** @private */
+static const GtkVlcConvertKernel convert_kernels[] = {
+	{"scalar", convert_i420_row_c, convert_nv12_row_c},
+#ifdef CONVERT_X86
+	{"sse2", convert_i420_row_sse2, convert_nv12_row_sse2},
+	{"avx2", convert_i420_row_avx2, convert_nv12_row_avx2},
+#endif
+	{NULL, NULL, NULL}
+};
+
+static inline guint8
+clip_pixel(gint value)
+{
+	if (value < 0)
+		return 0;
+	value >>= 6;
+	return value > 255 ? 255 : (guint8)value;
+}
+
+static inline guint32
+convert_pixel(guint8 y, guint8 u, guint8 v)
+{
+	gint c = COEF_Y*((gint)y - 16) + ROUND;
+	gint d = (gint)u - 128;
+	gint e = (gint)v - 128;
+
+	return PIXEL(clip_pixel(c + COEF_RV*e),
+		     clip_pixel(c - COEF_GU*d - COEF_GV*e),
+		     clip_pixel(c + COEF_BU*d));
+}
+
+/*
+ * Scalar reference kernels.
+ * They are also used for the remaining pixels of rows by the SIMD kernels.
+ */
+static void
+convert_i420_row_c(guint32 *dst, const guint8 *y,
+		   const guint8 *u, const guint8 *v, guint width)
+{
+	for (guint x = 0; x < width; x++)
+		dst[x] = convert_pixel(y[x], u[x/2], v[x/2]);
+}
+
+static void
+convert_nv12_row_c(guint32 *dst, const guint8 *y,
+		   const guint8 *uv, guint width)
+{
+	for (guint x = 0; x < width; x++)
+		dst[x] = convert_pixel(y[x], uv[x & ~1U], uv[x | 1U]);
+}
+
+#ifdef CONVERT_X86
+
+/*
+ * SSE2 kernels: 16 pixels per iteration
+ */
+
+/**
+ * @private
+ * Convert 16 pixels, given 16-bit luma (two vectors of 8) and
+ * 8 chroma samples (16-bit, U and V relative to 128).
+ */
+__attribute__((target("sse2")))
+static inline void
+convert_16_sse2(guint32 *dst, __m128i y_lo, __m128i y_hi, __m128i d, __m128i e)
+{
+	const __m128i alpha = _mm_set1_epi8((char)0xFF);
+
+	__m128i r_c, g_c, b_c;
+	__m128i r, g, b, bg, ra;
+
+	/* 16-bit luma term, rounding included */
+	y_lo = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(y_lo, _mm_set1_epi16(16)),
+					     _mm_set1_epi16(COEF_Y)),
+			     _mm_set1_epi16(ROUND));
+	y_hi = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(y_hi, _mm_set1_epi16(16)),
+					     _mm_set1_epi16(COEF_Y)),
+			     _mm_set1_epi16(ROUND));
+
+	r_c = _mm_mullo_epi16(e, _mm_set1_epi16(COEF_RV));
+	g_c = _mm_add_epi16(_mm_mullo_epi16(d, _mm_set1_epi16(-COEF_GU)),
+			    _mm_mullo_epi16(e, _mm_set1_epi16(-COEF_GV)));
+	b_c = _mm_mullo_epi16(d, _mm_set1_epi16(COEF_BU));
+
+	/* every chroma sample covers two pixels */
+#define CHANNEL(C) \
+	_mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(y_lo, _mm_unpacklo_epi16(C, C)), 6), \
+			 _mm_srai_epi16(_mm_adds_epi16(y_hi, _mm_unpackhi_epi16(C, C)), 6))
+	r = CHANNEL(r_c);
+	g = CHANNEL(g_c);
+	b = CHANNEL(b_c);
+#undef CHANNEL
+
+	/* little-endian 0xAARRGGBB is B, G, R, A in memory */
+	bg = _mm_unpacklo_epi8(b, g);
+	ra = _mm_unpacklo_epi8(r, alpha);
+	_mm_storeu_si128((__m128i *)dst + 0, _mm_unpacklo_epi16(bg, ra));
+	_mm_storeu_si128((__m128i *)dst + 1, _mm_unpackhi_epi16(bg, ra));
+	bg = _mm_unpackhi_epi8(b, g);
+	ra = _mm_unpackhi_epi8(r, alpha);
+	_mm_storeu_si128((__m128i *)dst + 2, _mm_unpacklo_epi16(bg, ra));
+	_mm_storeu_si128((__m128i *)dst + 3, _mm_unpackhi_epi16(bg, ra));
+}
+
+__attribute__((target("sse2")))
+static void
+convert_i420_row_sse2(guint32 *dst, const guint8 *y,
+		      const guint8 *u, const guint8 *v, guint width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	guint x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		__m128i y8 = _mm_loadu_si128((const __m128i *)(y + x));
+		__m128i d = _mm_loadl_epi64((const __m128i *)(u + x/2));
+		__m128i e = _mm_loadl_epi64((const __m128i *)(v + x/2));
+
+		d = _mm_sub_epi16(_mm_unpacklo_epi8(d, zero), bias);
+		e = _mm_sub_epi16(_mm_unpacklo_epi8(e, zero), bias);
+
+		convert_16_sse2(dst + x, _mm_unpacklo_epi8(y8, zero),
+				_mm_unpackhi_epi8(y8, zero), d, e);
+	}
+
+	convert_i420_row_c(dst + x, y + x, u + x/2, v + x/2, width - x);
+}
+
+__attribute__((target("sse2")))
+static void
+convert_nv12_row_sse2(guint32 *dst, const guint8 *y,
+		      const guint8 *uv, guint width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	guint x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		__m128i y8 = _mm_loadu_si128((const __m128i *)(y + x));
+		__m128i uv8 = _mm_loadu_si128((const __m128i *)(uv + x));
+
+		/* deinterleave: U is the low, V the high byte of 16-bit lanes */
+		__m128i d = _mm_sub_epi16(_mm_and_si128(uv8, mask), bias);
+		__m128i e = _mm_sub_epi16(_mm_srli_epi16(uv8, 8), bias);
+
+		convert_16_sse2(dst + x, _mm_unpacklo_epi8(y8, zero),
+				_mm_unpackhi_epi8(y8, zero), d, e);
+	}
+
+	convert_nv12_row_c(dst + x, y + x, uv + x, width - x);
+}
+
+/*
+ * AVX2 kernels: 32 pixels per iteration.
+ * Most AVX2 integer instructions operate on 128-bit lanes separately,
+ * so the results are reordered using cross-lane permutations.
+ */
+
+/**
+ * @private
+ * Convert 32 pixels, given 32 luma bytes and
+ * 16 chroma samples (16-bit, U and V relative to 128, in order).
+ */
+__attribute__((target("avx2")))
+static inline void
+convert_32_avx2(guint32 *dst, __m256i y8, __m256i d, __m256i e)
+{
+	const __m256i alpha = _mm256_set1_epi8((char)0xFF);
+
+	__m256i y0, y1;
+	__m256i r_c, g_c, b_c;
+	__m256i r, g, b, bg_lo, bg_hi, ra_lo, ra_hi;
+	__m256i o0, o1, o2, o3;
+
+	/* pixels 0-15 and 16-31 */
+	y0 = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(y8));
+	y1 = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(y8, 1));
+	y0 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(y0, _mm256_set1_epi16(16)),
+						 _mm256_set1_epi16(COEF_Y)),
+			      _mm256_set1_epi16(ROUND));
+	y1 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(y1, _mm256_set1_epi16(16)),
+						 _mm256_set1_epi16(COEF_Y)),
+			      _mm256_set1_epi16(ROUND));
+
+	r_c = _mm256_mullo_epi16(e, _mm256_set1_epi16(COEF_RV));
+	g_c = _mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_set1_epi16(-COEF_GU)),
+			       _mm256_mullo_epi16(e, _mm256_set1_epi16(-COEF_GV)));
+	b_c = _mm256_mullo_epi16(d, _mm256_set1_epi16(COEF_BU));
+
+	/*
+	 * Duplicate every chroma sample for two pixels:
+	 * unpacklo/hi yield pixels (0-7, 16-23) and (8-15, 24-31),
+	 * so lanes are regrouped into pixels 0-15 and 16-31.
+	 * packus interleaves the qwords of both operands, which is undone
+	 * by permuting them into order (0, 2, 1, 3).
+	 */
+#define CHANNEL(C) G_STMT_START {					\
+	__m256i lo = _mm256_unpacklo_epi16(C, C);			\
+	__m256i hi = _mm256_unpackhi_epi16(C, C);			\
+	__m256i c0 = _mm256_permute2x128_si256(lo, hi, 0x20);		\
+	__m256i c1 = _mm256_permute2x128_si256(lo, hi, 0x31);		\
+	C = _mm256_packus_epi16(_mm256_srai_epi16(_mm256_adds_epi16(y0, c0), 6), \
+				_mm256_srai_epi16(_mm256_adds_epi16(y1, c1), 6)); \
+	C = _mm256_permute4x64_epi64(C, 0xD8);				\
+} G_STMT_END
+	CHANNEL(r_c);
+	CHANNEL(g_c);
+	CHANNEL(b_c);
+#undef CHANNEL
+	r = r_c;
+	g = g_c;
+	b = b_c;
+
+	/* lanes hold pixels (0-7, 16-23) and (8-15, 24-31) */
+	bg_lo = _mm256_unpacklo_epi8(b, g);
+	bg_hi = _mm256_unpackhi_epi8(b, g);
+	ra_lo = _mm256_unpacklo_epi8(r, alpha);
+	ra_hi = _mm256_unpackhi_epi8(r, alpha);
+
+	/* lanes hold pixels (0-3, 16-19), (4-7, 20-23), (8-11, 24-27), (12-15, 28-31) */
+	o0 = _mm256_unpacklo_epi16(bg_lo, ra_lo);
+	o1 = _mm256_unpackhi_epi16(bg_lo, ra_lo);
+	o2 = _mm256_unpacklo_epi16(bg_hi, ra_hi);
+	o3 = _mm256_unpackhi_epi16(bg_hi, ra_hi);
+
+	_mm256_storeu_si256((__m256i *)dst + 0, _mm256_permute2x128_si256(o0, o1, 0x20));
+	_mm256_storeu_si256((__m256i *)dst + 1, _mm256_permute2x128_si256(o2, o3, 0x20));
+	_mm256_storeu_si256((__m256i *)dst + 2, _mm256_permute2x128_si256(o0, o1, 0x31));
+	_mm256_storeu_si256((__m256i *)dst + 3, _mm256_permute2x128_si256(o2, o3, 0x31));
+}
+
+__attribute__((target("avx2")))
+static void
+convert_i420_row_avx2(guint32 *dst, const guint8 *y,
+		      const guint8 *u, const guint8 *v, guint width)
+{
+	const __m256i bias = _mm256_set1_epi16(128);
+	guint x;
+
+	for (x = 0; x + 32 <= width; x += 32) {
+		__m256i y8 = _mm256_loadu_si256((const __m256i *)(y + x));
+		__m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + x/2)));
+		__m256i e = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(v + x/2)));
+
+		convert_32_avx2(dst + x, y8, _mm256_sub_epi16(d, bias),
+				_mm256_sub_epi16(e, bias));
+	}
+
+	/* there may be up to 31 pixels left */
+	convert_i420_row_sse2(dst + x, y + x, u + x/2, v + x/2, width - x);
+}
+
+__attribute__((target("avx2")))
+static void
+convert_nv12_row_avx2(guint32 *dst, const guint8 *y,
+		      const guint8 *uv, guint width)
+{
+	const __m256i bias = _mm256_set1_epi16(128);
+	const __m256i mask = _mm256_set1_epi16(0x00FF);
+	guint x;
+
+	for (x = 0; x + 32 <= width; x += 32) {
+		__m256i y8 = _mm256_loadu_si256((const __m256i *)(y + x));
+		__m256i uv8 = _mm256_loadu_si256((const __m256i *)(uv + x));
+
+		convert_32_avx2(dst + x, y8,
+				_mm256_sub_epi16(_mm256_and_si256(uv8, mask), bias),
+				_mm256_sub_epi16(_mm256_srli_epi16(uv8, 8), bias));
+	}
+
+	convert_nv12_row_sse2(dst + x, y + x, uv + x, width - x);
+}
+
+#endif /* CONVERT_X86 */
+
+/**
+ * @private
+ * @brief Get all conversion kernels supported by the CPU.
+ *
+ * @return Array of kernels terminated by an entry whose name is \c NULL,
+ *         ordered from slowest (scalar reference) to fastest
+ */
+const GtkVlcConvertKernel *
+_gtk_vlc_convert_get_kernels(void)
+{
+	static const GtkVlcConvertKernel *kernels = NULL;
+	static gsize kernels_initialized = 0;
+
+	if (g_once_init_enter(&kernels_initialized)) {
+		static GtkVlcConvertKernel supported[G_N_ELEMENTS(convert_kernels)];
+		guint n = 0;
+
+#ifdef CONVERT_X86
+		__builtin_cpu_init();
+#endif
+		for (guint i = 0; convert_kernels[i].name != NULL; i++) {
+#ifdef CONVERT_X86
+			if (!strcmp(convert_kernels[i].name, "sse2") &&
+			    !__builtin_cpu_supports("sse2"))
+				continue;
+			if (!strcmp(convert_kernels[i].name, "avx2") &&
+			    !__builtin_cpu_supports("avx2"))
+				continue;
+#endif
+			supported[n++] = convert_kernels[i];
+		}
+		memset(supported + n, 0, sizeof(*supported));
+		kernels = supported;
+
+		g_once_init_leave(&kernels_initialized, 1);
+	}
+
+	return kernels;
+}
+
+/**
+ * @private
+ * @brief Get the fastest conversion kernel supported by the CPU.
+ *
+ * The environment variable \c GTK_VLC_PLAYER_CONVERT may be set to the name
+ * of a kernel to use instead (e.g. "scalar").
+ *
+ * @return Conversion kernel
+ */
+const GtkVlcConvertKernel *
+_gtk_vlc_convert_get_kernel(void)
+{
+	const GtkVlcConvertKernel *kernels = _gtk_vlc_convert_get_kernels();
+	const gchar *name = g_getenv("GTK_VLC_PLAYER_CONVERT");
+	guint i;
+
+	for (i = 0; kernels[i].name != NULL; i++)
+		if (name != NULL && !strcmp(kernels[i].name, name))
+			return kernels + i;
+
+	return kernels + i - 1;
+}
+
+/**
+ * @private
+ * @brief Convert planar YUV frame to 32-bit RGB.
+ *
+ * The frame can be scaled down vertically at the same time (nearest
+ * neighbour), so that rows that would not be visible are not converted.
+ *
+ * @param kernel     Conversion kernel
+ * @param chroma     Chroma of the source frame
+ * @param planes     Source planes (Y, U, V or Y, UV)
+ * @param pitches    Source plane pitches (bytes)
+ * @param width      Width of the frame (pixels)
+ * @param height     Height of the source frame (rows)
+ * @param dst        Destination buffer
+ * @param dst_stride Destination stride (bytes)
+ * @param dst_height Height of the destination frame (rows, at most \e height)
+ */
+void
+_gtk_vlc_convert_frame(const GtkVlcConvertKernel *kernel,
+		       GtkVlcConvertChroma chroma,
+		       guint8 *const *planes, const guint *pitches,
+		       guint width, guint height,
+		       guint8 *dst, guint dst_stride, guint dst_height)
+{
+	for (guint dy = 0; dy < dst_height; dy++) {
+		/* center of destination row */
+		guint sy = (guint)(((guint64)2*dy + 1)*height / (2*dst_height));
+		guint32 *row = (guint32 *)(dst + (gsize)dy*dst_stride);
+		const guint8 *y = planes[0] + (gsize)sy*pitches[0];
+
+		switch (chroma) {
+		case GTK_VLC_CONVERT_I420:
+			kernel->i420_row(row, y,
+					 planes[1] + (gsize)(sy/2)*pitches[1],
+					 planes[2] + (gsize)(sy/2)*pitches[2],
+					 width);
+			break;
+		case GTK_VLC_CONVERT_NV12:
+			kernel->nv12_row(row, y,
+					 planes[1] + (gsize)(sy/2)*pitches[1],
+					 width);
+			break;
+		}
+	}
+}
@@ -0,0 +1,351 @@
+/**
+ * @file
+ * Background export of media segments.
+ * Segments are written by headless libVLC media players on a worker pool
+ * of bounded size, using a libVLC instance separate from the playback
+ * instances. The stream output copies the elementary streams into the
+ * new container (remuxing) or, if the cut requires it, re-encodes them.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <gdk/gdk.h>
+
+#include <vlc/vlc.h>
+#include <vlc/libvlc_version.h>
+
+#include "gtk-vlc-player-private.h"
+
+/** @private */
+#define EXPORT_MAX_WORKERS	2
+/** @private */
+#define PROGRESS_INTERVAL	100 /* milliseconds */
+
+/**
+ * @private
+ * Codecs to re-encode segments with that cannot be remuxed
+ */
+#define EXPORT_TRANSCODE	"transcode{vcodec=h264,acodec=mp4a,ab=192}"
+
+/**
+ * @private
+ * Export of one segment.
+ * It is freed on the main loop after completion has been reported.
+ */
+struct _GtkVlcExportJob {
+	gchar			*mrl;
+	gchar			*filename;
+	gint64			in, out;
+	gboolean		remux;
+
+	GtkVlcExportProgressFunc progress;
+	GtkVlcExportFinishFunc	finish;
+	gpointer		user_data;
+	guint			progress_id;
+	gint			progress_reported;
+	/** Written by the worker, read by the progress timeout */
+	volatile gint		progress_permille;
+
+	volatile gint		cancelled;
+
+	/** protects \e done and \e failed */
+	GMutex			*mutex;
+	GCond			*cond;
+	gboolean		done;
+	gboolean		failed;
+
+	gboolean		success;
+};
+
+static gchar *sout_escape(const gchar *value);
+
+static void export_event_cb(const struct libvlc_event_t *event,
+			    void *user_data);
+static gboolean export_write(GtkVlcExportJob *job);
+static void export_pool_worker(gpointer data, gpointer user_data);
+static gboolean export_progress_cb(gpointer user_data);
+static gboolean export_finish_cb(gpointer user_data);
+
+/** @private */
+static GThreadPool *export_pool = NULL;
+/** @private */
+static gsize export_pool_initialized = 0;
+
+/**
+ * @private
+ * Options of the headless libVLC instance.
+ * They also keep it apart from the pooled playback instances.
+ */
+static const gchar *const export_vlc_options[] = {
+	"--vout=dummy",
+	"--aout=dummy",
+	NULL
+};
+
+/*
+ * Quote a value of a stream output chain, so it may contain
+ * separators like commas and braces.
+ */
+static gchar *
+sout_escape(const gchar *value)
+{
+	GString *str = g_string_new("\"");
+
+	for (const gchar *p = value; *p != '\0'; p++) {
+		if (*p == '"' || *p == '\'' || *p == '\\')
+			g_string_append_c(str, '\\');
+		g_string_append_c(str, *p);
+	}
+	g_string_append_c(str, '"');
+
+	return g_string_free(str, FALSE);
+}
+
+static void
+export_event_cb(const struct libvlc_event_t *event, void *user_data)
+{
+	GtkVlcExportJob *job = user_data;
+
+	g_mutex_lock(job->mutex);
+	if (event->type == libvlc_MediaPlayerEncounteredError)
+		job->failed = TRUE;
+	job->done = TRUE;
+	g_cond_signal(job->cond);
+	g_mutex_unlock(job->mutex);
+}
+
+/*
+ * The stream output is not synchronized to a clock, so the segment is
+ * written as fast as it can be read (and encoded).
+ * Remuxing starts at the keyframe at or before the in point.
+ */
+static gboolean
+export_write(GtkVlcExportJob *job)
+{
+	static const libvlc_event_type_t events[] = {
+		libvlc_MediaPlayerEndReached,
+		libvlc_MediaPlayerEncounteredError
+	};
+
+	libvlc_instance_t *vlc_inst;
+	libvlc_media_t *media;
+	libvlc_media_player_t *media_player;
+	libvlc_event_manager_t *evman;
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar *option, *dst;
+	gboolean success;
+
+	vlc_inst = _gtk_vlc_instance_pool_acquire(export_vlc_options);
+	if (vlc_inst == NULL)
+		return FALSE;
+
+	media = libvlc_media_new_location(vlc_inst, (const char *)job->mrl);
+	if (media == NULL) {
+		_gtk_vlc_instance_pool_release(vlc_inst);
+		return FALSE;
+	}
+
+	/* libVLC parses option values independent of the locale */
+	g_ascii_formatd(buf, sizeof(buf), "%.3f", job->in/1000.);
+	option = g_strconcat(":start-time=", buf, NULL);
+	libvlc_media_add_option(media, option);
+	g_free(option);
+	g_ascii_formatd(buf, sizeof(buf), "%.3f", job->out/1000.);
+	option = g_strconcat(":stop-time=", buf, NULL);
+	libvlc_media_add_option(media, option);
+	g_free(option);
+
+	/* the muxer is chosen by the file extension */
+	dst = sout_escape(job->filename);
+	option = g_strconcat(":sout=#", job->remux ? "" : EXPORT_TRANSCODE ":",
+			     "std{access=file,dst=", dst, "}", NULL);
+	libvlc_media_add_option(media, option);
+	g_free(option);
+	g_free(dst);
+	/* all tracks, not only the first of each category */
+	libvlc_media_add_option(media, ":sout-all");
+
+	media_player = libvlc_media_player_new_from_media(media);
+	evman = libvlc_media_player_event_manager(media_player);
+	for (guint i = 0; i < G_N_ELEMENTS(events); i++)
+		libvlc_event_attach(evman, events[i], export_event_cb, job);
+
+	libvlc_media_player_play(media_player);
+
+	g_mutex_lock(job->mutex);
+	while (!job->done && !g_atomic_int_get(&job->cancelled)) {
+		GTimeVal until;
+		gint64 time;
+
+		g_mutex_unlock(job->mutex);
+		time = (gint64)libvlc_media_player_get_time(media_player);
+		if (time > job->in && job->out > job->in)
+			g_atomic_int_set(&job->progress_permille,
+					 (gint)MIN((time - job->in)*1000 /
+						   (job->out - job->in), 999));
+		g_mutex_lock(job->mutex);
+
+		g_get_current_time(&until);
+		g_time_val_add(&until, PROGRESS_INTERVAL*1000);
+		g_cond_timed_wait(job->cond, job->mutex, &until);
+	}
+	success = job->done && !job->failed;
+	g_mutex_unlock(job->mutex);
+
+	/* also closes the output file */
+	libvlc_media_player_stop(media_player);
+	for (guint i = 0; i < G_N_ELEMENTS(events); i++)
+		libvlc_event_detach(evman, events[i], export_event_cb, job);
+	libvlc_media_player_release(media_player);
+	libvlc_media_release(media);
+	_gtk_vlc_instance_pool_release(vlc_inst);
+
+	return success;
+}
+
+static void
+export_pool_worker(gpointer data, gpointer user_data)
+{
+	GtkVlcExportJob *job = data;
+
+	/* jobs cancelled while queued are skipped */
+	if (!g_atomic_int_get(&job->cancelled)) {
+		job->success = export_write(job);
+		if (!job->success)
+			/* don't leave partial segments behind */
+			g_unlink(job->filename);
+	}
+
+	gdk_threads_add_idle(export_finish_cb, job);
+}
+
+static gboolean
+export_progress_cb(gpointer user_data)
+{
+	GtkVlcExportJob *job = user_data;
+	gint permille = g_atomic_int_get(&job->progress_permille);
+
+	if (permille != job->progress_reported) {
+		job->progress_reported = permille;
+		job->progress(permille/1000., job->user_data);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+export_finish_cb(gpointer user_data)
+{
+	GtkVlcExportJob *job = user_data;
+
+	if (job->progress_id != 0) {
+		g_source_remove(job->progress_id);
+		if (job->success && job->progress_reported != 1000)
+			job->progress(1., job->user_data);
+	}
+
+	job->finish(job->success, job->user_data);
+
+	g_cond_free(job->cond);
+	g_mutex_free(job->mutex);
+	g_free(job->filename);
+	g_free(job->mrl);
+	g_free(job);
+
+	return FALSE;
+}
+
+/**
+ * @brief Export a segment of media in the background.
+ *
+ * \e progress is invoked on the main loop (with the Gdk lock held)
+ * while writing, at most every 100 milliseconds. \e finish is invoked on
+ * the main loop when the job is done. The job is freed afterwards.
+ *
+ * @param mrl       MRL of media
+ * @param filename  File to write, the container format is chosen by
+ *                  its extension
+ * @param in        Start of segment (milliseconds)
+ * @param out       End of segment (milliseconds)
+ * @param remux     Whether to copy the streams instead of re-encoding them
+ * @param progress  Callback to report progress with, or \c NULL
+ * @param finish    Callback to report completion with
+ * @param user_data Data to pass to \e progress and \e finish
+ * @return Export job, valid until \e finish returns
+ */
+GtkVlcExportJob *
+_gtk_vlc_export_push(const gchar *mrl, const gchar *filename,
+		     gint64 in, gint64 out, gboolean remux,
+		     GtkVlcExportProgressFunc progress,
+		     GtkVlcExportFinishFunc finish, gpointer user_data)
+{
+	GtkVlcExportJob *job = g_new0(GtkVlcExportJob, 1);
+
+	job->mrl = g_strdup(mrl);
+	job->filename = g_strdup(filename);
+	job->in = in;
+	job->out = out;
+	job->remux = remux;
+
+	job->progress = progress;
+	job->finish = finish;
+	job->user_data = user_data;
+	if (progress != NULL)
+		job->progress_id = gdk_threads_add_timeout(PROGRESS_INTERVAL,
+							   export_progress_cb,
+							   job);
+
+	job->mutex = g_mutex_new();
+	job->cond = g_cond_new();
+
+	if (g_once_init_enter(&export_pool_initialized)) {
+		export_pool = g_thread_pool_new(export_pool_worker, NULL,
+						EXPORT_MAX_WORKERS, FALSE, NULL);
+		g_once_init_leave(&export_pool_initialized, 1);
+	}
+	g_thread_pool_push(export_pool, job, NULL);
+
+	return job;
+}
+
+/**
+ * @brief Cancel an export job.
+ *
+ * The job still finishes (unsuccessfully) and the partially written
+ * file is removed.
+ *
+ * @param job Export job
+ */
+void
+_gtk_vlc_export_cancel(GtkVlcExportJob *job)
+{
+	g_atomic_int_set(&job->cancelled, TRUE);
+
+	/* wake up the worker */
+	g_mutex_lock(job->mutex);
+	g_cond_signal(job->cond);
+	g_mutex_unlock(job->mutex);
+}
@@ -0,0 +1,688 @@
+/**
+ * @file
+ * Indexes of the video frame and keyframe positions of media files.
+ * The video track is demultiplexed (but not decoded) faster than real
+ * time by a headless libVLC media player on a background worker pool.
+ * Frames are added to the index as they are demultiplexed, so the part of
+ * the media indexed so far can be used while the index is still being
+ * built. Finished indexes are stored in cache files keyed by path, size
+ * and modification time.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <vlc/vlc.h>
+#include <vlc/libvlc_version.h>
+
+#include "gtk-vlc-frame-index.h"
+#include "gtk-vlc-media-index.h"
+#include "gtk-vlc-player-private.h"
+
+/** @private */
+#define FRAME_INDEX_MAGIC	"GVLCFRM"
+/** @private */
+#define FRAME_INDEX_VERSION	1
+/** @private */
+#define FRAME_INDEX_BYTE_ORDER	0x01020304
+
+/** @private */
+#define FOURCC(a, b, c, d) \
+	((guint32)(a) | (guint32)(b) << 8 | (guint32)(c) << 16 | (guint32)(d) << 24)
+
+/**
+ * @private
+ * Frames are demultiplexed in decoding order, so frames up to this
+ * much before the latest one might still be missing
+ */
+#define REORDER_MARGIN		500000 /* microseconds */
+
+/** @private */
+#define BUILD_MAX_WORKERS	2
+/** @private */
+#define CANCEL_POLL_INTERVAL	100 /* milliseconds */
+
+/**
+ * @private
+ * Header of a frame index cache file.
+ * It is followed by \e n_frames frame times and \e n_keyframes keyframe
+ * times (both sorted, in microseconds).
+ * All values are in host byte order, which is verified by \e byte_order.
+ */
+typedef struct {
+	gchar	magic[8];
+	guint32	version;
+	guint32	byte_order;
+
+	gint64	size;		/**< Size of media file */
+	gint64	mtime;		/**< Modification time of media file */
+
+	guint32	n_frames;
+	guint32	n_keyframes;
+} FrameIndexHeader;
+
+struct _GtkVlcFrameIndex {
+	/** One reference by the owner, one by a running build */
+	volatile gint	ref_count;
+	GCancellable	*cancellable;
+
+	/** protects all of the following */
+	GMutex		*mutex;
+	GArray		*frames;	/**< sorted frame times (us) */
+	GArray		*keyframes;	/**< sorted keyframe times (us) */
+	/** All frames before this time (us) are indexed */
+	gint64		indexed;
+	gboolean	complete;
+};
+
+/**
+ * @private
+ * Background build of a frame index
+ */
+typedef struct {
+	GtkVlcFrameIndex	*index;
+	gchar			*file;
+	gchar			*cache_dir;
+
+	/*
+	 * Demultiplexer state, only accessed by libVLC's stream output
+	 * thread while demultiplexing
+	 */
+	guint32		codec;
+	guint8		*es;
+	gsize		es_size;
+	gint64		latest;		/**< latest frame time (us) */
+
+	/** protects \e done and \e failed */
+	GMutex		*mutex;
+	GCond		*cond;
+	gboolean	done;
+	gboolean	failed;
+} BuildJob;
+
+static gboolean stat_file(const gchar *file, gint64 *size, gint64 *mtime);
+static gchar *cache_filename(const gchar *file, const gchar *cache_dir);
+static void cache_save(BuildJob *job, gint64 size, gint64 mtime);
+static gboolean cache_load(GtkVlcFrameIndex *index, const gchar *file,
+			   const gchar *cache_dir);
+
+static GtkVlcFrameIndex *frame_index_ref(GtkVlcFrameIndex *index);
+static void frame_index_unref(GtkVlcFrameIndex *index);
+static void times_insert(GArray *times, gint64 time);
+static gint times_find(GArray *times, gint64 time);
+static gboolean is_keyframe(guint32 codec, const guint8 *data, gsize size);
+
+static void smem_prerender_cb(void *data, uint8_t **buffer, size_t size);
+static void smem_postrender_cb(void *data, uint8_t *buffer,
+			       int width, int height, int pixel_pitch,
+			       size_t size, int64_t pts);
+static void build_event_cb(const struct libvlc_event_t *event,
+			   void *user_data);
+static void build_demux(BuildJob *job);
+static void build_pool_worker(gpointer data, gpointer user_data);
+
+/** @private */
+static GThreadPool *build_pool = NULL;
+/** @private */
+static gsize build_pool_initialized = 0;
+
+static gboolean
+stat_file(const gchar *file, gint64 *size, gint64 *mtime)
+{
+	GStatBuf st;
+
+	if (g_stat(file, &st))
+		return FALSE;
+
+	*size = (gint64)st.st_size;
+	*mtime = (gint64)st.st_mtime;
+	return TRUE;
+}
+
+static gchar *
+cache_filename(const gchar *file, const gchar *cache_dir)
+{
+	gchar *checksum, *basename, *ret;
+
+	checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, file, -1);
+	basename = g_strconcat(checksum, ".frames", NULL);
+	ret = g_build_filename(cache_dir, basename, NULL);
+
+	g_free(basename);
+	g_free(checksum);
+	return ret;
+}
+
+static void
+cache_save(BuildJob *job, gint64 size, gint64 mtime)
+{
+	GtkVlcFrameIndex *index = job->index;
+	FrameIndexHeader header;
+	GByteArray *contents;
+	gchar *filename;
+	GError *error = NULL;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FRAME_INDEX_MAGIC, sizeof(header.magic));
+	header.version = FRAME_INDEX_VERSION;
+	header.byte_order = FRAME_INDEX_BYTE_ORDER;
+	header.size = size;
+	header.mtime = mtime;
+
+	g_mutex_lock(index->mutex);
+	header.n_frames = index->frames->len;
+	header.n_keyframes = index->keyframes->len;
+
+	contents = g_byte_array_sized_new(sizeof(header) +
+					  (header.n_frames +
+					   header.n_keyframes)*sizeof(gint64));
+	g_byte_array_append(contents, (const guint8 *)&header, sizeof(header));
+	g_byte_array_append(contents, (const guint8 *)index->frames->data,
+			    header.n_frames*sizeof(gint64));
+	g_byte_array_append(contents, (const guint8 *)index->keyframes->data,
+			    header.n_keyframes*sizeof(gint64));
+	g_mutex_unlock(index->mutex);
+
+	filename = cache_filename(job->file, job->cache_dir);
+	g_mkdir_with_parents(job->cache_dir, 0755);
+	if (!g_file_set_contents(filename, (const gchar *)contents->data,
+				 (gssize)contents->len, &error)) {
+		g_warning("Cannot save frame index cache \"%s\": %s",
+			  filename, error->message);
+		g_error_free(error);
+	}
+
+	g_free(filename);
+	g_byte_array_free(contents, TRUE);
+}
+
+static gboolean
+cache_load(GtkVlcFrameIndex *index, const gchar *file, const gchar *cache_dir)
+{
+	const FrameIndexHeader *header;
+	GMappedFile *mapped;
+	gchar *filename;
+	gint64 size, mtime;
+	gsize length;
+	gboolean ret = FALSE;
+
+	if (cache_dir == NULL || !stat_file(file, &size, &mtime))
+		return FALSE;
+
+	filename = cache_filename(file, cache_dir);
+	mapped = g_mapped_file_new(filename, FALSE, NULL);
+	g_free(filename);
+	if (mapped == NULL)
+		return FALSE;
+
+	length = g_mapped_file_get_length(mapped);
+	header = (const FrameIndexHeader *)g_mapped_file_get_contents(mapped);
+
+	if (length >= sizeof(FrameIndexHeader) &&
+	    !memcmp(header->magic, FRAME_INDEX_MAGIC, sizeof(header->magic)) &&
+	    header->version == FRAME_INDEX_VERSION &&
+	    header->byte_order == FRAME_INDEX_BYTE_ORDER &&
+	    header->size == size && header->mtime == mtime &&
+	    length >= sizeof(FrameIndexHeader) +
+		      ((gsize)header->n_frames +
+		       header->n_keyframes)*sizeof(gint64)) {
+		const gint64 *times = (const gint64 *)(header + 1);
+
+		g_array_append_vals(index->frames, times, header->n_frames);
+		g_array_append_vals(index->keyframes, times + header->n_frames,
+				    header->n_keyframes);
+		index->complete = TRUE;
+		ret = TRUE;
+	}
+
+	g_mapped_file_unref(mapped);
+	return ret;
+}
+
+static GtkVlcFrameIndex *
+frame_index_ref(GtkVlcFrameIndex *index)
+{
+	g_atomic_int_inc(&index->ref_count);
+	return index;
+}
+
+static void
+frame_index_unref(GtkVlcFrameIndex *index)
+{
+	if (!g_atomic_int_dec_and_test(&index->ref_count))
+		return;
+
+	g_object_unref(index->cancellable);
+	g_mutex_free(index->mutex);
+	g_array_free(index->frames, TRUE);
+	g_array_free(index->keyframes, TRUE);
+	g_free(index);
+}
+
+/**
+ * @brief Insert time into sorted array.
+ *
+ * Times are mostly appended, so the insertion point is searched
+ * from the end.
+ */
+static void
+times_insert(GArray *times, gint64 time)
+{
+	guint i = times->len;
+
+	while (i > 0 && g_array_index(times, gint64, i - 1) > time)
+		i--;
+	if (i > 0 && g_array_index(times, gint64, i - 1) == time)
+		return;
+
+	g_array_insert_val(times, i, time);
+}
+
+/**
+ * @brief Find the latest time not after \e time in sorted array.
+ *
+ * @return Position in \e times or -1 if all times are after \e time
+ */
+static gint
+times_find(GArray *times, gint64 time)
+{
+	gint lo = 0, hi = (gint)times->len;
+
+	while (lo < hi) {
+		gint mid = (lo + hi)/2;
+
+		if (g_array_index(times, gint64, mid) <= time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo - 1;
+}
+
+/**
+ * @brief Check whether a packet of an Annex B elementary stream
+ * contains a random access point.
+ *
+ * H.264 IDR slices and H.265 IRAP pictures are detected.
+ * For other codecs, no keyframes are indexed.
+ */
+static gboolean
+is_keyframe(guint32 codec, const guint8 *data, gsize size)
+{
+	for (gsize i = 0; i + 3 < size; i++) {
+		guint type;
+
+		if (data[i] != 0 || data[i+1] != 0 || data[i+2] != 1)
+			continue;
+		i += 3;
+
+		switch (codec) {
+		case FOURCC('h','2','6','4'):
+			type = data[i] & 0x1F;
+			if (type == 5)
+				return TRUE;
+			break;
+		case FOURCC('h','e','v','c'):
+			type = (data[i] >> 1) & 0x3F;
+			if (type >= 16 && type <= 21)
+				return TRUE;
+			break;
+		default:
+			return FALSE;
+		}
+	}
+
+	return FALSE;
+}
+
+/*
+ * libVLC stream output callbacks, invoked by the smem module.
+ * Without transcoding, smem passes on the packets of the elementary
+ * stream, so nothing is decoded.
+ */
+static void
+smem_prerender_cb(void *data, uint8_t **buffer, size_t size)
+{
+	BuildJob *job = data;
+
+	if (size > job->es_size) {
+		job->es = g_realloc(job->es, size);
+		job->es_size = size;
+	}
+	*buffer = job->es;
+}
+
+static void
+smem_postrender_cb(void *data, uint8_t *buffer, int width, int height,
+		   int pixel_pitch, size_t size, int64_t pts)
+{
+	BuildJob *job = data;
+	GtkVlcFrameIndex *index = job->index;
+	gboolean keyframe;
+
+	/* libVLC timestamps start at 1, 0 is invalid */
+	if (pts <= 0)
+		return;
+	pts--;
+
+	keyframe = is_keyframe(job->codec, buffer, size);
+	job->latest = MAX(job->latest, pts);
+
+	g_mutex_lock(index->mutex);
+	times_insert(index->frames, pts);
+	if (keyframe)
+		times_insert(index->keyframes, pts);
+	index->indexed = job->latest - REORDER_MARGIN;
+	g_mutex_unlock(index->mutex);
+}
+
+static void
+build_event_cb(const struct libvlc_event_t *event, void *user_data)
+{
+	BuildJob *job = user_data;
+
+	g_mutex_lock(job->mutex);
+	job->done = TRUE;
+	job->failed = event->type == libvlc_MediaPlayerEncounteredError;
+	g_cond_signal(job->cond);
+	g_mutex_unlock(job->mutex);
+}
+
+static void
+build_demux(BuildJob *job)
+{
+	static const libvlc_event_type_t events[] = {
+		libvlc_MediaPlayerEndReached,
+		libvlc_MediaPlayerEncounteredError
+	};
+
+	libvlc_instance_t *vlc_inst;
+	libvlc_media_t *media;
+	libvlc_media_player_t *media_player;
+	libvlc_event_manager_t *evman;
+	GtkVlcMediaInfo info;
+	gint64 size, mtime;
+	gchar *sout;
+	gboolean cancelled;
+
+	if (g_cancellable_is_cancelled(job->index->cancellable) ||
+	    !stat_file(job->file, &size, &mtime))
+		return;
+
+	vlc_inst = _gtk_vlc_instance_pool_acquire(NULL);
+	if (vlc_inst == NULL)
+		return;
+
+	media = libvlc_media_new_path(vlc_inst, (const char *)job->file);
+	if (media == NULL) {
+		_gtk_vlc_instance_pool_release(vlc_inst);
+		return;
+	}
+	libvlc_media_parse(media);
+	_gtk_vlc_media_info_from_media(media, &info);
+	job->codec = info.video_codec;
+
+	sout = g_strdup_printf(":sout=#smem{"
+			       "video-prerender-callback=%" G_GINT64_FORMAT ","
+			       "video-postrender-callback=%" G_GINT64_FORMAT ","
+			       "video-data=%" G_GINT64_FORMAT ",time-sync=false}",
+			       (gint64)(gintptr)smem_prerender_cb,
+			       (gint64)(gintptr)smem_postrender_cb,
+			       (gint64)(gintptr)job);
+	libvlc_media_add_option(media, sout);
+	g_free(sout);
+	libvlc_media_add_option(media, ":no-sout-audio");
+	libvlc_media_add_option(media, ":no-sout-spu");
+
+	media_player = libvlc_media_player_new_from_media(media);
+	evman = libvlc_media_player_event_manager(media_player);
+	for (guint i = 0; i < G_N_ELEMENTS(events); i++)
+		libvlc_event_attach(evman, events[i], build_event_cb, job);
+
+	libvlc_media_player_play(media_player);
+
+	g_mutex_lock(job->mutex);
+	while (!job->done && !g_cancellable_is_cancelled(job->index->cancellable)) {
+		GTimeVal until;
+
+		g_get_current_time(&until);
+		g_time_val_add(&until, CANCEL_POLL_INTERVAL*1000);
+		g_cond_timed_wait(job->cond, job->mutex, &until);
+	}
+	cancelled = !job->done;
+	g_mutex_unlock(job->mutex);
+
+	/* no callbacks are invoked after stopping */
+	libvlc_media_player_stop(media_player);
+	for (guint i = 0; i < G_N_ELEMENTS(events); i++)
+		libvlc_event_detach(evman, events[i], build_event_cb, job);
+	libvlc_media_player_release(media_player);
+	libvlc_media_release(media);
+	_gtk_vlc_instance_pool_release(vlc_inst);
+
+	if (cancelled || job->failed) {
+		if (job->failed)
+			g_warning("Cannot index frames of \"%s\"", job->file);
+		return;
+	}
+
+	g_mutex_lock(job->index->mutex);
+	job->index->complete = TRUE;
+	g_mutex_unlock(job->index->mutex);
+
+	if (job->cache_dir != NULL)
+		cache_save(job, size, mtime);
+}
+
+static void
+build_pool_worker(gpointer data, gpointer user_data)
+{
+	BuildJob *job = data;
+
+	build_demux(job);
+
+	frame_index_unref(job->index);
+	g_free(job->es);
+	g_mutex_free(job->mutex);
+	g_cond_free(job->cond);
+	g_free(job->cache_dir);
+	g_free(job->file);
+	g_free(job);
+}
+
+/*
+ * API
+ */
+
+/**
+ * @brief Get the frame index of a media file
+ *
+ * If there is a fresh cache entry for \e file (i.e. size and modification
+ * time of \e file have not changed since it was indexed), it is loaded
+ * immediately. Otherwise the index is built in the background by
+ * demultiplexing the first video track on a worker pool of bounded size.
+ * It can be used while it is being built, covering an increasing part of
+ * the media. Once complete, it is saved to \e cache_dir.
+ *
+ * Keyframes are only indexed for H.264 and H.265 video.
+ * All functions operating on the index are thread-safe.
+ *
+ * @param file      Filename of media
+ * @param cache_dir Directory of frame index cache files, \c NULL to
+ *                  disable caching
+ * @return Frame index, to be freed with \ref gtk_vlc_frame_index_free
+ */
+GtkVlcFrameIndex *
+gtk_vlc_frame_index_new(const gchar *file, const gchar *cache_dir)
+{
+	GtkVlcFrameIndex *index = g_new0(GtkVlcFrameIndex, 1);
+	BuildJob *job;
+
+	index->ref_count = 1;
+	index->cancellable = g_cancellable_new();
+	index->mutex = g_mutex_new();
+	index->frames = g_array_new(FALSE, FALSE, sizeof(gint64));
+	index->keyframes = g_array_new(FALSE, FALSE, sizeof(gint64));
+	index->indexed = -1;
+
+	if (cache_load(index, file, cache_dir))
+		return index;
+
+	job = g_new0(BuildJob, 1);
+	job->index = frame_index_ref(index);
+	job->file = g_strdup(file);
+	job->cache_dir = g_strdup(cache_dir);
+	job->mutex = g_mutex_new();
+	job->cond = g_cond_new();
+
+	if (g_once_init_enter(&build_pool_initialized)) {
+		build_pool = g_thread_pool_new(build_pool_worker, NULL,
+					       BUILD_MAX_WORKERS, FALSE, NULL);
+		g_once_init_leave(&build_pool_initialized, 1);
+	}
+	g_thread_pool_push(build_pool, job, NULL);
+
+	return index;
+}
+
+/**
+ * @brief Free frame index
+ *
+ * Building the index is cancelled if it is not yet complete.
+ *
+ * @param index Frame index
+ */
+void
+gtk_vlc_frame_index_free(GtkVlcFrameIndex *index)
+{
+	g_cancellable_cancel(index->cancellable);
+	frame_index_unref(index);
+}
+
+/**
+ * @brief Get whether all frames of the media are indexed
+ *
+ * @param index Frame index
+ * @return \c TRUE if the index is complete
+ */
+gboolean
+gtk_vlc_frame_index_is_complete(GtkVlcFrameIndex *index)
+{
+	gboolean complete;
+
+	g_mutex_lock(index->mutex);
+	complete = index->complete;
+	g_mutex_unlock(index->mutex);
+
+	return complete;
+}
+
+/**
+ * @brief Get number of frames indexed so far
+ *
+ * @param index Frame index
+ * @return Number of frames
+ */
+guint
+gtk_vlc_frame_index_get_n_frames(GtkVlcFrameIndex *index)
+{
+	guint n;
+
+	g_mutex_lock(index->mutex);
+	n = index->frames->len;
+	g_mutex_unlock(index->mutex);
+
+	return n;
+}
+
+/**
+ * @brief Get number of keyframes indexed so far
+ *
+ * @param index Frame index
+ * @return Number of keyframes
+ */
+guint
+gtk_vlc_frame_index_get_n_keyframes(GtkVlcFrameIndex *index)
+{
+	guint n;
+
+	g_mutex_lock(index->mutex);
+	n = index->keyframes->len;
+	g_mutex_unlock(index->mutex);
+
+	return n;
+}
+
+/**
+ * @brief Look up the frame displayed at a playback time
+ *
+ * Frame times are rounded up to milliseconds, so seeking to
+ * \e frame_time displays exactly that frame.
+ *
+ * @param index         Frame index
+ * @param time          Playback time (milliseconds)
+ * @param frame_time    Location to store the start time of the frame
+ *                      displayed at \e time in (milliseconds)
+ * @param keyframe_time Location to store the time of the nearest
+ *                      keyframe not after that frame in (milliseconds),
+ *                      or -1 if there is none. May be \c NULL.
+ * @return \c TRUE on success, \c FALSE if \e time is not (yet) indexed
+ */
+gboolean
+gtk_vlc_frame_index_lookup(GtkVlcFrameIndex *index, gint64 time,
+			   gint64 *frame_time, gint64 *keyframe_time)
+{
+	gint64 frame;
+	gint i;
+
+	g_mutex_lock(index->mutex);
+
+	if (!index->complete && time*1000 >= index->indexed) {
+		g_mutex_unlock(index->mutex);
+		return FALSE;
+	}
+
+	i = times_find(index->frames, time*1000);
+	if (i < 0) {
+		g_mutex_unlock(index->mutex);
+		return FALSE;
+	}
+	frame = g_array_index(index->frames, gint64, i);
+	*frame_time = (frame + 999)/1000;
+
+	if (keyframe_time != NULL) {
+		i = times_find(index->keyframes, frame);
+		*keyframe_time = i < 0 ? -1
+				       : (g_array_index(index->keyframes,
+							gint64, i) + 999)/1000;
+	}
+
+	g_mutex_unlock(index->mutex);
+	return TRUE;
+}
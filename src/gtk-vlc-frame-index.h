@@ -0,0 +1,50 @@
+/**
+ * @file
+ * Header file for GtkVlcFrameIndex, indexes of the video frame and
+ * keyframe positions of media files (for frame-accurate seeking).
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_VLC_FRAME_INDEX_H
+#define __GTK_VLC_FRAME_INDEX_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Opaque frame index structure
+ */
+typedef struct _GtkVlcFrameIndex GtkVlcFrameIndex;
+
+GtkVlcFrameIndex *gtk_vlc_frame_index_new(const gchar *file,
+					  const gchar *cache_dir);
+void gtk_vlc_frame_index_free(GtkVlcFrameIndex *index);
+
+gboolean gtk_vlc_frame_index_is_complete(GtkVlcFrameIndex *index);
+guint gtk_vlc_frame_index_get_n_frames(GtkVlcFrameIndex *index);
+guint gtk_vlc_frame_index_get_n_keyframes(GtkVlcFrameIndex *index);
+
+gboolean gtk_vlc_frame_index_lookup(GtkVlcFrameIndex *index, gint64 time,
+				    gint64 *frame_time, gint64 *keyframe_time);
+
+G_END_DECLS
+
+#endif
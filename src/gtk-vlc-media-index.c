@@ -0,0 +1,757 @@
+/**
+ * @file
+ * Persistent media metadata index.
+ * Metadata (duration, tracks, codecs, resolution, frame rate) of media
+ * files is cached keyed by path, size and modification time, so files do not
+ * have to be parsed by libVLC again. The index is stored in a compact
+ * binary file that is memory-mapped when loading. Many files can be probed
+ * concurrently on a bounded worker pool.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <vlc/vlc.h>
+#include <vlc/libvlc_version.h>
+
+#include "gtk-vlc-media-index.h"
+#include "gtk-vlc-player-private.h"
+
+/** @private */
+#define INDEX_MAGIC		"GVLCIDX"
+/** @private */
+#define INDEX_VERSION		1
+/** @private */
+#define INDEX_BYTE_ORDER	0x01020304
+
+/** @private */
+#define PROBE_MAX_WORKERS	4
+
+/**
+ * @private
+ * Header of the on-disk index.
+ * It is followed by \e n_records records sorted by path and the string
+ * pool containing the (null-terminated) paths.
+ * All values are in host byte order, which is verified by \e byte_order.
+ */
+typedef struct {
+	gchar	magic[8];
+	guint32	version;
+	guint32	byte_order;
+	guint32	n_records;
+	guint32	pool_size;
+} IndexHeader;
+
+/** @private */
+typedef struct {
+	guint32	path_offset;	/**< Offset of path in string pool */
+	guint32	path_len;	/**< Length of path without terminator */
+
+	gint64	size;
+	gint64	mtime;
+
+	gint64	duration;
+	guint32	video_codec;
+	guint32	audio_codec;
+	guint32	width;
+	guint32	height;
+	guint32	fps_mhz;	/**< Frame rate in millihertz */
+	guint16	video_tracks;
+	guint16	audio_tracks;
+	guint16	subtitle_tracks;
+	guint16	reserved[3];
+} IndexRecord;
+
+/**
+ * @private
+ * Entry that was probed since the index was loaded
+ */
+typedef struct {
+	gint64		size;
+	gint64		mtime;
+	GtkVlcMediaInfo	info;
+} IndexEntry;
+
+/** @private */
+struct _GtkVlcMediaIndex {
+	gchar			*filename;
+
+	/** protects all of the following */
+	GMutex			*mutex;
+
+	GMappedFile		*mapped;
+	const IndexHeader	*header;
+	const IndexRecord	*records;
+	const gchar		*pool;
+
+	GHashTable		*entries;	/**< path to IndexEntry */
+
+	libvlc_instance_t	*vlc_inst;
+	GThreadPool		*probe_pool;
+};
+
+/**
+ * @private
+ * Batch of files probed by \ref gtk_vlc_media_index_probe_async
+ */
+typedef struct {
+	GtkVlcMediaIndex	*index;
+	GSimpleAsyncResult	*result;
+	GCancellable		*cancellable;
+	volatile gint		pending;
+} ProbeBatch;
+
+/** @private */
+typedef struct {
+	ProbeBatch	*batch;
+	gchar		*file;
+} ProbeJob;
+
+static gboolean index_map(GtkVlcMediaIndex *index);
+static gint record_compare_path(const GtkVlcMediaIndex *index,
+				const IndexRecord *record, const gchar *file);
+static const IndexRecord *index_find_record(GtkVlcMediaIndex *index,
+					    const gchar *file);
+static void record_to_info(const IndexRecord *record, GtkVlcMediaInfo *info);
+static gboolean stat_file(const gchar *file, gint64 *size, gint64 *mtime);
+static void probe_pool_worker(gpointer data, gpointer user_data);
+
+static gboolean
+index_map(GtkVlcMediaIndex *index)
+{
+	const IndexHeader *header;
+	gsize length;
+
+	index->mapped = g_mapped_file_new(index->filename, FALSE, NULL);
+	if (index->mapped == NULL)
+		return FALSE;
+
+	length = g_mapped_file_get_length(index->mapped);
+	header = (const IndexHeader *)g_mapped_file_get_contents(index->mapped);
+
+	if (length < sizeof(IndexHeader) ||
+	    memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) ||
+	    header->version != INDEX_VERSION ||
+	    header->byte_order != INDEX_BYTE_ORDER ||
+	    length < sizeof(IndexHeader) +
+		     (gsize)header->n_records*sizeof(IndexRecord) +
+		     header->pool_size) {
+		g_warning("Ignoring invalid media index \"%s\"", index->filename);
+		g_mapped_file_unref(index->mapped);
+		index->mapped = NULL;
+		return FALSE;
+	}
+
+	index->header = header;
+	index->records = (const IndexRecord *)(header + 1);
+	index->pool = (const gchar *)(index->records + header->n_records);
+
+	return TRUE;
+}
+
+static gint
+record_compare_path(const GtkVlcMediaIndex *index, const IndexRecord *record,
+		    const gchar *file)
+{
+	gint ret;
+
+	if ((gsize)record->path_offset + record->path_len >= index->header->pool_size)
+		/* corrupted record: sort it first, it never matches */
+		return -1;
+
+	ret = strncmp(index->pool + record->path_offset, file, record->path_len);
+	if (ret)
+		return ret;
+
+	return file[record->path_len] == '\0' ? 0 : -1;
+}
+
+static const IndexRecord *
+index_find_record(GtkVlcMediaIndex *index, const gchar *file)
+{
+	guint32 low = 0, high;
+
+	if (index->mapped == NULL)
+		return NULL;
+
+	high = index->header->n_records;
+	while (low < high) {
+		guint32 mid = low + (high - low)/2;
+		gint cmp = record_compare_path(index, index->records + mid, file);
+
+		if (cmp == 0)
+			return index->records + mid;
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return NULL;
+}
+
+static void
+record_to_info(const IndexRecord *record, GtkVlcMediaInfo *info)
+{
+	info->duration = record->duration;
+	info->video_tracks = record->video_tracks;
+	info->audio_tracks = record->audio_tracks;
+	info->subtitle_tracks = record->subtitle_tracks;
+	info->video_codec = record->video_codec;
+	info->audio_codec = record->audio_codec;
+	info->width = record->width;
+	info->height = record->height;
+	info->fps = (gdouble)record->fps_mhz / 1000.;
+}
+
+static gboolean
+stat_file(const gchar *file, gint64 *size, gint64 *mtime)
+{
+	GStatBuf st;
+
+	if (g_stat(file, &st))
+		return FALSE;
+
+	*size = (gint64)st.st_size;
+	*mtime = (gint64)st.st_mtime;
+	return TRUE;
+}
+
+/**
+ * @private
+ * @brief Fill media info from a parsed libVLC media.
+ *
+ * @param media Parsed libVLC media
+ * @param info  Media info to fill
+ */
+void
+_gtk_vlc_media_info_from_media(libvlc_media_t *media, GtkVlcMediaInfo *info)
+{
+	memset(info, 0, sizeof(*info));
+	info->duration = (gint64)libvlc_media_get_duration(media);
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2,1,0,0)
+	{
+		libvlc_media_track_t **tracks;
+		unsigned n_tracks = libvlc_media_tracks_get(media, &tracks);
+
+		for (unsigned i = 0; i < n_tracks; i++) {
+			switch (tracks[i]->i_type) {
+			case libvlc_track_video:
+				if (!info->video_tracks++) {
+					libvlc_video_track_t *video = tracks[i]->video;
+
+					info->video_codec = tracks[i]->i_codec;
+					info->width = video->i_width;
+					info->height = video->i_height;
+					if (video->i_frame_rate_den)
+						info->fps = (gdouble)video->i_frame_rate_num /
+							    video->i_frame_rate_den;
+				}
+				break;
+			case libvlc_track_audio:
+				if (!info->audio_tracks++)
+					info->audio_codec = tracks[i]->i_codec;
+				break;
+			case libvlc_track_text:
+				info->subtitle_tracks++;
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (n_tracks > 0)
+			libvlc_media_tracks_release(tracks, n_tracks);
+	}
+#else
+	{
+		libvlc_media_track_info_t *tracks = NULL;
+		int n_tracks = libvlc_media_get_tracks_info(media, &tracks);
+
+		for (int i = 0; i < n_tracks; i++) {
+			switch (tracks[i].i_type) {
+			case libvlc_track_video:
+				if (!info->video_tracks++) {
+					info->video_codec = tracks[i].i_codec;
+					info->width = tracks[i].u.video.i_width;
+					info->height = tracks[i].u.video.i_height;
+				}
+				break;
+			case libvlc_track_audio:
+				if (!info->audio_tracks++)
+					info->audio_codec = tracks[i].i_codec;
+				break;
+			case libvlc_track_text:
+				info->subtitle_tracks++;
+				break;
+			default:
+				break;
+			}
+		}
+
+		libvlc_free(tracks);
+	}
+#endif
+}
+
+/**
+ * @private
+ * @brief Add or update index entry for a file.
+ *
+ * The file's current size and modification time are used as the key.
+ * This function is thread-safe.
+ *
+ * @param index Media index
+ * @param file  Filename of media the info belongs to
+ * @param info  Media info to store
+ */
+void
+_gtk_vlc_media_index_insert(GtkVlcMediaIndex *index, const gchar *file,
+			    const GtkVlcMediaInfo *info)
+{
+	IndexEntry *entry = g_new(IndexEntry, 1);
+
+	if (!stat_file(file, &entry->size, &entry->mtime)) {
+		g_free(entry);
+		return;
+	}
+	entry->info = *info;
+
+	g_mutex_lock(index->mutex);
+	g_hash_table_replace(index->entries, g_strdup(file), entry);
+	g_mutex_unlock(index->mutex);
+}
+
+/*
+ * API
+ */
+
+/**
+ * @private
+ * @brief Get directory for caches kept next to the index.
+ *
+ * Data derived from media files that is too large for the index itself
+ * (like frame indexes) is cached in this directory.
+ *
+ * @param index Media index
+ * @return Newly allocated directory name or \c NULL if the index is
+ *         only kept in memory
+ */
+gchar *
+_gtk_vlc_media_index_get_cache_dir(GtkVlcMediaIndex *index)
+{
+	if (index->filename == NULL)
+		return NULL;
+
+	return g_strconcat(index->filename, ".cache", NULL);
+}
+
+/**
+ * @brief Create new media index
+ *
+ * If \e filename exists, it is memory-mapped, so loading even large indexes
+ * is cheap.
+ *
+ * @param filename File to load index from and save it to
+ *                 (may be \c NULL for an index that is only kept in memory)
+ * @return New media index, to be freed with \ref gtk_vlc_media_index_free
+ */
+GtkVlcMediaIndex *
+gtk_vlc_media_index_new(const gchar *filename)
+{
+	GtkVlcMediaIndex *index = g_new0(GtkVlcMediaIndex, 1);
+
+	index->filename = g_strdup(filename);
+	index->mutex = g_mutex_new();
+	index->entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+					       g_free, g_free);
+
+	if (filename != NULL)
+		index_map(index);
+
+	return index;
+}
+
+/**
+ * @brief Free media index
+ *
+ * Waits for pending probes to finish.
+ * Changes that have not been saved with \ref gtk_vlc_media_index_save
+ * are lost.
+ *
+ * @param index Media index
+ */
+void
+gtk_vlc_media_index_free(GtkVlcMediaIndex *index)
+{
+	if (index->probe_pool != NULL)
+		g_thread_pool_free(index->probe_pool, FALSE, TRUE);
+	if (index->vlc_inst != NULL)
+		_gtk_vlc_instance_pool_release(index->vlc_inst);
+
+	g_hash_table_destroy(index->entries);
+	if (index->mapped != NULL)
+		g_mapped_file_unref(index->mapped);
+	g_mutex_free(index->mutex);
+	g_free(index->filename);
+
+	g_free(index);
+}
+
+/**
+ * @brief Look up media metadata in the index
+ *
+ * The index entry is only used when it is fresh, i.e. when size and
+ * modification time of \e file have not changed since it was probed.
+ * This function is thread-safe.
+ *
+ * @param index Media index
+ * @param file  Filename of media to look up
+ * @param info  Location to store metadata in (may be \c NULL)
+ * @return \c TRUE if a fresh entry was found, else \c FALSE
+ */
+gboolean
+gtk_vlc_media_index_lookup(GtkVlcMediaIndex *index, const gchar *file,
+			   GtkVlcMediaInfo *info)
+{
+	const IndexEntry *entry;
+	const IndexRecord *record;
+	gint64 size, mtime;
+	gboolean ret = FALSE;
+
+	if (!stat_file(file, &size, &mtime))
+		return FALSE;
+
+	g_mutex_lock(index->mutex);
+
+	entry = g_hash_table_lookup(index->entries, file);
+	if (entry != NULL) {
+		if (entry->size == size && entry->mtime == mtime) {
+			if (info != NULL)
+				*info = entry->info;
+			ret = TRUE;
+		}
+	} else if ((record = index_find_record(index, file)) != NULL) {
+		if (record->size == size && record->mtime == mtime) {
+			if (info != NULL)
+				record_to_info(record, info);
+			ret = TRUE;
+		}
+	}
+
+	g_mutex_unlock(index->mutex);
+
+	return ret;
+}
+
+/**
+ * @brief Get media metadata, parsing the media if necessary
+ *
+ * If there is no fresh index entry for \e file, it is parsed synchronously
+ * and the index is updated.
+ * This function is thread-safe.
+ *
+ * @param index Media index
+ * @param file  Filename of media to probe
+ * @param info  Location to store metadata in (may be \c NULL)
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_media_index_probe(GtkVlcMediaIndex *index, const gchar *file,
+			  GtkVlcMediaInfo *info)
+{
+	GtkVlcMediaInfo probed;
+	libvlc_instance_t *vlc_inst;
+	libvlc_media_t *media;
+	gboolean ret;
+
+	if (gtk_vlc_media_index_lookup(index, file, info))
+		return TRUE;
+
+	g_mutex_lock(index->mutex);
+	if (index->vlc_inst == NULL)
+		index->vlc_inst = _gtk_vlc_instance_pool_acquire(NULL);
+	vlc_inst = index->vlc_inst;
+	g_mutex_unlock(index->mutex);
+
+	if (vlc_inst == NULL)
+		return FALSE;
+
+	media = libvlc_media_new_path(vlc_inst, (const char *)file);
+	if (media == NULL)
+		return FALSE;
+
+	libvlc_media_parse(media);
+	ret = libvlc_media_is_parsed(media);
+	if (ret) {
+		_gtk_vlc_media_info_from_media(media, &probed);
+		_gtk_vlc_media_index_insert(index, file, &probed);
+		if (info != NULL)
+			*info = probed;
+	}
+
+	libvlc_media_release(media);
+	return ret;
+}
+
+static void
+probe_pool_worker(gpointer data, gpointer user_data)
+{
+	ProbeJob *job = data;
+	ProbeBatch *batch = job->batch;
+
+	if (!g_cancellable_is_cancelled(batch->cancellable))
+		gtk_vlc_media_index_probe(batch->index, job->file, NULL);
+
+	if (g_atomic_int_dec_and_test(&batch->pending)) {
+		if (g_cancellable_is_cancelled(batch->cancellable))
+			g_simple_async_result_set_error(batch->result,
+							G_IO_ERROR,
+							G_IO_ERROR_CANCELLED,
+							"Probing was cancelled");
+		else
+			g_simple_async_result_set_op_res_gboolean(batch->result,
+								  TRUE);
+		g_simple_async_result_complete_in_idle(batch->result);
+
+		g_object_unref(batch->result);
+		if (batch->cancellable != NULL)
+			g_object_unref(batch->cancellable);
+		g_free(batch);
+	}
+
+	g_free(job->file);
+	g_free(job);
+}
+
+/**
+ * @brief Probe many media files concurrently
+ *
+ * All files without fresh index entries are parsed on a worker pool
+ * of bounded size, updating the index.
+ * \e callback is invoked on the main loop when all files have been probed.
+ * Files that cannot be parsed are silently skipped.
+ * The index must not be freed before the operation has finished.
+ *
+ * @param index       Media index
+ * @param files       \c NULL-terminated array of filenames to probe
+ * @param cancellable Optional \e GCancellable object, \c NULL to ignore
+ * @param callback    Callback to invoke when the request is satisfied
+ * @param user_data   The data to pass to \e callback
+ */
+void
+gtk_vlc_media_index_probe_async(GtkVlcMediaIndex *index,
+				const gchar *const *files,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer user_data)
+{
+	ProbeBatch *batch;
+	guint n_files = g_strv_length((gchar **)files);
+
+	batch = g_new(ProbeBatch, 1);
+	batch->index = index;
+	batch->result = g_simple_async_result_new(NULL, callback, user_data,
+						  gtk_vlc_media_index_probe_async);
+	batch->cancellable = cancellable != NULL ? g_object_ref(cancellable)
+						 : NULL;
+	batch->pending = (gint)n_files;
+
+	if (n_files == 0) {
+		g_simple_async_result_set_op_res_gboolean(batch->result, TRUE);
+		g_simple_async_result_complete_in_idle(batch->result);
+		g_object_unref(batch->result);
+		if (batch->cancellable != NULL)
+			g_object_unref(batch->cancellable);
+		g_free(batch);
+		return;
+	}
+
+	g_mutex_lock(index->mutex);
+	if (index->probe_pool == NULL)
+		index->probe_pool = g_thread_pool_new(probe_pool_worker, NULL,
+						      PROBE_MAX_WORKERS,
+						      FALSE, NULL);
+	g_mutex_unlock(index->mutex);
+
+	for (guint i = 0; i < n_files; i++) {
+		ProbeJob *job = g_new(ProbeJob, 1);
+
+		job->batch = batch;
+		job->file = g_strdup(files[i]);
+		g_thread_pool_push(index->probe_pool, job, NULL);
+	}
+}
+
+/**
+ * @brief Finish probing started with \ref gtk_vlc_media_index_probe_async
+ *
+ * @param index  Media index
+ * @param result \e GAsyncResult passed to the callback
+ * @param error  Return location for a \e GError, or \c NULL
+ * @return \c TRUE on success, \c FALSE if the operation was cancelled
+ */
+gboolean
+gtk_vlc_media_index_probe_finish(GtkVlcMediaIndex *index, GAsyncResult *result,
+				 GError **error)
+{
+	GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT(result);
+
+	if (g_simple_async_result_propagate_error(simple, error))
+		return FALSE;
+
+	return g_simple_async_result_get_op_res_gboolean(simple);
+}
+
+/** @private */
+typedef struct {
+	const gchar	*path;
+	IndexRecord	record;
+} SaveRecord;
+
+static gint
+save_record_compare(gconstpointer a, gconstpointer b)
+{
+	return strcmp(((const SaveRecord *)a)->path,
+		      ((const SaveRecord *)b)->path);
+}
+
+/**
+ * @brief Save media index to its file
+ *
+ * Entries probed since loading are merged with the loaded ones and the file
+ * is replaced atomically. The new file is mapped afterwards.
+ * This function is thread-safe.
+ *
+ * @param index Media index
+ * @param error Return location for a \e GError, or \c NULL
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_media_index_save(GtkVlcMediaIndex *index, GError **error)
+{
+	GArray *records;
+	GString *pool;
+	GByteArray *contents;
+	IndexHeader header;
+	GHashTableIter iter;
+	gpointer key, value;
+	gboolean ret;
+
+	if (index->filename == NULL)
+		return TRUE;
+
+	g_mutex_lock(index->mutex);
+
+	records = g_array_new(FALSE, FALSE, sizeof(SaveRecord));
+
+	if (index->mapped != NULL) {
+		for (guint32 i = 0; i < index->header->n_records; i++) {
+			SaveRecord save;
+
+			save.record = index->records[i];
+			if ((gsize)save.record.path_offset + save.record.path_len >=
+			    index->header->pool_size)
+				continue;
+			save.path = index->pool + save.record.path_offset;
+			if (g_hash_table_lookup(index->entries, save.path) == NULL)
+				g_array_append_val(records, save);
+		}
+	}
+
+	g_hash_table_iter_init(&iter, index->entries);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		const IndexEntry *entry = value;
+		SaveRecord save;
+
+		memset(&save.record, 0, sizeof(save.record));
+		save.path = key;
+		save.record.size = entry->size;
+		save.record.mtime = entry->mtime;
+		save.record.duration = entry->info.duration;
+		save.record.video_codec = entry->info.video_codec;
+		save.record.audio_codec = entry->info.audio_codec;
+		save.record.width = entry->info.width;
+		save.record.height = entry->info.height;
+		save.record.fps_mhz = (guint32)(entry->info.fps*1000. + .5);
+		save.record.video_tracks = (guint16)entry->info.video_tracks;
+		save.record.audio_tracks = (guint16)entry->info.audio_tracks;
+		save.record.subtitle_tracks = (guint16)entry->info.subtitle_tracks;
+		g_array_append_val(records, save);
+	}
+
+	g_array_sort(records, save_record_compare);
+
+	pool = g_string_new(NULL);
+	for (guint i = 0; i < records->len; i++) {
+		SaveRecord *save = &g_array_index(records, SaveRecord, i);
+
+		save->record.path_offset = (guint32)pool->len;
+		save->record.path_len = (guint32)strlen(save->path);
+		g_string_append_len(pool, save->path, save->record.path_len + 1);
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+	header.version = INDEX_VERSION;
+	header.byte_order = INDEX_BYTE_ORDER;
+	header.n_records = records->len;
+	header.pool_size = (guint32)pool->len;
+
+	contents = g_byte_array_sized_new(sizeof(header) +
+					  records->len*sizeof(IndexRecord) +
+					  pool->len);
+	g_byte_array_append(contents, (const guint8 *)&header, sizeof(header));
+	for (guint i = 0; i < records->len; i++)
+		g_byte_array_append(contents,
+				    (const guint8 *)&g_array_index(records, SaveRecord, i).record,
+				    sizeof(IndexRecord));
+	g_byte_array_append(contents, (const guint8 *)pool->str, pool->len);
+
+	/* paths point into the mapping and hash table, so write before unmapping */
+	ret = g_file_set_contents(index->filename, (const gchar *)contents->data,
+				  (gssize)contents->len, error);
+
+	g_byte_array_free(contents, TRUE);
+	g_string_free(pool, TRUE);
+	g_array_free(records, TRUE);
+
+	if (ret) {
+		if (index->mapped != NULL)
+			g_mapped_file_unref(index->mapped);
+		index->mapped = NULL;
+		if (index_map(index))
+			g_hash_table_remove_all(index->entries);
+	}
+
+	g_mutex_unlock(index->mutex);
+
+	return ret;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file
+ * Header file of the persistent media metadata index, usable with
+ * \e GtkVlcPlayer widgets or on its own.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_VLC_MEDIA_INDEX_H
+#define __GTK_VLC_MEDIA_INDEX_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Metadata of a media file, as determined by parsing it with libVLC
+ */
+typedef struct {
+	gint64	duration;		/**< Length in milliseconds */
+
+	guint	video_tracks;		/**< Number of video tracks */
+	guint	audio_tracks;		/**< Number of audio tracks */
+	guint	subtitle_tracks;	/**< Number of subtitle tracks */
+
+	guint32	video_codec;		/**< FourCC of first video track */
+	guint32	audio_codec;		/**< FourCC of first audio track */
+
+	guint	width;			/**< Width of first video track */
+	guint	height;			/**< Height of first video track */
+	gdouble	fps;			/**< Frame rate (0 if unknown) */
+} GtkVlcMediaInfo;
+
+/**
+ * Opaque media metadata index structure
+ */
+typedef struct _GtkVlcMediaIndex GtkVlcMediaIndex;
+
+GtkVlcMediaIndex *gtk_vlc_media_index_new(const gchar *filename);
+void gtk_vlc_media_index_free(GtkVlcMediaIndex *index);
+
+gboolean gtk_vlc_media_index_lookup(GtkVlcMediaIndex *index, const gchar *file,
+				    GtkVlcMediaInfo *info);
+gboolean gtk_vlc_media_index_probe(GtkVlcMediaIndex *index, const gchar *file,
+				   GtkVlcMediaInfo *info);
+
+void gtk_vlc_media_index_probe_async(GtkVlcMediaIndex *index,
+				     const gchar *const *files,
+				     GCancellable *cancellable,
+				     GAsyncReadyCallback callback,
+				     gpointer user_data);
+gboolean gtk_vlc_media_index_probe_finish(GtkVlcMediaIndex *index,
+					  GAsyncResult *result,
+					  GError **error);
+
+gboolean gtk_vlc_media_index_save(GtkVlcMediaIndex *index, GError **error);
+
+G_END_DECLS
+
+#endif
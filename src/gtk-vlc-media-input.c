@@ -0,0 +1,270 @@
+/**
+ * @file
+ * Custom media input for \e GtkVlcPlayer widgets.
+ * Media is read from GInputStreams or memory via libVLC's media
+ * callbacks (libVLC 3.0 and later), so it never has to be written to
+ * temporary files.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <vlc/vlc.h>
+#include <vlc/libvlc_version.h>
+
+#include "gtk-vlc-player-private.h"
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3,0,0,0)
+
+/**
+ * @private
+ * Memory owned by a media.
+ * Every time libVLC opens the media, a separate BytesReader is created.
+ */
+typedef struct {
+	const guint8	*data;
+	gsize		size;
+	GDestroyNotify	destroy;
+	gpointer	destroy_data;
+} BytesSource;
+
+/** @private */
+typedef struct {
+	const BytesSource	*source;
+	gsize			pos;
+} BytesReader;
+
+static int bytes_open_cb(void *opaque, void **datap, uint64_t *sizep);
+static ssize_t bytes_read_cb(void *opaque, unsigned char *buf, size_t len);
+static int bytes_seek_cb(void *opaque, uint64_t offset);
+static void bytes_close_cb(void *opaque);
+static void bytes_media_freed_cb(const struct libvlc_event_t *event,
+				 void *user_data);
+
+static int stream_open_cb(void *opaque, void **datap, uint64_t *sizep);
+static ssize_t stream_read_cb(void *opaque, unsigned char *buf, size_t len);
+static int stream_seek_cb(void *opaque, uint64_t offset);
+static void stream_close_cb(void *opaque);
+static void stream_media_freed_cb(const struct libvlc_event_t *event,
+				  void *user_data);
+
+/*
+ * Memory input
+ */
+static int
+bytes_open_cb(void *opaque, void **datap, uint64_t *sizep)
+{
+	BytesReader *reader = g_new(BytesReader, 1);
+
+	reader->source = opaque;
+	reader->pos = 0;
+
+	*datap = reader;
+	*sizep = (uint64_t)reader->source->size;
+	return 0;
+}
+
+static ssize_t
+bytes_read_cb(void *opaque, unsigned char *buf, size_t len)
+{
+	BytesReader *reader = opaque;
+	gsize n = MIN(len, reader->source->size - reader->pos);
+
+	/* the only copy: straight from the mapping into libVLC's block */
+	memcpy(buf, reader->source->data + reader->pos, n);
+	reader->pos += n;
+
+	return (ssize_t)n;
+}
+
+static int
+bytes_seek_cb(void *opaque, uint64_t offset)
+{
+	BytesReader *reader = opaque;
+
+	if (offset > reader->source->size)
+		return -1;
+
+	reader->pos = (gsize)offset;
+	return 0;
+}
+
+static void
+bytes_close_cb(void *opaque)
+{
+	g_free(opaque);
+}
+
+static void
+bytes_media_freed_cb(const struct libvlc_event_t *event, void *user_data)
+{
+	BytesSource *source = user_data;
+
+	if (source->destroy != NULL)
+		source->destroy(source->destroy_data);
+	g_free(source);
+}
+
+/*
+ * GInputStream input.
+ * The stream is rewound whenever the media is opened again, so
+ * non-seekable streams can only be played once.
+ */
+static int
+stream_open_cb(void *opaque, void **datap, uint64_t *sizep)
+{
+	GInputStream *stream = G_INPUT_STREAM(opaque);
+	GSeekable *seekable = G_IS_SEEKABLE(stream) ? G_SEEKABLE(stream) : NULL;
+
+	*datap = stream;
+	*sizep = G_MAXUINT64;	/* unknown */
+
+	if (seekable == NULL || !g_seekable_can_seek(seekable))
+		return 0;
+
+	if (g_seekable_seek(seekable, 0, G_SEEK_END, NULL, NULL))
+		*sizep = (uint64_t)g_seekable_tell(seekable);
+
+	return g_seekable_seek(seekable, 0, G_SEEK_SET, NULL, NULL) ? 0 : -1;
+}
+
+static ssize_t
+stream_read_cb(void *opaque, unsigned char *buf, size_t len)
+{
+	/* blocking reads are fine, libVLC reads in its own threads */
+	return (ssize_t)g_input_stream_read(G_INPUT_STREAM(opaque), buf, len,
+					    NULL, NULL);
+}
+
+static int
+stream_seek_cb(void *opaque, uint64_t offset)
+{
+	GSeekable *seekable = G_SEEKABLE(opaque);
+
+	return g_seekable_seek(seekable, (goffset)offset, G_SEEK_SET,
+			       NULL, NULL) ? 0 : -1;
+}
+
+static void
+stream_close_cb(void *opaque)
+{
+	/* the stream is closed when the media is freed */
+}
+
+static void
+stream_media_freed_cb(const struct libvlc_event_t *event, void *user_data)
+{
+	GInputStream *stream = G_INPUT_STREAM(user_data);
+
+	g_input_stream_close(stream, NULL, NULL);
+	g_object_unref(stream);
+}
+
+#endif /* LIBVLC_VERSION_INT >= LIBVLC_VERSION(3,0,0,0) */
+
+/**
+ * @private
+ * @brief Create media reading from memory.
+ *
+ * The memory must stay valid until the media is freed.
+ * \e destroy is invoked then, or immediately if the media could not be
+ * created.
+ *
+ * @param inst         libVLC instance
+ * @param data         Media data, e.g. a memory mapped file
+ * @param size         Size of data (bytes)
+ * @param destroy      Function to free data with (may be \c NULL)
+ * @param destroy_data Argument for \e destroy
+ * @return New media or \c NULL (libVLC < 3.0 is not supported)
+ */
+libvlc_media_t *
+_gtk_vlc_media_new_bytes(libvlc_instance_t *inst,
+			 gconstpointer data, gsize size,
+			 GDestroyNotify destroy, gpointer destroy_data)
+{
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3,0,0,0)
+	BytesSource *source = g_new(BytesSource, 1);
+	libvlc_media_t *media;
+
+	source->data = data;
+	source->size = size;
+	source->destroy = destroy;
+	source->destroy_data = destroy_data;
+
+	media = libvlc_media_new_callbacks(inst,
+					   bytes_open_cb, bytes_read_cb,
+					   bytes_seek_cb, bytes_close_cb, source);
+	if (media == NULL) {
+		bytes_media_freed_cb(NULL, source);
+		return NULL;
+	}
+
+	libvlc_event_attach(libvlc_media_event_manager(media), libvlc_MediaFreed,
+			    bytes_media_freed_cb, source);
+
+	return media;
+#else
+	if (destroy != NULL)
+		destroy(destroy_data);
+	return NULL;
+#endif
+}
+
+/**
+ * @private
+ * @brief Create media reading from a GInputStream.
+ *
+ * The media holds a reference to the stream and closes it when it is freed.
+ *
+ * @param inst   libVLC instance
+ * @param stream Input stream
+ * @return New media or \c NULL (libVLC < 3.0 is not supported)
+ */
+libvlc_media_t *
+_gtk_vlc_media_new_stream(libvlc_instance_t *inst, GInputStream *stream)
+{
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3,0,0,0)
+	gboolean seekable = G_IS_SEEKABLE(stream) &&
+			    g_seekable_can_seek(G_SEEKABLE(stream));
+	libvlc_media_t *media;
+
+	media = libvlc_media_new_callbacks(inst,
+					   stream_open_cb, stream_read_cb,
+					   seekable ? stream_seek_cb : NULL,
+					   stream_close_cb, stream);
+	if (media == NULL)
+		return NULL;
+
+	g_object_ref(stream);
+	libvlc_event_attach(libvlc_media_event_manager(media), libvlc_MediaFreed,
+			    stream_media_freed_cb, stream);
+
+	return media;
+#else
+	return NULL;
+#endif
+}
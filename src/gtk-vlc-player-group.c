@@ -0,0 +1,607 @@
+/**
+ * @file
+ * GtkVlcPlayerGroup, a group of \e GtkVlcPlayer widgets playing in sync.
+ * Members share one libVLC instance, are started simultaneously after
+ * pre-rolling and are continuously kept in sync with the group's master
+ * clock by slightly adjusting their playback rates.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gdk/gdk.h>
+
+#include <vlc/vlc.h>
+
+#include "gtk-vlc-player.h"
+#include "gtk-vlc-player-group.h"
+#include "gtk-vlc-player-private.h"
+
+/** @private */
+#define SYNC_POLL_INTERVAL	10	/* milliseconds */
+/**
+ * @private
+ * Maximum time to wait for members to pre-roll before starting anyway
+ */
+#define SYNC_TIMEOUT		5000	/* milliseconds */
+/**
+ * @private
+ * Maximum difference between a member's time and the start time
+ * for the member to be considered pre-rolled
+ */
+#define SYNC_TOLERANCE		100	/* milliseconds */
+
+/** @private */
+#define DRIFT_INTERVAL		250	/* milliseconds */
+/**
+ * @private
+ * Drift that is tolerated without correction (about one frame)
+ */
+#define DRIFT_TOLERANCE		20	/* milliseconds */
+/**
+ * @private
+ * Drift beyond which a member is resynchronized by seeking
+ */
+#define DRIFT_SEEK_THRESHOLD	1000	/* milliseconds */
+/**
+ * @private
+ * Period over which drift is corrected by adjusting the rate
+ */
+#define DRIFT_CORRECTION_PERIOD	2000	/* milliseconds */
+/**
+ * @private
+ * Maximum relative rate adjustment for drift correction
+ */
+#define DRIFT_MAX_CORRECTION	0.05
+
+/** @private */
+#define GTK_VLC_PLAYER_GROUP_GET_PRIVATE(obj) \
+	(G_TYPE_INSTANCE_GET_PRIVATE((obj), GTK_TYPE_VLC_PLAYER_GROUP, GtkVlcPlayerGroupPrivate))
+
+/** @private */
+typedef enum {
+	MEMBER_STARTING = 0,	/**< waiting for playback to start */
+	MEMBER_SEEKING,		/**< paused, waiting for the start time */
+	MEMBER_READY		/**< paused at the start time */
+} MemberState;
+
+/** @private */
+typedef struct {
+	GtkVlcPlayer	*player;
+	MemberState	state;
+	gboolean	rate_adjusted;
+} Member;
+
+/** @private */
+struct _GtkVlcPlayerGroupPrivate {
+	libvlc_instance_t	*vlc_inst;
+	GArray			*members;	/**< of Member */
+
+	gfloat			rate;
+
+	/*
+	 * Master clock: media time clock_time at monotonic time
+	 * clock_anchor, advancing with rate while running
+	 */
+	gboolean		clock_running;
+	gint64			clock_time;	/**< milliseconds */
+	gint64			clock_anchor;	/**< microseconds */
+
+	/* synchronized start */
+	guint			sync_id;
+	gint64			sync_time;
+	gboolean		sync_resume;
+	gint64			sync_deadline;	/**< monotonic time (us) */
+
+	guint			drift_id;
+	gint64			skew;
+};
+
+/** @private */
+enum {
+	STARTED_SIGNAL,
+	LAST_SIGNAL
+};
+static guint gtk_vlc_player_group_signals[LAST_SIGNAL] = {0};
+
+static void gtk_vlc_player_group_class_init(GtkVlcPlayerGroupClass *klass);
+static void gtk_vlc_player_group_init(GtkVlcPlayerGroup *klass);
+static void gtk_vlc_player_group_dispose(GObject *gobject);
+static void gtk_vlc_player_group_finalize(GObject *gobject);
+
+static void clock_set(GtkVlcPlayerGroup *group, gint64 time, gboolean running);
+static void group_stop_timers(GtkVlcPlayerGroup *group);
+static void sync_start(GtkVlcPlayerGroup *group, gint64 time, gboolean resume);
+static gboolean sync_poll_cb(gpointer user_data);
+static gboolean drift_correct_cb(gpointer user_data);
+
+/** @private */
+G_DEFINE_TYPE(GtkVlcPlayerGroup, gtk_vlc_player_group, G_TYPE_OBJECT);
+
+static void
+gtk_vlc_player_group_class_init(GtkVlcPlayerGroupClass *klass)
+{
+	GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+	gobject_class->dispose = gtk_vlc_player_group_dispose;
+	gobject_class->finalize = gtk_vlc_player_group_finalize;
+
+	gtk_vlc_player_group_signals[STARTED_SIGNAL] =
+		g_signal_new("started",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerGroupClass, started),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__VOID,
+			     G_TYPE_NONE, 0);
+
+	g_type_class_add_private(klass, sizeof(GtkVlcPlayerGroupPrivate));
+}
+
+static void
+gtk_vlc_player_group_init(GtkVlcPlayerGroup *klass)
+{
+	klass->priv = GTK_VLC_PLAYER_GROUP_GET_PRIVATE(klass);
+
+	klass->priv->vlc_inst = _gtk_vlc_instance_pool_acquire(NULL);
+	klass->priv->members = g_array_new(FALSE, FALSE, sizeof(Member));
+
+	klass->priv->rate = 1.;
+	klass->priv->clock_running = FALSE;
+	klass->priv->clock_time = 0;
+	klass->priv->clock_anchor = 0;
+
+	klass->priv->sync_id = 0;
+	klass->priv->drift_id = 0;
+	klass->priv->skew = 0;
+}
+
+static void
+gtk_vlc_player_group_dispose(GObject *gobject)
+{
+	GtkVlcPlayerGroup *group = GTK_VLC_PLAYER_GROUP(gobject);
+
+	group_stop_timers(group);
+
+	/* Chain up to the parent class */
+	G_OBJECT_CLASS(gtk_vlc_player_group_parent_class)->dispose(gobject);
+}
+
+static void
+gtk_vlc_player_group_finalize(GObject *gobject)
+{
+	GtkVlcPlayerGroup *group = GTK_VLC_PLAYER_GROUP(gobject);
+
+	for (guint i = 0; i < group->priv->members->len; i++)
+		g_object_unref(g_array_index(group->priv->members, Member, i).player);
+	g_array_free(group->priv->members, TRUE);
+
+	_gtk_vlc_instance_pool_release(group->priv->vlc_inst);
+
+	/* Chain up to the parent class */
+	G_OBJECT_CLASS(gtk_vlc_player_group_parent_class)->finalize(gobject);
+}
+
+static void
+clock_set(GtkVlcPlayerGroup *group, gint64 time, gboolean running)
+{
+	group->priv->clock_time = time;
+	group->priv->clock_anchor = g_get_monotonic_time();
+	group->priv->clock_running = running;
+}
+
+static void
+group_stop_timers(GtkVlcPlayerGroup *group)
+{
+	if (group->priv->sync_id != 0) {
+		g_source_remove(group->priv->sync_id);
+		group->priv->sync_id = 0;
+	}
+	if (group->priv->drift_id != 0) {
+		g_source_remove(group->priv->drift_id);
+		group->priv->drift_id = 0;
+	}
+}
+
+/**
+ * @brief Pre-roll all members at a given time.
+ *
+ * Members are paused at the start time. When all of them are ready
+ * (or after a timeout), they are resumed back-to-back if requested.
+ *
+ * @param group  \e GtkVlcPlayerGroup instance
+ * @param time   Start time (milliseconds)
+ * @param resume Whether to start playing after pre-rolling
+ */
+static void
+sync_start(GtkVlcPlayerGroup *group, gint64 time, gboolean resume)
+{
+	GtkVlcPlayerGroupPrivate *priv = group->priv;
+
+	group_stop_timers(group);
+	clock_set(group, time, FALSE);
+
+	for (guint i = 0; i < priv->members->len; i++) {
+		Member *member = &g_array_index(priv->members, Member, i);
+		libvlc_media_player_t *mp;
+
+		mp = _gtk_vlc_player_get_media_player(member->player);
+		if (mp == NULL) {
+			/* resumes at the saved time, corrected for drift */
+			gtk_vlc_player_seek(member->player, time);
+			if (resume)
+				gtk_vlc_player_play(member->player);
+			else
+				gtk_vlc_player_pause(member->player);
+			member->state = MEMBER_READY;
+			continue;
+		}
+
+		switch (libvlc_media_player_get_state(mp)) {
+		case libvlc_Opening:
+		case libvlc_Buffering:
+		case libvlc_Playing:
+		case libvlc_Paused:
+			libvlc_media_player_set_pause(mp, 1);
+			libvlc_media_player_set_time(mp, (libvlc_time_t)time);
+			member->state = MEMBER_SEEKING;
+			break;
+		default:
+			/* cannot seek before playback has started */
+			gtk_vlc_player_play(member->player);
+			member->state = MEMBER_STARTING;
+			break;
+		}
+	}
+
+	priv->sync_time = time;
+	priv->sync_resume = resume;
+	priv->sync_deadline = g_get_monotonic_time() + SYNC_TIMEOUT*1000;
+	priv->sync_id = gdk_threads_add_timeout(SYNC_POLL_INTERVAL,
+						sync_poll_cb, group);
+}
+
+static gboolean
+sync_poll_cb(gpointer user_data)
+{
+	GtkVlcPlayerGroup *group = GTK_VLC_PLAYER_GROUP(user_data);
+	GtkVlcPlayerGroupPrivate *priv = group->priv;
+	gboolean all_ready = TRUE;
+
+	for (guint i = 0; i < priv->members->len; i++) {
+		Member *member = &g_array_index(priv->members, Member, i);
+		libvlc_media_player_t *mp;
+
+		mp = _gtk_vlc_player_get_media_player(member->player);
+		/* suspended while pre-rolling */
+		if (mp == NULL)
+			member->state = MEMBER_READY;
+
+		switch (member->state) {
+		case MEMBER_STARTING:
+			if (libvlc_media_player_get_state(mp) == libvlc_Playing) {
+				libvlc_media_player_set_pause(mp, 1);
+				libvlc_media_player_set_time(mp, (libvlc_time_t)priv->sync_time);
+				member->state = MEMBER_SEEKING;
+			}
+			break;
+		case MEMBER_SEEKING:
+			if (ABS(libvlc_media_player_get_time(mp) - priv->sync_time) <=
+			    SYNC_TOLERANCE)
+				member->state = MEMBER_READY;
+			break;
+		case MEMBER_READY:
+			break;
+		}
+
+		all_ready &= member->state == MEMBER_READY;
+	}
+
+	if (!all_ready && g_get_monotonic_time() < priv->sync_deadline)
+		return TRUE;
+
+	priv->sync_id = 0;
+
+	if (!priv->sync_resume)
+		return FALSE;
+
+	/* resume all members as simultaneously as possible */
+	for (guint i = 0; i < priv->members->len; i++) {
+		Member *member = &g_array_index(priv->members, Member, i);
+		libvlc_media_player_t *mp;
+
+		mp = _gtk_vlc_player_get_media_player(member->player);
+		if (mp == NULL) {
+			gtk_vlc_player_play(member->player);
+			continue;
+		}
+		libvlc_media_player_set_rate(mp, priv->rate);
+		member->rate_adjusted = FALSE;
+		libvlc_media_player_set_pause(mp, 0);
+	}
+	clock_set(group, priv->sync_time, TRUE);
+
+	priv->drift_id = gdk_threads_add_timeout(DRIFT_INTERVAL,
+						 drift_correct_cb, group);
+
+	g_signal_emit(group, gtk_vlc_player_group_signals[STARTED_SIGNAL], 0);
+
+	return FALSE;
+}
+
+/**
+ * @brief Correct drift of members against the master clock.
+ *
+ * Small drifts are corrected smoothly by speeding up or slowing down a
+ * member, so that it catches up within \ref DRIFT_CORRECTION_PERIOD.
+ * Large drifts (e.g. after a member stalled) are corrected by seeking.
+ */
+static gboolean
+drift_correct_cb(gpointer user_data)
+{
+	GtkVlcPlayerGroup *group = GTK_VLC_PLAYER_GROUP(user_data);
+	GtkVlcPlayerGroupPrivate *priv = group->priv;
+
+	gint64 master = gtk_vlc_player_group_get_time(group);
+	gint64 min_time = G_MAXINT64, max_time = G_MININT64;
+
+	for (guint i = 0; i < priv->members->len; i++) {
+		Member *member = &g_array_index(priv->members, Member, i);
+		libvlc_media_player_t *mp;
+		gint64 time, drift;
+
+		mp = _gtk_vlc_player_get_media_player(member->player);
+		if (mp == NULL ||
+		    libvlc_media_player_get_state(mp) != libvlc_Playing)
+			continue;
+		time = (gint64)libvlc_media_player_get_time(mp);
+		if (time < 0)
+			continue;
+
+		min_time = MIN(min_time, time);
+		max_time = MAX(max_time, time);
+
+		drift = time - master;
+
+		if (ABS(drift) > DRIFT_SEEK_THRESHOLD) {
+			libvlc_media_player_set_time(mp, (libvlc_time_t)master);
+		} else if (ABS(drift) > DRIFT_TOLERANCE) {
+			gdouble correction = CLAMP(-(gdouble)drift/DRIFT_CORRECTION_PERIOD,
+						   -DRIFT_MAX_CORRECTION,
+						   DRIFT_MAX_CORRECTION);
+
+			libvlc_media_player_set_rate(mp, priv->rate*(1. + correction));
+			member->rate_adjusted = TRUE;
+		} else if (member->rate_adjusted) {
+			libvlc_media_player_set_rate(mp, priv->rate);
+			member->rate_adjusted = FALSE;
+		}
+	}
+
+	if (max_time >= min_time)
+		priv->skew = max_time - min_time;
+
+	return TRUE;
+}
+
+/**
+ * @brief Construct new \e GtkVlcPlayerGroup.
+ *
+ * All members of the group share one libVLC instance.
+ *
+ * @return \e GtkVlcPlayerGroup instance
+ */
+GtkVlcPlayerGroup *
+gtk_vlc_player_group_new(void)
+{
+	return GTK_VLC_PLAYER_GROUP(g_object_new(GTK_TYPE_VLC_PLAYER_GROUP, NULL));
+}
+
+/**
+ * @brief Construct new \e GtkVlcPlayer widget as a member of the group
+ *
+ * The group owns a reference to the player, which stays a member until
+ * the group is destroyed. The player can be added to containers like any
+ * other widget and media has to be loaded into it as usual.
+ * It should only be controlled via the group afterwards.
+ * Synchronization does not cover the player's playlist.
+ * Suspended members (see \ref gtk_vlc_player_suspend) are left suspended
+ * and resynchronized after they are resumed.
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ * @return New \e GtkVlcPlayer widget
+ */
+GtkWidget *
+gtk_vlc_player_group_new_player(GtkVlcPlayerGroup *group)
+{
+	Member member;
+
+	member.player = GTK_VLC_PLAYER(gtk_vlc_player_new_with_instance(group->priv->vlc_inst));
+	member.state = MEMBER_READY;
+	member.rate_adjusted = FALSE;
+	g_object_ref_sink(member.player);
+
+	g_array_append_val(group->priv->members, member);
+
+	return GTK_WIDGET(member.player);
+}
+
+/**
+ * @brief Get number of members of the group
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ * @return Number of members
+ */
+guint
+gtk_vlc_player_group_get_size(GtkVlcPlayerGroup *group)
+{
+	return group->priv->members->len;
+}
+
+/**
+ * @brief Get member of the group
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ * @param index Index of member, in order of construction
+ * @return \e GtkVlcPlayer widget (owned by the group) or \c NULL
+ */
+GtkVlcPlayer *
+gtk_vlc_player_group_get_player(GtkVlcPlayerGroup *group, guint index)
+{
+	if (index >= group->priv->members->len)
+		return NULL;
+
+	return g_array_index(group->priv->members, Member, index).player;
+}
+
+/**
+ * @brief Start or resume playback of all members simultaneously
+ *
+ * Members are pre-rolled at the group's current time first, so playback
+ * starts asynchronously. The "started" signal is emitted when all members
+ * have been started.
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ */
+void
+gtk_vlc_player_group_play(GtkVlcPlayerGroup *group)
+{
+	sync_start(group, gtk_vlc_player_group_get_time(group), TRUE);
+}
+
+/**
+ * @brief Pause playback of all members
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ */
+void
+gtk_vlc_player_group_pause(GtkVlcPlayerGroup *group)
+{
+	group_stop_timers(group);
+	clock_set(group, gtk_vlc_player_group_get_time(group), FALSE);
+
+	for (guint i = 0; i < group->priv->members->len; i++) {
+		Member *member = &g_array_index(group->priv->members, Member, i);
+		libvlc_media_player_t *mp;
+
+		mp = _gtk_vlc_player_get_media_player(member->player);
+		if (mp != NULL)
+			libvlc_media_player_set_pause(mp, 1);
+		else
+			gtk_vlc_player_pause(member->player);
+	}
+}
+
+/**
+ * @brief Stop playback of all members
+ *
+ * The group's time is reset to the beginning.
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ */
+void
+gtk_vlc_player_group_stop(GtkVlcPlayerGroup *group)
+{
+	group_stop_timers(group);
+	clock_set(group, 0, FALSE);
+
+	for (guint i = 0; i < group->priv->members->len; i++)
+		gtk_vlc_player_stop(g_array_index(group->priv->members, Member, i).player);
+}
+
+/**
+ * @brief Seek all members to a given time
+ *
+ * Members are pre-rolled at the new time and resumed simultaneously
+ * if the group was playing. Otherwise they stay paused at the new time.
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ * @param time  New position in media (milliseconds)
+ */
+void
+gtk_vlc_player_group_seek(GtkVlcPlayerGroup *group, gint64 time)
+{
+	gboolean resume = group->priv->clock_running ||
+			  (group->priv->sync_id != 0 && group->priv->sync_resume);
+
+	sync_start(group, time, resume);
+}
+
+/**
+ * @brief Set playback rate of all members
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ * @param rate  Playback rate (1.0 is normal speed)
+ */
+void
+gtk_vlc_player_group_set_rate(GtkVlcPlayerGroup *group, gfloat rate)
+{
+	clock_set(group, gtk_vlc_player_group_get_time(group),
+		  group->priv->clock_running);
+	group->priv->rate = rate;
+
+	for (guint i = 0; i < group->priv->members->len; i++) {
+		Member *member = &g_array_index(group->priv->members, Member, i);
+
+		gtk_vlc_player_set_rate(member->player, rate);
+		member->rate_adjusted = FALSE;
+	}
+}
+
+/**
+ * @brief Get time of the group's master clock
+ *
+ * This is the time all members are synchronized to.
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ * @return Current position in media (milliseconds)
+ */
+gint64
+gtk_vlc_player_group_get_time(GtkVlcPlayerGroup *group)
+{
+	GtkVlcPlayerGroupPrivate *priv = group->priv;
+
+	if (!priv->clock_running)
+		return priv->clock_time;
+
+	return priv->clock_time +
+	       (gint64)((g_get_monotonic_time() - priv->clock_anchor)*priv->rate/1000.);
+}
+
+/**
+ * @brief Get skew between members
+ *
+ * The skew is the difference between the most advanced and the
+ * least advanced playing member, as measured periodically while
+ * correcting drift. It is limited by the precision of the playback
+ * times reported by libVLC.
+ *
+ * @param group \e GtkVlcPlayerGroup instance
+ * @return Last measured skew (milliseconds)
+ */
+gint64
+gtk_vlc_player_group_get_skew(GtkVlcPlayerGroup *group)
+{
+	return group->priv->skew;
+}
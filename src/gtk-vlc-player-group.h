@@ -0,0 +1,105 @@
+/**
+ * @file
+ * Header file for GtkVlcPlayerGroup, a group of synchronized
+ * \e GtkVlcPlayer widgets (e.g. for video walls).
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_VLC_PLAYER_GROUP_H
+#define __GTK_VLC_PLAYER_GROUP_H
+
+#include <glib-object.h>
+
+#include "gtk-vlc-player.h"
+
+G_BEGIN_DECLS
+
+#define GTK_TYPE_VLC_PLAYER_GROUP \
+	(gtk_vlc_player_group_get_type())
+/**
+ * Cast instance pointer to \e GtkVlcPlayerGroup
+ *
+ * @param obj Object to cast to \e GtkVlcPlayerGroup
+ * @return \e obj casted to \e GtkVlcPlayerGroup
+ */
+#define GTK_VLC_PLAYER_GROUP(obj) \
+	(G_TYPE_CHECK_INSTANCE_CAST((obj), GTK_TYPE_VLC_PLAYER_GROUP, GtkVlcPlayerGroup))
+#define GTK_VLC_PLAYER_GROUP_CLASS(klass) \
+	(G_TYPE_CHECK_CLASS_CAST((klass), GTK_TYPE_VLC_PLAYER_GROUP, GtkVlcPlayerGroupClass))
+#define GTK_IS_VLC_PLAYER_GROUP(obj) \
+	(G_TYPE_CHECK_INSTANCE_TYPE((obj), GTK_TYPE_VLC_PLAYER_GROUP))
+#define GTK_IS_VLC_PLAYER_GROUP_CLASS(klass) \
+	(G_TYPE_CHECK_CLASS_TYPE((klass), GTK_TYPE_VLC_PLAYER_GROUP))
+#define GTK_VLC_PLAYER_GROUP_GET_CLASS(obj) \
+	(G_TYPE_INSTANCE_GET_CLASS((obj), GTK_TYPE_VLC_PLAYER_GROUP, GtkVlcPlayerGroupClass))
+
+/** @private */
+typedef struct _GtkVlcPlayerGroupPrivate GtkVlcPlayerGroupPrivate;
+
+/**
+ * \e GtkVlcPlayerGroup instance structure
+ */
+typedef struct _GtkVlcPlayerGroup {
+	GObject parent_instance;	/**< Parent instance structure */
+
+	GtkVlcPlayerGroupPrivate *priv;	/**< @private */
+} GtkVlcPlayerGroup;
+
+/**
+ * \e GtkVlcPlayerGroup class structure
+ */
+typedef struct _GtkVlcPlayerGroupClass {
+	GObjectClass parent_class;	/**< Parent class structure */
+
+	/**
+	 * Callback function to invoke when emitting the "started"
+	 * signal, i.e. when all members have been pre-rolled and
+	 * started (or resumed) playing simultaneously.
+	 *
+	 * @param self \e GtkVlcPlayerGroup that emitted the signal
+	 */
+	void (*started)		(GtkVlcPlayerGroup *self);
+} GtkVlcPlayerGroupClass;
+
+/** @private */
+GType gtk_vlc_player_group_get_type(void);
+
+/*
+ * API
+ */
+GtkVlcPlayerGroup *gtk_vlc_player_group_new(void);
+
+GtkWidget *gtk_vlc_player_group_new_player(GtkVlcPlayerGroup *group);
+guint gtk_vlc_player_group_get_size(GtkVlcPlayerGroup *group);
+GtkVlcPlayer *gtk_vlc_player_group_get_player(GtkVlcPlayerGroup *group,
+					      guint index);
+
+void gtk_vlc_player_group_play(GtkVlcPlayerGroup *group);
+void gtk_vlc_player_group_pause(GtkVlcPlayerGroup *group);
+void gtk_vlc_player_group_stop(GtkVlcPlayerGroup *group);
+void gtk_vlc_player_group_seek(GtkVlcPlayerGroup *group, gint64 time);
+void gtk_vlc_player_group_set_rate(GtkVlcPlayerGroup *group, gfloat rate);
+
+gint64 gtk_vlc_player_group_get_time(GtkVlcPlayerGroup *group);
+gint64 gtk_vlc_player_group_get_skew(GtkVlcPlayerGroup *group);
+
+G_END_DECLS
+
+#endif
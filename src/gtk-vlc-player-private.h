@@ -0,0 +1,150 @@
+/**
+ * @file
+ * Private declarations shared between the modules of the
+ * \e GtkVlcPlayer library. This header is not installed.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_VLC_PLAYER_PRIVATE_H
+#define __GTK_VLC_PLAYER_PRIVATE_H
+
+#include <glib.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include <vlc/vlc.h>
+
+#include "gtk-vlc-player.h"
+#include "gtk-vlc-media-index.h"
+
+G_BEGIN_DECLS
+
+/*
+ * gtk-vlc-player.c
+ */
+libvlc_instance_t *_gtk_vlc_instance_pool_acquire(const gchar *const
+						   *options);
+void _gtk_vlc_instance_pool_release(libvlc_instance_t *inst);
+libvlc_media_player_t *_gtk_vlc_player_get_media_player(GtkVlcPlayer *player);
+
+/*
+ * gtk-vlc-export.c
+ */
+typedef struct _GtkVlcExportJob GtkVlcExportJob;
+typedef void (*GtkVlcExportProgressFunc)(gdouble progress, gpointer user_data);
+typedef void (*GtkVlcExportFinishFunc)(gboolean success, gpointer user_data);
+
+GtkVlcExportJob *_gtk_vlc_export_push(const gchar *mrl, const gchar *filename,
+				      gint64 in, gint64 out, gboolean remux,
+				      GtkVlcExportProgressFunc progress,
+				      GtkVlcExportFinishFunc finish,
+				      gpointer user_data);
+void _gtk_vlc_export_cancel(GtkVlcExportJob *job);
+
+/*
+ * gtk-vlc-media-index.c
+ */
+void _gtk_vlc_media_info_from_media(libvlc_media_t *media,
+				    GtkVlcMediaInfo *info);
+void _gtk_vlc_media_index_insert(GtkVlcMediaIndex *index, const gchar *file,
+				 const GtkVlcMediaInfo *info);
+gchar *_gtk_vlc_media_index_get_cache_dir(GtkVlcMediaIndex *index);
+
+/*
+ * gtk-vlc-media-input.c
+ */
+libvlc_media_t *_gtk_vlc_media_new_bytes(libvlc_instance_t *inst,
+					 gconstpointer data, gsize size,
+					 GDestroyNotify destroy,
+					 gpointer destroy_data);
+libvlc_media_t *_gtk_vlc_media_new_stream(libvlc_instance_t *inst,
+					  GInputStream *stream);
+
+/*
+ * gtk-vlc-audio-meter.c
+ */
+typedef struct _GtkVlcAudioMeter GtkVlcAudioMeter;
+
+/**
+ * Audio level kernels, accumulating peak and sum of squares per channel
+ * of \e frames interleaved float samples
+ */
+typedef struct {
+	const gchar	*name;
+	void		(*func)(const gfloat *samples, guint frames,
+				guint channels, gfloat *peak, gdouble *sum_sq);
+} GtkVlcAudioLevelsKernel;
+
+const GtkVlcAudioLevelsKernel *_gtk_vlc_audio_get_levels_kernels(void);
+
+GtkVlcAudioMeter *_gtk_vlc_audio_meter_new(void);
+void _gtk_vlc_audio_meter_free(GtkVlcAudioMeter *meter);
+void _gtk_vlc_audio_meter_tap(GtkVlcAudioMeter *meter,
+			      libvlc_media_t *media);
+gboolean _gtk_vlc_audio_meter_read(GtkVlcAudioMeter *meter,
+				   GtkVlcPlayerAudioLevels *levels);
+
+/*
+ * gtk-vlc-convert.c
+ */
+typedef enum {
+	GTK_VLC_CONVERT_I420,	/**< Y, U and V planes, 2x2 subsampled chroma */
+	GTK_VLC_CONVERT_NV12	/**< Y and interleaved UV plane */
+} GtkVlcConvertChroma;
+
+/** Row conversion kernels, writing \e width pixels */
+typedef struct {
+	const gchar	*name;
+	void		(*i420_row)(guint32 *dst, const guint8 *y,
+				    const guint8 *u, const guint8 *v,
+				    guint width);
+	void		(*nv12_row)(guint32 *dst, const guint8 *y,
+				    const guint8 *uv, guint width);
+} GtkVlcConvertKernel;
+
+const GtkVlcConvertKernel *_gtk_vlc_convert_get_kernels(void);
+const GtkVlcConvertKernel *_gtk_vlc_convert_get_kernel(void);
+void _gtk_vlc_convert_frame(const GtkVlcConvertKernel *kernel,
+			    GtkVlcConvertChroma chroma,
+			    guint8 *const *planes, const guint *pitches,
+			    guint width, guint height,
+			    guint8 *dst, guint dst_stride, guint dst_height);
+
+/*
+ * gtk-vlc-renderer.c
+ */
+typedef struct _GtkVlcRenderer GtkVlcRenderer;
+typedef void (*GtkVlcRendererFrameFunc)(gpointer user_data);
+
+GtkVlcRenderer *_gtk_vlc_renderer_new(GtkVlcRendererFrameFunc frame_ready,
+				      gpointer user_data);
+void _gtk_vlc_renderer_free(GtkVlcRenderer *renderer);
+void _gtk_vlc_renderer_attach(GtkVlcRenderer *renderer,
+			      libvlc_media_player_t *media_player);
+gboolean _gtk_vlc_renderer_paint(GtkVlcRenderer *renderer, cairo_t *cr,
+				 gint width, gint height);
+void _gtk_vlc_renderer_add_stats(GtkVlcRenderer *renderer,
+				 GtkVlcPlayerFrameStats *stats);
+GdkPixbuf *_gtk_vlc_renderer_snapshot(GtkVlcRenderer *renderer,
+				      guint width, guint height);
+
+G_END_DECLS
+
+#endif
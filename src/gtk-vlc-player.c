@@ -29,6 +29,8 @@
 #endif
 
 #include <assert.h>
+#include <string.h>
+#include <math.h>
 
 #ifdef HAVE_WINDOWS_H
 #include <windows.h>
@@ -37,6 +39,13 @@
 
 #include <glib.h>
 #include <glib/gprintf.h>
+#include <glib/gstdio.h>
+
+#ifdef G_OS_WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
@@ -51,24 +60,49 @@
 
 #include "cclosure-marshallers.h"
 #include "gtk-vlc-player.h"
+#include "gtk-vlc-media-index.h"
+#include "gtk-vlc-frame-index.h"
+#include "gtk-vlc-player-private.h"
 
 static void gtk_vlc_player_class_init(GtkVlcPlayerClass *klass);
-static inline libvlc_instance_t *create_vlc_instance(void);
+static gchar **create_vlc_argv(const gchar *const *options);
+static gboolean vlc_instance_pool_find_cb(gpointer key, gpointer value,
+					  gpointer user_data);
+static GtkWidget *create_drawing_area(GtkVlcPlayer *player);
+static GtkWidget *create_fullscreen_window(GtkVlcPlayer *player);
+static libvlc_instance_t *vlc_player_ensure_instance(GtkVlcPlayer *player);
+static void vlc_player_ensure(GtkVlcPlayer *player);
+static void vlc_player_add_media_options(GtkVlcPlayer *player,
+					 libvlc_media_t *media);
+static void vlc_player_set_media(GtkVlcPlayer *player,
+				 libvlc_media_player_t *media_player,
+				 libvlc_media_t *media);
 static void gtk_vlc_player_init(GtkVlcPlayer *klass);
 
+static void gtk_vlc_player_set_property(GObject *gobject, guint prop_id,
+					const GValue *value, GParamSpec *pspec);
 static void gtk_vlc_player_dispose(GObject *gobject);
+static void gtk_vlc_player_map(GtkWidget *widget);
+static void gtk_vlc_player_unmap(GtkWidget *widget);
 static void gtk_vlc_player_finalize(GObject *gobject);
 
-static inline void maybe_lock_gdk(void);
-static inline void maybe_unlock_gdk(void);
-
 #ifdef G_OS_WIN32
 static BOOL CALLBACK enumerate_vlc_windows_cb(HWND hWndvlc, LPARAM lParam);
 static gboolean poll_vlc_event_window_cb(gpointer data);
 #endif
 static void widget_on_realize(GtkWidget *widget, gpointer data);
+static gboolean widget_on_expose(GtkWidget *widget, GdkEventExpose *event,
+				 gpointer data);
 static gboolean widget_on_click(GtkWidget *widget, GdkEventButton *event,
 				gpointer data);
+static void widget_on_size_allocate(GtkWidget *widget,
+				    GtkAllocation *allocation, gpointer data);
+static void fullscreen_window_on_size_allocate(GtkWidget *widget,
+					       GtkAllocation *allocation,
+					       gpointer data);
+static void fullscreen_fit_areas(GtkVlcPlayer *player);
+static guint count_dropped_frames(GtkVlcPlayer *player);
+static gboolean fullscreen_measure_cb(gpointer user_data);
 
 static void time_adj_on_value_changed(GtkAdjustment *adj, gpointer user_data);
 static void time_adj_on_changed(GtkAdjustment *adj, gpointer user_data);
@@ -77,19 +111,221 @@ static void vol_adj_on_value_changed(GtkAdjustment *adj, gpointer user_data);
 static inline void set_transient_toplevel_window(GtkWindow *target,
 						 GtkWidget *widget);
 
+static inline void vlc_player_set_time(libvlc_media_player_t *media_player,
+				       gint64 time, gboolean fast);
+static void seek_schedule(GtkVlcPlayer *player, gint64 time, gboolean fast);
+static void seek_issue_pending(GtkVlcPlayer *player);
+static inline gboolean seek_has_landed(GtkVlcPlayerPrivate *priv,
+				       gint64 time);
+static void seek_complete(GtkVlcPlayer *player);
+static gboolean seek_timeout_cb(gpointer user_data);
+static gboolean scrub_settle_cb(gpointer user_data);
+static void seek_decode_forward(GtkVlcPlayer *player, gint64 time);
+static void vlc_player_set_frame_index(GtkVlcPlayer *player,
+				       const gchar *file);
+
+static gboolean stats_sample_cb(gpointer user_data);
+static gboolean audio_levels_cb(gpointer user_data);
+
+static void live_buffering(GtkVlcPlayer *player, gfloat cache);
+static void live_restart(GtkVlcPlayer *player, guint caching);
+static gboolean live_adapt_cb(gpointer user_data);
+
+static gboolean suspend_timeout_cb(gpointer user_data);
+static gboolean resume_restore(GtkVlcPlayer *player, GtkVlcPlayerState state);
+
+static gint64 clock_now(GtkVlcPlayerPrivate *priv, gint64 now);
+static void clock_anchor(GtkVlcPlayerPrivate *priv, gint64 time);
+static void clock_sync(GtkVlcPlayer *player, gint64 time);
+static void clock_set_running(GtkVlcPlayer *player, gboolean running);
+static void clock_update(GtkVlcPlayer *player);
+static gboolean clock_tick_cb(gpointer user_data);
+
+static void emit_time(GtkVlcPlayer *player, gint64 new_time);
 static void update_time(GtkVlcPlayer *player, gint64 new_time);
 static void update_length(GtkVlcPlayer *player, gint64 new_length);
 
-static void vlc_time_changed(const struct libvlc_event_t *event,
-			     void *userdata);
-static void vlc_length_changed(const struct libvlc_event_t *event,
-			       void *userdata);
-
-static void vlc_player_load_media(GtkVlcPlayer *player, libvlc_media_t *media);
+static void vlc_player_event_cb(const struct libvlc_event_t *event,
+				void *user_data);
+static gboolean vlc_event_source_prepare(GSource *source, gint *timeout);
+static gboolean vlc_event_source_check(GSource *source);
+static gboolean vlc_event_source_dispatch(GSource *source,
+					  GSourceFunc callback,
+					  gpointer user_data);
+
+static void vlc_player_load_media(GtkVlcPlayer *player, libvlc_media_t *media,
+				  const GtkVlcMediaInfo *info);
+static void vlc_player_load_media_async(GtkVlcPlayer *player,
+					libvlc_media_t *media,
+					const gchar *file,
+					GCancellable *cancellable,
+					GAsyncReadyCallback callback,
+					gpointer user_data, gpointer source_tag);
+static void parse_pool_push(libvlc_media_t *media,
+			    gboolean (*is_cancelled)(gpointer user_data),
+			    GSourceFunc finish_cb, gpointer user_data);
+static void parse_pool_worker(gpointer data, gpointer user_data);
+static gboolean load_media_is_cancelled(gpointer user_data);
+static gboolean load_media_async_finish_cb(gpointer user_data);
+
+static void vlc_player_set_window(libvlc_media_player_t *media_player,
+				  GtkWidget *widget);
+static void vlc_player_set_output(GtkVlcPlayer *player,
+				  libvlc_media_player_t *media_player,
+				  GtkWidget *widget);
+static void renderer_frame_ready_cb(gpointer user_data);
+static void vlc_player_attach_events(GtkVlcPlayer *player,
+				     libvlc_media_player_t *media_player);
+static void vlc_player_detach_events(GtkVlcPlayer *player,
+				     libvlc_media_player_t *media_player);
+static void standby_event_cb(const struct libvlc_event_t *event,
+			     void *user_data);
+
+static gboolean playlist_insert(GtkVlcPlayer *player, gint position,
+				libvlc_media_t *media);
+static void playlist_prefetch(GtkVlcPlayer *player);
+static gboolean playlist_prefetch_is_cancelled(gpointer user_data);
+static gboolean playlist_prefetch_finish_cb(gpointer user_data);
+static void playlist_standby_prerolled(GtkVlcPlayer *player);
+static gboolean playlist_swap_standby(GtkVlcPlayer *player);
+static void playlist_advance(GtkVlcPlayer *player);
+
+static GdkPixbuf *snapshot_take(libvlc_media_player_t *media_player,
+				GtkVlcRenderer *renderer,
+				guint width, guint height, GError **error);
+static void snapshot_thread_cb(GSimpleAsyncResult *result, GObject *object,
+			       GCancellable *cancellable);
+static void snapshot_data_free(gpointer data);
+
+static void export_progress_cb(gdouble progress, gpointer user_data);
+static void export_finish_cb(gboolean success, gpointer user_data);
 
 /** @private */
 #define POLL_VLC_EVENT_WINDOW_INTERVAL 100 /* milliseconds */
 
+/** @private */
+#define PARSE_POOL_MAX_THREADS 4
+
+/**
+ * @private
+ * Time-adjustment changes closer together than this are considered
+ * scrubbing (e.g. dragging a scale) and result in fast seeks
+ */
+#define SCRUB_INTERVAL 150 /* milliseconds */
+/**
+ * @private
+ * Time after the last time-adjustment change to issue a precise seek
+ * when scrubbing
+ */
+#define SCRUB_SETTLE_TIMEOUT 200 /* milliseconds */
+/**
+ * @private
+ * Time after which a seek is considered complete even if libVLC did not
+ * report a new time
+ */
+#define SEEK_TIMEOUT 1000 /* milliseconds */
+/**
+ * @private
+ * Maximum distance of a reported time to the target of a precise seek,
+ * for the seek to be considered complete
+ */
+#define SEEK_LANDING_WINDOW 500 /* milliseconds */
+/**
+ * @private
+ * Maximum distance of a reported time to the target of a fast seek.
+ * Fast seeks land on an approximate position, e.g. the nearest keyframe.
+ */
+#define SEEK_FAST_LANDING_WINDOW 5000 /* milliseconds */
+/**
+ * @private
+ * Maximum number of frames stepped after an indexed seek that
+ * fell short of its frame
+ */
+#define SEEK_FORWARD_MAX_STEPS 300
+
+/** @private */
+#define CLOCK_UPDATE_RATE_DEFAULT 30 /* updates per second */
+/**
+ * @private
+ * Period over which differences between the interpolated clock and
+ * libVLC's time are slewed in
+ */
+#define CLOCK_SLEW_PERIOD 500 /* milliseconds */
+/**
+ * @private
+ * Differences larger than this (e.g. seeks done by libVLC itself) make
+ * the clock jump instead
+ */
+#define CLOCK_RESYNC_THRESHOLD 1000 /* milliseconds */
+
+/**
+ * @private
+ * Number of statistics samples kept per player
+ */
+#define STATS_HISTORY_SIZE 64
+/**
+ * @private
+ * Minimum interval between "stats-updated" signals,
+ * regardless of the sampling interval
+ */
+#define STATS_SIGNAL_INTERVAL 1000 /* milliseconds */
+
+/**
+ * @private
+ * Period after a fullscreen toggle during which its latency and
+ * dropped frames are measured
+ */
+#define FULLSCREEN_MEASURE_PERIOD 1000 /* milliseconds */
+
+/*
+ * Live mode: caching of live streams (milliseconds) adapts between
+ * LIVE_CACHING_MIN and LIVE_CACHING_MAX
+ */
+/** @private */
+#define LIVE_CACHING_INITIAL 200 /* milliseconds */
+/** @private */
+#define LIVE_CACHING_MIN 50 /* milliseconds */
+/** @private */
+#define LIVE_CACHING_MAX 1000 /* milliseconds */
+/** @private */
+#define LIVE_ADAPT_INTERVAL 1000 /* milliseconds */
+/**
+ * @private
+ * More late frames per adaptation interval make the caching grow
+ */
+#define LIVE_LATE_FRAMES_THRESHOLD 5
+/**
+ * @private
+ * Number of adaptation intervals without stalls or late frames
+ * after which the caching shrinks
+ */
+#define LIVE_STABLE_INTERVALS 30
+
+/**
+ * @private
+ * Time a player with automatic suspension must stay hidden before it is
+ * suspended, so that quickly switching e.g. notebook pages back and
+ * forth does not reopen media
+ */
+#define SUSPEND_DELAY 1000 /* milliseconds */
+
+/**
+ * @private
+ * Number of slots in the per-player VLC event queue (must be a power of 2)
+ */
+#define VLC_EVENT_QUEUE_SIZE 64
+
+/**
+ * @private
+ * libVLC event signalling that a media player has rendered its first
+ * frame, used to pre-roll the next playlist item
+ */
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2,1,0,0)
+#define VLC_PREROLL_EVENT libvlc_MediaPlayerVout
+#else
+#define VLC_PREROLL_EVENT libvlc_MediaPlayerPlaying
+#endif
+
 /** @private */
 #define GOBJECT_UNREF_SAFE(VAR) G_STMT_START {	\
 	if ((VAR) != NULL) {			\
@@ -102,6 +338,101 @@ static void vlc_player_load_media(GtkVlcPlayer *player, libvlc_media_t *media);
 #define GTK_VLC_PLAYER_GET_PRIVATE(obj) \
 	(G_TYPE_INSTANCE_GET_PRIVATE((obj), GTK_TYPE_VLC_PLAYER, GtkVlcPlayerPrivate))
 
+/**
+ * @private
+ * Types of VLC events.
+ * The first \ref VLC_EVENT_N_COALESCED types carry values of which only
+ * the latest is of interest. They are coalesced when pushed, so they
+ * never occupy queue slots.
+ */
+typedef enum {
+	VLC_EVENT_TIME,
+	VLC_EVENT_LENGTH,
+	VLC_EVENT_BUFFERING,
+	VLC_EVENT_N_COALESCED,
+
+	VLC_EVENT_STATE = VLC_EVENT_N_COALESCED,
+	VLC_EVENT_END_REACHED,
+	VLC_EVENT_ERROR,
+	VLC_EVENT_STANDBY_PREROLLED,
+	VLC_EVENT_FRAME_READY
+} VlcEventType;
+
+/** @private */
+typedef union {
+	gint64			time;
+	gfloat			percent;
+	GtkVlcPlayerState	state;
+} VlcEventData;
+
+/**
+ * @private
+ * Slot of the VLC event queue.
+ * \e seq is used to hand over ownership of the slot between producers and
+ * the consumer without locking.
+ */
+typedef struct {
+	volatile gint	seq;
+
+	VlcEventType	type;
+	VlcEventData	u;
+} VlcEventSlot;
+
+/**
+ * @private
+ * Latest value of a coalesced VLC event type.
+ * \e seq is odd while a producer writes \e u (a sequence lock, since
+ * 64-bit values cannot be written atomically everywhere).
+ */
+typedef struct {
+	volatile gint	seq;
+	volatile gint	pending;	/**< \e u has not been taken yet */
+	VlcEventData	u;
+} VlcEventValue;
+
+/**
+ * @private
+ * Bounded lock-free event queue.
+ * libVLC threads push events into it, the main loop drains it.
+ * Multiple producers are safe (libVLC may emit events from the thread
+ * calling into it), but there may be only one consumer.
+ */
+typedef struct {
+	VlcEventSlot	slots[VLC_EVENT_QUEUE_SIZE];
+	volatile gint	head;		/**< next slot to push (producers) */
+	gint		tail;		/**< next slot to pop (consumer) */
+	volatile gint	dropped;	/**< events dropped on overflow */
+
+	VlcEventValue	values[VLC_EVENT_N_COALESCED];
+} VlcEventQueue;
+
+/**
+ * @private
+ * Main loop source draining the player's VLC event queue once per
+ * main loop iteration.
+ */
+typedef struct {
+	GSource		source;
+	GtkVlcPlayer	*player;
+} VlcEventSource;
+
+static void vlc_event_queue_init(VlcEventQueue *queue);
+static gboolean vlc_event_queue_push(VlcEventQueue *queue,
+				     const VlcEventSlot *event);
+static gboolean vlc_event_queue_pop(VlcEventQueue *queue, VlcEventSlot *event);
+static gboolean vlc_event_queue_take(VlcEventQueue *queue, VlcEventType type,
+				     VlcEventData *data);
+static void vlc_event_queue_discard(VlcEventQueue *queue);
+static inline gboolean vlc_event_queue_is_empty(VlcEventQueue *queue);
+
+/** @private */
+static GSourceFuncs vlc_event_source_funcs = {
+	vlc_event_source_prepare,
+	vlc_event_source_check,
+	vlc_event_source_dispatch,
+	NULL
+};
+
 /** @private */
 struct _GtkVlcPlayerPrivate {
 	GtkObject		*time_adjustment;
@@ -112,19 +443,312 @@ struct _GtkVlcPlayerPrivate {
 	gulong			vol_adj_on_value_changed_id;
 
 	libvlc_instance_t	*vlc_inst;
+	/** Whether vlc_inst was acquired from the pool (not supplied) */
+	gboolean		vlc_inst_pooled;
+	/** Options of a pooled instance (\c NULL-terminated) or \c NULL */
+	gchar			**vlc_options;
 	libvlc_media_player_t	*media_player;
 
+	/** Options added to every media loaded, after the preset's */
+	GtkVlcPlayerPreset	preset;
+	gchar			**media_options;
+
+	/**
+	 * Box containing the drawing areas of the media player and the
+	 * standby media player (only one of them is visible)
+	 */
+	GtkWidget		*video_box;
+	GtkWidget		*drawing_area;
+
+	/*
+	 * Playlist: the standby media player pre-rolls the next item
+	 * into a hidden drawing area and is swapped in at end of media
+	 */
+	GQueue			*playlist;	/**< of libvlc_media_t */
+	gint			playlist_pos;	/**< -1 if not playing an item */
+	libvlc_media_player_t	*standby_player;
+	GtkWidget		*standby_area;
+	libvlc_media_t		*standby_media;	/**< item in standby player */
+	gboolean		standby_ready;	/**< standby_media is pre-rolled */
+	volatile gint		prefetch_generation;
+
+	VlcEventQueue		event_queue;
+	GSource			*event_source;
+
+	GtkVlcMediaIndex	*media_index;
+
+	/** Playback rate, applied to both media players */
+	gfloat			rate;
+	/** Media the frame rate was determined for (referenced) or \c NULL */
+	libvlc_media_t		*fps_media;
+	gdouble			fps;	/**< 0 if unknown */
+
+	/*
+	 * In fullscreen mode, the drawing areas' windows are moved into the
+	 * fullscreen window. The widgets are not reparented, so the native
+	 * windows used by libVLC stay the same.
+	 */
 	gboolean		isFullscreen;
 	GtkWidget		*fullscreen_window;
+
+	guint			fullscreen_measure_id;
+	gint64			fullscreen_toggled_at;	/**< monotonic time (us) */
+	gint64			fullscreen_fitted_at;	/**< monotonic time (us) */
+	guint			fullscreen_dropped_before;
+	GtkVlcPlayerFullscreenStats fullscreen_stats;
+
+	/** Incremented by every load, to detect superseded async loads */
+	volatile gint		load_generation;
+
+	/*
+	 * Seek scheduler: at most one seek is in flight,
+	 * further requests are coalesced (latest wins)
+	 */
+	gboolean		seek_in_flight;
+	gint64			seek_issued_at;	/**< monotonic time (us) */
+	gint64			seek_target;	/**< of seek in flight */
+	gint64			seek_landing_window;
+	guint			seek_timeout_id;
+	gboolean		seek_pending;
+	gint64			seek_pending_time;
+	gboolean		seek_pending_fast;
+
+	/*
+	 * Frame-accurate seeks: indexed seeks that land before their
+	 * frame while paused are completed by stepping frames
+	 */
+	gboolean		frame_accurate;
+	GtkVlcFrameIndex	*frame_index;	/**< of current file or NULL */
+	gint64			seek_forward_time; /**< -1 if not stepping */
+	guint			seek_forward_steps;
+
+	gint64			scrub_last_change; /**< monotonic time (us) */
+	gint64			scrub_time;
+	gboolean		scrub_fast;	/**< fast seeks since settling */
+	guint			scrub_settle_id;
+
+	GtkVlcPlayerSeekStats	seek_stats;
+
+	GtkVlcPlayerRenderMode	render_mode;
+	/**
+	 * Software renderers of the two drawing areas, created on demand.
+	 * Each area references its renderer by object data, so they are
+	 * swapped along with the areas.
+	 */
+	GtkVlcRenderer		*renderers[2];
+
+	/**
+	 * Audio meters of the media player and the standby media player,
+	 * created when metering is first enabled and swapped along with
+	 * the media players
+	 */
+	GtkVlcAudioMeter	*audio_meter;
+	GtkVlcAudioMeter	*standby_meter;
+	guint			audio_levels_id;
+
+	/*
+	 * Statistics ring: stats_count samples ending
+	 * before stats_head (oldest samples are overwritten)
+	 */
+	GtkVlcPlayerStats	stats[STATS_HISTORY_SIZE];
+	guint			stats_head;
+	guint			stats_count;
+	guint			stats_interval_id;
+	gint64			stats_last_signal; /**< monotonic time (us) */
+
+	/*
+	 * Interpolated clock: anchored on libVLC time events and
+	 * extrapolated using the monotonic clock and playback rate
+	 */
+	gint64			clock_anchor_time;	/**< media time (ms) */
+	gint64			clock_anchor_mono;	/**< monotonic time (us) */
+	gint64			clock_correction;	/**< slewed in (ms) */
+	gdouble			clock_rate;
+	gboolean		clock_running;
+	gboolean		clock_resync;	/**< jump on next sync (seeks) */
+	gint64			clock_last;	/**< latest interpolated time */
+	gint64			clock_emitted;	/**< latest time-changed time */
+	gint64			clock_emitted_at; /**< monotonic time (us) */
+	guint			clock_update_rate; /**< 0: raw libVLC times */
+	guint			clock_tick_id;
+
+	/*
+	 * Live mode: stalls and late frames make the caching grow,
+	 * periods without them make it shrink
+	 */
+	gboolean		live_mode;
+	guint			live_adapt_id;
+	gboolean		live_buffered;	/**< buffers were filled once */
+	gboolean		live_stalled;	/**< refilling buffers */
+	guint			live_stable;	/**< intervals without problems */
+	guint			live_last_stalls;
+	guint			live_last_lost;	/**< lost pictures of media */
+	GtkVlcPlayerLiveStats	live_stats;
+
+	/*
+	 * Suspension: the media players are released while suspended,
+	 * media, time, state and volume are restored when resuming
+	 */
+	gboolean		auto_suspend;
+	guint			suspend_id;	/**< delayed automatic suspension */
+	gboolean		suspended;
+	libvlc_media_t		*suspend_media;	/**< referenced or \c NULL */
+	GtkVlcPlayerState	suspend_state;
+	gint64			suspend_time;
+	gint64			suspend_length;
+	gint			suspend_volume;
+	gint			suspend_mute;
+	/** Swallowing the state changes of reopening the media */
+	gboolean		resuming;
+	gint64			resume_time;	/**< -1 once restored */
+	gboolean		resume_paused;
+
+	/** Pending segment exports, ExportData by job number */
+	GHashTable		*export_jobs;
+	guint			export_last_job;
+};
+
+/**
+ * @private
+ * Job of the process-wide parser thread pool.
+ * \e finish_cb is invoked on the main loop (with the GDK lock held) after
+ * parsing, even if the job was cancelled.
+ */
+typedef struct {
+	libvlc_media_t	*media;
+	gboolean	(*is_cancelled)(gpointer user_data);
+	GSourceFunc	finish_cb;
+	gpointer	user_data;
+} ParseJob;
+
+/**
+ * @private
+ * State of an asynchronous media load, passed to the parser thread pool
+ * and back to the main loop.
+ */
+typedef struct {
+	GtkVlcPlayer		*player;
+	libvlc_media_t		*media;
+	GCancellable		*cancellable;
+	GSimpleAsyncResult	*result;
+	gint			generation;
+	gchar			*file;	/**< Filename to index, or \c NULL */
+} LoadMediaData;
+
+/**
+ * @private
+ * State of a playlist item prefetch, passed to the parser thread pool
+ * and back to the main loop.
+ */
+typedef struct {
+	GtkVlcPlayer	*player;
+	libvlc_media_t	*media;
+	gint		generation;
+} PrefetchData;
+
+/**
+ * @private
+ * Request of an asynchronous snapshot, passed to a GIO worker thread
+ */
+typedef struct {
+	libvlc_media_player_t	*media_player;
+	/** Renderer holding the frame, or \c NULL in window render mode */
+	GtkVlcRenderer		*renderer;
+	guint			width;
+	guint			height;
+	GdkPixbuf		*pixbuf;
+} SnapshotData;
+
+/**
+ * @private
+ * Segment export of a player.
+ * Freed on completion, \e player is \c NULL once the player is disposed.
+ */
+typedef struct {
+	GtkVlcPlayer	*player;
+	guint		job;
+	GtkVlcExportJob	*export_job;
+} ExportData;
+
+/**
+ * @private
+ * Media options of the presets, indexed by \e GtkVlcPlayerPreset.
+ * Caching values are in milliseconds (libVLC's defaults are 300 to 1000).
+ */
+static const gchar *const preset_options[][5] = {
+	/* GTK_VLC_PLAYER_PRESET_DEFAULT */
+	{NULL},
+	/* GTK_VLC_PLAYER_PRESET_LOW_LATENCY_LIVE */
+	{":network-caching=100", ":live-caching=100",
+	 ":clock-jitter=0", ":clock-synchro=0", NULL},
+	/* GTK_VLC_PLAYER_PRESET_FAST_START */
+	{":file-caching=50", ":no-sub-autodetect-file", NULL},
+	/* GTK_VLC_PLAYER_PRESET_LOW_CPU */
+	{":avcodec-hw=any", ":avcodec-fast", ":avcodec-skiploopfilter=4",
+	 ":avcodec-hurry-up", NULL}
+};
+
+/**
+ * @private
+ * libVLC media player events dispatched via the player's event queue
+ */
+static const libvlc_event_type_t vlc_player_events[] = {
+	libvlc_MediaPlayerTimeChanged,
+	libvlc_MediaPlayerLengthChanged,
+	libvlc_MediaPlayerOpening,
+	libvlc_MediaPlayerBuffering,
+	libvlc_MediaPlayerPlaying,
+	libvlc_MediaPlayerPaused,
+	libvlc_MediaPlayerStopped,
+	libvlc_MediaPlayerEndReached,
+	libvlc_MediaPlayerEncounteredError
+};
+
+/** @private */
+static GThreadPool *parse_pool = NULL;
+/** @private */
+static gsize parse_pool_initialized = 0;
+
+/**
+ * @private
+ * Entry of the process-wide libVLC instance pool.
+ * Players created with the same option set share one instance.
+ */
+typedef struct {
+	gchar			*key;	/**< Option set, joined by newlines */
+	libvlc_instance_t	*inst;
+	guint			ref_count;
+} VlcInstancePoolEntry;
+
+/** @private */
+G_LOCK_DEFINE_STATIC(vlc_instance_pool);
+/** @private */
+static GHashTable *vlc_instance_pool = NULL;
+
+/** @private */
+enum {
+	PROP_0,
+	PROP_VLC_INSTANCE,
+	PROP_VLC_OPTIONS
 };
 
 /** @private */
 enum {
 	TIME_CHANGED_SIGNAL,
 	LENGTH_CHANGED_SIGNAL,
+	MEDIA_LOADED_SIGNAL,
+	STATE_CHANGED_SIGNAL,
+	BUFFERING_SIGNAL,
+	END_REACHED_SIGNAL,
+	ERROR_SIGNAL,
+	PLAYLIST_ITEM_CHANGED_SIGNAL,
+	STATS_UPDATED_SIGNAL,
+	AUDIO_LEVELS_SIGNAL,
+	EXPORT_PROGRESS_SIGNAL,
+	EXPORT_FINISHED_SIGNAL,
 	LAST_SIGNAL
 };
-static guint gtk_vlc_player_signals[LAST_SIGNAL] = {0, 0};
+static guint gtk_vlc_player_signals[LAST_SIGNAL] = {0};
 
 /**
  * @private
@@ -137,10 +761,34 @@ static void
 gtk_vlc_player_class_init(GtkVlcPlayerClass *klass)
 {
 	GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
 
+	gobject_class->set_property = gtk_vlc_player_set_property;
 	gobject_class->dispose = gtk_vlc_player_dispose;
 	gobject_class->finalize = gtk_vlc_player_finalize;
 
+	widget_class->map = gtk_vlc_player_map;
+	widget_class->unmap = gtk_vlc_player_unmap;
+
+	/*
+	 * libVLC instance to create the player's media player on.
+	 * If unset, an instance from the process-wide pool is used.
+	 * The widget holds a reference to the instance.
+	 */
+	g_object_class_install_property(gobject_class, PROP_VLC_INSTANCE,
+		g_param_spec_pointer("vlc-instance", "libVLC instance",
+				     "libVLC instance to play media with",
+				     G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
+	/*
+	 * Options (command line arguments) of the pooled libVLC instance,
+	 * e.g. to disable unused modules. Ignored if "vlc-instance" is set.
+	 */
+	g_object_class_install_property(gobject_class, PROP_VLC_OPTIONS,
+		g_param_spec_boxed("vlc-options", "libVLC options",
+				   "Options of the libVLC instance to play media with",
+				   G_TYPE_STRV,
+				   G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
+
 	gtk_vlc_player_signals[TIME_CHANGED_SIGNAL] =
 		g_signal_new("time-changed",
 			     G_TYPE_FROM_CLASS(klass),
@@ -159,19 +807,111 @@ gtk_vlc_player_class_init(GtkVlcPlayerClass *klass)
 			     gtk_vlc_player_marshal_VOID__INT64,
 			     G_TYPE_NONE, 1, G_TYPE_INT64);
 
+	gtk_vlc_player_signals[MEDIA_LOADED_SIGNAL] =
+		g_signal_new("media-loaded",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, media_loaded),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__VOID,
+			     G_TYPE_NONE, 0);
+
+	gtk_vlc_player_signals[STATE_CHANGED_SIGNAL] =
+		g_signal_new("state-changed",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, state_changed),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__INT,
+			     G_TYPE_NONE, 1, G_TYPE_INT);
+
+	gtk_vlc_player_signals[BUFFERING_SIGNAL] =
+		g_signal_new("buffering",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, buffering),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__FLOAT,
+			     G_TYPE_NONE, 1, G_TYPE_FLOAT);
+
+	gtk_vlc_player_signals[END_REACHED_SIGNAL] =
+		g_signal_new("end-reached",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, end_reached),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__VOID,
+			     G_TYPE_NONE, 0);
+
+	gtk_vlc_player_signals[ERROR_SIGNAL] =
+		g_signal_new("error",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, error),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__VOID,
+			     G_TYPE_NONE, 0);
+
+	gtk_vlc_player_signals[PLAYLIST_ITEM_CHANGED_SIGNAL] =
+		g_signal_new("playlist-item-changed",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, playlist_item_changed),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__INT,
+			     G_TYPE_NONE, 1, G_TYPE_INT);
+
+	gtk_vlc_player_signals[STATS_UPDATED_SIGNAL] =
+		g_signal_new("stats-updated",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, stats_updated),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__POINTER,
+			     G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+	gtk_vlc_player_signals[AUDIO_LEVELS_SIGNAL] =
+		g_signal_new("audio-levels",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, audio_levels),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__POINTER,
+			     G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+	gtk_vlc_player_signals[EXPORT_PROGRESS_SIGNAL] =
+		g_signal_new("export-progress",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, export_progress),
+			     NULL, NULL,
+			     gtk_vlc_player_marshal_VOID__UINT_DOUBLE,
+			     G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_DOUBLE);
+
+	gtk_vlc_player_signals[EXPORT_FINISHED_SIGNAL] =
+		g_signal_new("export-finished",
+			     G_TYPE_FROM_CLASS(klass),
+			     G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+			     G_STRUCT_OFFSET(GtkVlcPlayerClass, export_finished),
+			     NULL, NULL,
+			     gtk_vlc_player_marshal_VOID__UINT_BOOLEAN,
+			     G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_BOOLEAN);
+
 	g_type_class_add_private(klass, sizeof(GtkVlcPlayerPrivate));
 }
 
-static inline libvlc_instance_t *
-create_vlc_instance(void)
+static gchar **
+create_vlc_argv(const gchar *const *options)
 {
 	gchar	**vlc_argv;
 	gint	vlc_argc = 0;
+	guint	n_options = options != NULL
+				? g_strv_length((gchar **)options) : 0;
 
-	libvlc_instance_t *ret;
-
-	vlc_argv = g_malloc_n(2, sizeof(vlc_argv[0]));
+	vlc_argv = g_malloc_n(1 + n_options + 1, sizeof(vlc_argv[0]));
 	vlc_argv[vlc_argc++] = g_strdup(g_get_prgname());
+	for (guint i = 0; i < n_options; i++)
+		vlc_argv[vlc_argc++] = g_strdup(options[i]);
 
 #if LIBVLC_VERSION_INT < LIBVLC_VERSION(2,0,0,0)
 	if (g_getenv("VLC_PLUGIN_PATH") != NULL) {
@@ -183,44 +923,188 @@ create_vlc_instance(void)
 #endif
 
 	vlc_argv[vlc_argc] = NULL;
+	return vlc_argv;
+}
+
+/**
+ * @brief Get a libVLC instance from the process-wide pool.
+ *
+ * Creating a libVLC instance is expensive (the plugin bank is loaded and
+ * scanned), so all players created with the same option set share one
+ * instance. It is created on first use and reference counted.
+ * This function is thread-safe.
+ *
+ * @param options Additional libVLC command line options
+ *                (\c NULL-terminated) or \c NULL
+ * @return libVLC instance (must be released with
+ *         \ref _gtk_vlc_instance_pool_release) or \c NULL on error
+ */
+libvlc_instance_t *
+_gtk_vlc_instance_pool_acquire(const gchar *const *options)
+{
+	gchar			**vlc_argv = create_vlc_argv(options);
+	gchar			*key = g_strjoinv("\n", vlc_argv);
+	VlcInstancePoolEntry	*entry;
+	libvlc_instance_t	*ret = NULL;
+
+	G_LOCK(vlc_instance_pool);
+
+	if (vlc_instance_pool == NULL)
+		vlc_instance_pool = g_hash_table_new(g_str_hash, g_str_equal);
+
+	entry = g_hash_table_lookup(vlc_instance_pool, key);
+	if (entry == NULL) {
+		ret = libvlc_new((int)g_strv_length(vlc_argv),
+				 (const char *const *)vlc_argv);
+		if (ret != NULL) {
+			entry = g_new(VlcInstancePoolEntry, 1);
+			entry->key = key;
+			entry->inst = ret;
+			entry->ref_count = 1;
+			g_hash_table_insert(vlc_instance_pool, entry->key, entry);
+			key = NULL;
+		}
+	} else {
+		entry->ref_count++;
+		ret = entry->inst;
+	}
 
-	ret = libvlc_new((int)vlc_argc, (const char *const *)vlc_argv);
+	G_UNLOCK(vlc_instance_pool);
 
+	g_free(key);
 	g_strfreev(vlc_argv);
 	return ret;
 }
 
-static void
-gtk_vlc_player_init(GtkVlcPlayer *klass)
+static gboolean
+vlc_instance_pool_find_cb(gpointer key, gpointer value, gpointer user_data)
 {
-	GtkWidget		*drawing_area;
-	GdkColor		color;
-	libvlc_event_manager_t	*evman;
+	return ((VlcInstancePoolEntry *)value)->inst == user_data;
+}
 
-	klass->priv = GTK_VLC_PLAYER_GET_PRIVATE(klass);
-	gtk_alignment_set(GTK_ALIGNMENT(klass), 0., 0., 1., 1.);
+/**
+ * @brief Release a libVLC instance acquired from the pool.
+ *
+ * Pooled instances are destroyed when the last user releases them.
+ * Instances that were not acquired with
+ * \ref _gtk_vlc_instance_pool_acquire (e.g. ones supplied explicitly)
+ * must be released with \e libvlc_release instead.
+ * This function is thread-safe.
+ *
+ * @param inst libVLC instance to release
+ */
+void
+_gtk_vlc_instance_pool_release(libvlc_instance_t *inst)
+{
+	VlcInstancePoolEntry *entry = NULL;
 
-	drawing_area = gtk_drawing_area_new();
+	G_LOCK(vlc_instance_pool);
 
-	gdk_color_parse("black", &color);
-	gtk_widget_modify_bg(drawing_area, GTK_STATE_NORMAL, &color);
+	if (vlc_instance_pool != NULL)
+		entry = g_hash_table_find(vlc_instance_pool,
+					  vlc_instance_pool_find_cb, inst);
+	if (entry == NULL) {
+		G_UNLOCK(vlc_instance_pool);
+		g_return_if_reached();
+	}
 
-	g_signal_connect(G_OBJECT(drawing_area), "realize",
-			 G_CALLBACK(widget_on_realize), klass);
+	if (--entry->ref_count > 0) {
+		G_UNLOCK(vlc_instance_pool);
+		return;
+	}
+	g_hash_table_remove(vlc_instance_pool, entry->key);
+
+	G_UNLOCK(vlc_instance_pool);
+
+	libvlc_release(entry->inst);
+	g_free(entry->key);
+	g_free(entry);
+}
+
+static GtkWidget *
+create_drawing_area(GtkVlcPlayer *player)
+{
+	GtkWidget	*drawing_area;
+	GdkColor	color;
+
+	drawing_area = gtk_drawing_area_new();
+
+	gdk_color_parse("black", &color);
+	gtk_widget_modify_bg(drawing_area, GTK_STATE_NORMAL, &color);
+
+	g_signal_connect(G_OBJECT(drawing_area), "realize",
+			 G_CALLBACK(widget_on_realize), player);
+	g_signal_connect(G_OBJECT(drawing_area), "expose-event",
+			 G_CALLBACK(widget_on_expose), player);
 
 	gtk_widget_add_events(drawing_area, GDK_BUTTON_PRESS_MASK);
 	g_signal_connect(G_OBJECT(drawing_area), "button-press-event",
-			 G_CALLBACK(widget_on_click), klass);
+			 G_CALLBACK(widget_on_click), player);
+	/* after the default handler has moved the window */
+	g_signal_connect_after(G_OBJECT(drawing_area), "size-allocate",
+			       G_CALLBACK(widget_on_size_allocate), player);
+
+	/* visibility is controlled by the player only */
+	gtk_widget_set_no_show_all(drawing_area, TRUE);
+
+	return drawing_area;
+}
+
+static GtkWidget *
+create_fullscreen_window(GtkVlcPlayer *player)
+{
+	GtkWidget	*window;
+	GdkColor	color;
+
+	window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	g_object_ref_sink(window);
+
+	gtk_window_set_deletable(GTK_WINDOW(window), FALSE);
+	gtk_window_set_decorated(GTK_WINDOW(window), FALSE);
+	gtk_window_set_skip_taskbar_hint(GTK_WINDOW(window), TRUE);
+	gtk_window_set_skip_pager_hint(GTK_WINDOW(window), TRUE);
+	gtk_window_set_keep_above(GTK_WINDOW(window), TRUE);
+
+	gdk_color_parse("black", &color);
+	gtk_widget_modify_bg(window, GTK_STATE_NORMAL, &color);
+	g_signal_connect(G_OBJECT(window), "size-allocate",
+			 G_CALLBACK(fullscreen_window_on_size_allocate), player);
+
+	return window;
+}
+
+static void
+gtk_vlc_player_init(GtkVlcPlayer *klass)
+{
+	klass->priv = GTK_VLC_PLAYER_GET_PRIVATE(klass);
+	gtk_alignment_set(GTK_ALIGNMENT(klass), 0., 0., 1., 1.);
+
+	klass->priv->video_box = gtk_hbox_new(TRUE, 0);
+	gtk_container_add(GTK_CONTAINER(klass), klass->priv->video_box);
+	gtk_widget_show(klass->priv->video_box);
 
-	gtk_container_add(GTK_CONTAINER(klass), drawing_area);
-	gtk_widget_show(drawing_area);
+	klass->priv->drawing_area = create_drawing_area(klass);
+	gtk_box_pack_start(GTK_BOX(klass->priv->video_box),
+			   klass->priv->drawing_area, TRUE, TRUE, 0);
+	gtk_widget_show(klass->priv->drawing_area);
+
+	klass->priv->standby_area = create_drawing_area(klass);
+	gtk_box_pack_start(GTK_BOX(klass->priv->video_box),
+			   klass->priv->standby_area, TRUE, TRUE, 0);
 	/*
-	 * drawing area will be destroyed automatically with the
+	 * video box and drawing areas will be destroyed automatically with the
 	 * GtkContainer/GtkVlcPlayer
-	 * (it is derived from GtkObject and has one reference after adding it
-	 * to the container).
+	 * (they are derived from GtkObject and have one reference after adding
+	 * them to the container).
 	 */
 
+	klass->priv->playlist = g_queue_new();
+	klass->priv->playlist_pos = -1;
+	klass->priv->standby_player = NULL;
+	klass->priv->standby_media = NULL;
+	klass->priv->standby_ready = FALSE;
+	klass->priv->prefetch_generation = 0;
+
 	klass->priv->time_adjustment = gtk_adjustment_new(0., 0., 0.,
 							  GTK_VLC_PLAYER_TIME_ADJ_STEP,
 							  GTK_VLC_PLAYER_TIME_ADJ_PAGE,
@@ -245,37 +1129,253 @@ gtk_vlc_player_init(GtkVlcPlayer *klass)
 				 "value-changed",
 				 G_CALLBACK(vol_adj_on_value_changed), klass);
 
-	klass->priv->vlc_inst = create_vlc_instance();
-	klass->priv->media_player = libvlc_media_player_new(klass->priv->vlc_inst);
+	/* libVLC instance and media player are created on demand */
+	klass->priv->vlc_inst = NULL;
+	klass->priv->vlc_inst_pooled = FALSE;
+	klass->priv->vlc_options = NULL;
+	klass->priv->media_player = NULL;
+
+	klass->priv->preset = GTK_VLC_PLAYER_PRESET_DEFAULT;
+	klass->priv->media_options = NULL;
+
+	klass->priv->load_generation = 0;
+	klass->priv->media_index = NULL;
+
+	klass->priv->rate = 1.;
+	klass->priv->fps_media = NULL;
+	klass->priv->fps = 0.;
+
+	klass->priv->seek_in_flight = FALSE;
+	klass->priv->seek_timeout_id = 0;
+	klass->priv->seek_pending = FALSE;
+	klass->priv->frame_accurate = FALSE;
+	klass->priv->frame_index = NULL;
+	klass->priv->seek_forward_time = -1;
+	klass->priv->scrub_last_change = 0;
+	klass->priv->scrub_fast = FALSE;
+	klass->priv->scrub_settle_id = 0;
+	gtk_vlc_player_reset_seek_stats(klass);
+
+	klass->priv->render_mode = GTK_VLC_PLAYER_RENDER_WINDOW;
+	klass->priv->renderers[0] = klass->priv->renderers[1] = NULL;
+
+	klass->priv->audio_meter = klass->priv->standby_meter = NULL;
+	klass->priv->audio_levels_id = 0;
+
+	klass->priv->stats_head = 0;
+	klass->priv->stats_count = 0;
+	klass->priv->stats_interval_id = 0;
+	klass->priv->stats_last_signal = 0;
+
+	klass->priv->live_mode = FALSE;
+	klass->priv->live_adapt_id = 0;
+	klass->priv->live_stats.caching = LIVE_CACHING_INITIAL;
+
+	klass->priv->auto_suspend = FALSE;
+	klass->priv->suspend_id = 0;
+	klass->priv->suspended = FALSE;
+	klass->priv->suspend_media = NULL;
+	klass->priv->resuming = FALSE;
+	klass->priv->resume_time = -1;
+
+	klass->priv->export_jobs = g_hash_table_new(g_direct_hash,
+						    g_direct_equal);
+	klass->priv->export_last_job = 0;
+
+	klass->priv->clock_rate = 1.;
+	klass->priv->clock_running = FALSE;
+	klass->priv->clock_resync = FALSE;
+	clock_anchor(klass->priv, 0);
+	klass->priv->clock_emitted = 0;
+	klass->priv->clock_emitted_at = 0;
+	klass->priv->clock_update_rate = CLOCK_UPDATE_RATE_DEFAULT;
+	klass->priv->clock_tick_id = 0;
+
+	vlc_event_queue_init(&klass->priv->event_queue);
+	klass->priv->event_source = NULL;
+
+	/* created on demand by gtk_vlc_player_set_fullscreen() */
+	klass->priv->isFullscreen = FALSE;
+	klass->priv->fullscreen_window = NULL;
 
-	/* sign up for time updates */
-	evman = libvlc_media_player_event_manager(klass->priv->media_player);
+	klass->priv->fullscreen_measure_id = 0;
+	memset(&klass->priv->fullscreen_stats, 0,
+	       sizeof(klass->priv->fullscreen_stats));
+}
 
-	libvlc_event_attach(evman, libvlc_MediaPlayerTimeChanged,
-			    vlc_time_changed, klass);
-	libvlc_event_attach(evman, libvlc_MediaPlayerLengthChanged,
-			    vlc_length_changed, klass);
+static void
+gtk_vlc_player_set_property(GObject *gobject, guint prop_id,
+			    const GValue *value, GParamSpec *pspec)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(gobject);
+	libvlc_instance_t *inst;
+
+	switch (prop_id) {
+	case PROP_VLC_INSTANCE:
+		inst = (libvlc_instance_t *)g_value_get_pointer(value);
+		if (inst != NULL) {
+			libvlc_retain(inst);
+			player->priv->vlc_inst = inst;
+		}
+		break;
+	case PROP_VLC_OPTIONS:
+		g_strfreev(player->priv->vlc_options);
+		player->priv->vlc_options = g_value_dup_boxed(value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(gobject, prop_id, pspec);
+		break;
+	}
+}
 
-	klass->priv->isFullscreen = FALSE;
-	klass->priv->fullscreen_window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-	g_object_ref_sink(klass->priv->fullscreen_window);
+/**
+ * @brief Acquire libVLC instance on demand.
+ *
+ * The instance is only acquired from the pool if none was supplied on
+ * construction. Creating media only requires the instance, so it does
+ * not create a media player or resume a suspended player.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return libVLC instance of \e player
+ */
+static libvlc_instance_t *
+vlc_player_ensure_instance(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (priv->vlc_inst == NULL) {
+		priv->vlc_inst = _gtk_vlc_instance_pool_acquire((const gchar *const *)
+								priv->vlc_options);
+		priv->vlc_inst_pooled = priv->vlc_inst != NULL;
+	}
+
+	return priv->vlc_inst;
+}
+
+/**
+ * @brief Create libVLC instance and media player on demand.
+ *
+ * This is done when media is first loaded or when the video widget is
+ * realized, whichever comes first.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+static void
+vlc_player_ensure(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	/*
+	 * NOTE: Creating the media player is deferred to here instead of
+	 * construction, so widgets that are never shown or given media
+	 * are cheap.
+	 */
+	if (priv->media_player != NULL)
+		return;
+
+	/* media is loaded into a suspended player, replacing the old one */
+	if (priv->suspended) {
+		if (priv->suspend_media != NULL)
+			libvlc_media_release(priv->suspend_media);
+		priv->suspend_media = NULL;
+		priv->suspended = FALSE;
+	}
 
-	gtk_window_set_deletable(GTK_WINDOW(klass->priv->fullscreen_window),
-				 FALSE);
-	gtk_window_set_decorated(GTK_WINDOW(klass->priv->fullscreen_window),
-				 FALSE);
-	gtk_window_set_skip_taskbar_hint(GTK_WINDOW(klass->priv->fullscreen_window),
-					 TRUE);
-	gtk_window_set_skip_pager_hint(GTK_WINDOW(klass->priv->fullscreen_window),
-				       TRUE);
-	gtk_window_set_keep_above(GTK_WINDOW(klass->priv->fullscreen_window),
-				  TRUE);
+	vlc_player_ensure_instance(player);
+	priv->media_player = libvlc_media_player_new(priv->vlc_inst);
+
+	/*
+	 * VLC events are queued by libVLC threads and dispatched
+	 * on the main loop
+	 */
+	priv->event_source = g_source_new(&vlc_event_source_funcs,
+					  sizeof(VlcEventSource));
+	((VlcEventSource *)priv->event_source)->player = player;
+	g_source_attach(priv->event_source, NULL);
+
+	vlc_player_attach_events(player, priv->media_player);
+	vlc_player_set_output(player, priv->media_player, priv->drawing_area);
+
+	if (priv->volume_adjustment != NULL)
+		gtk_vlc_player_set_volume(player,
+					  gtk_adjustment_get_value(GTK_ADJUSTMENT(priv->volume_adjustment)));
+	if (priv->rate != 1.)
+		libvlc_media_player_set_rate(priv->media_player, priv->rate);
+}
+
+/**
+ * @brief Add the preset's and the application's media options to media.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param media  Media about to be loaded
+ */
+static void
+vlc_player_add_media_options(GtkVlcPlayer *player, libvlc_media_t *media)
+{
+	const gchar *const *options = preset_options[player->priv->preset];
+
+	for (; *options != NULL; options++)
+		libvlc_media_add_option(media, *options);
+
+	if (player->priv->live_mode) {
+		guint caching = player->priv->live_stats.caching;
+		gchar *option;
+
+		option = g_strdup_printf(":network-caching=%u", caching);
+		libvlc_media_add_option(media, option);
+		g_free(option);
+		option = g_strdup_printf(":live-caching=%u", caching);
+		libvlc_media_add_option(media, option);
+		g_free(option);
+
+		/*
+		 * play frames as they arrive, drop them when late and
+		 * avoid the frame delay of threaded decoding
+		 */
+		libvlc_media_add_option(media, ":clock-jitter=0");
+		libvlc_media_add_option(media, ":clock-synchro=0");
+		libvlc_media_add_option(media, ":drop-late-frames");
+		libvlc_media_add_option(media, ":skip-frames");
+		libvlc_media_add_option(media, ":avcodec-threads=1");
+	}
+
+	/* later options override earlier ones */
+	options = (const gchar *const *)player->priv->media_options;
+	for (; options != NULL && *options != NULL; options++)
+		libvlc_media_add_option(media, *options);
+}
+
+/**
+ * @brief Set media of the media player or the standby media player.
+ *
+ * While audio levels are metered, the media's audio is tapped by the
+ * audio meter of the media player that is going to play it.
+ *
+ * @param player       \e GtkVlcPlayer instance
+ * @param media_player Media player or standby media player
+ * @param media        Media to set
+ */
+static void
+vlc_player_set_media(GtkVlcPlayer *player, libvlc_media_player_t *media_player,
+		     libvlc_media_t *media)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	GtkVlcAudioMeter *meter = media_player == priv->media_player
+					? priv->audio_meter : priv->standby_meter;
+
+	/* playlist items may be played by both media players */
+	if (meter != NULL && priv->audio_levels_id != 0)
+		_gtk_vlc_audio_meter_tap(meter, media);
+
+	libvlc_media_player_set_media(media_player, media);
 }
 
 static void
 gtk_vlc_player_dispose(GObject *gobject)
 {
 	GtkVlcPlayer *player = GTK_VLC_PLAYER(gobject);
+	GHashTableIter iter;
+	gpointer value;
 
 	/*
 	 * destroy might be called more than once, but we have only one
@@ -295,8 +1395,66 @@ gtk_vlc_player_dispose(GObject *gobject)
 		g_object_unref(player->priv->volume_adjustment);
 		player->priv->volume_adjustment = NULL;
 	}
+	/* move the drawing areas' windows back before destroying it */
+	gtk_vlc_player_set_fullscreen(player, FALSE);
 	GOBJECT_UNREF_SAFE(player->priv->fullscreen_window);
 
+	/* cancel pending asynchronous loads and prefetches */
+	g_atomic_int_inc(&player->priv->load_generation);
+	g_atomic_int_inc(&player->priv->prefetch_generation);
+
+	if (player->priv->event_source != NULL) {
+		g_source_destroy(player->priv->event_source);
+		g_source_unref(player->priv->event_source);
+		player->priv->event_source = NULL;
+	}
+
+	if (player->priv->seek_timeout_id != 0) {
+		g_source_remove(player->priv->seek_timeout_id);
+		player->priv->seek_timeout_id = 0;
+	}
+	if (player->priv->scrub_settle_id != 0) {
+		g_source_remove(player->priv->scrub_settle_id);
+		player->priv->scrub_settle_id = 0;
+	}
+	player->priv->seek_pending = FALSE;
+	vlc_player_set_frame_index(player, NULL);
+
+	if (player->priv->stats_interval_id != 0) {
+		g_source_remove(player->priv->stats_interval_id);
+		player->priv->stats_interval_id = 0;
+	}
+	if (player->priv->fullscreen_measure_id != 0) {
+		g_source_remove(player->priv->fullscreen_measure_id);
+		player->priv->fullscreen_measure_id = 0;
+	}
+	if (player->priv->clock_tick_id != 0) {
+		g_source_remove(player->priv->clock_tick_id);
+		player->priv->clock_tick_id = 0;
+	}
+	if (player->priv->audio_levels_id != 0) {
+		g_source_remove(player->priv->audio_levels_id);
+		player->priv->audio_levels_id = 0;
+	}
+	if (player->priv->live_adapt_id != 0) {
+		g_source_remove(player->priv->live_adapt_id);
+		player->priv->live_adapt_id = 0;
+	}
+	if (player->priv->suspend_id != 0) {
+		g_source_remove(player->priv->suspend_id);
+		player->priv->suspend_id = 0;
+	}
+
+	/* exports complete in the background, but are no longer reported */
+	g_hash_table_iter_init(&iter, player->priv->export_jobs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		ExportData *data = value;
+
+		_gtk_vlc_export_cancel(data->export_job);
+		data->player = NULL;
+	}
+	g_hash_table_remove_all(player->priv->export_jobs);
+
 	/* Chain up to the parent class */
 	G_OBJECT_CLASS(gtk_vlc_player_parent_class)->dispose(gobject);
 }
@@ -306,39 +1464,75 @@ gtk_vlc_player_finalize(GObject *gobject)
 {
 	GtkVlcPlayer *player = GTK_VLC_PLAYER(gobject);
 
-	libvlc_media_player_release(player->priv->media_player);
-	libvlc_release(player->priv->vlc_inst);
+	if (player->priv->media_player != NULL)
+		libvlc_media_player_release(player->priv->media_player);
+	if (player->priv->standby_player != NULL)
+		libvlc_media_player_release(player->priv->standby_player);
+	if (player->priv->standby_media != NULL)
+		libvlc_media_release(player->priv->standby_media);
+	if (player->priv->fps_media != NULL)
+		libvlc_media_release(player->priv->fps_media);
+	if (player->priv->suspend_media != NULL)
+		libvlc_media_release(player->priv->suspend_media);
+	/* supplied instances are not looked up in the pool */
+	if (player->priv->vlc_inst_pooled)
+		_gtk_vlc_instance_pool_release(player->priv->vlc_inst);
+	else if (player->priv->vlc_inst != NULL)
+		libvlc_release(player->priv->vlc_inst);
+	g_strfreev(player->priv->vlc_options);
+	g_strfreev(player->priv->media_options);
+
+	/* no longer referenced by any media player */
+	for (guint i = 0; i < G_N_ELEMENTS(player->priv->renderers); i++)
+		if (player->priv->renderers[i] != NULL)
+			_gtk_vlc_renderer_free(player->priv->renderers[i]);
+	if (player->priv->audio_meter != NULL) {
+		_gtk_vlc_audio_meter_free(player->priv->audio_meter);
+		_gtk_vlc_audio_meter_free(player->priv->standby_meter);
+	}
+
+	g_queue_foreach(player->priv->playlist,
+			(GFunc)libvlc_media_release, NULL);
+	g_queue_free(player->priv->playlist);
+	g_hash_table_destroy(player->priv->export_jobs);
 
 	/* Chain up to the parent class */
 	G_OBJECT_CLASS(gtk_vlc_player_parent_class)->finalize(gobject);
 }
 
-/**
- * @brief Locks GDK mutex if necessary.
- *
- * When GTK+ functions are invoked from another than the main
- * thread (the one with the \e gtk_main() event loop),
- * \e gdk_threads_enter() must be called.
- * This auxiliary function is for callers (like VLC callbacks) that
- * may or may not be invoked from the main event loop to avoid dead locks.
- */
-static inline void
-maybe_lock_gdk(void)
+static void
+gtk_vlc_player_map(GtkWidget *widget)
 {
-	if (!g_main_context_is_owner(g_main_context_default()))
-		gdk_threads_enter();
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(widget);
+
+	/* Chain up to the parent class */
+	GTK_WIDGET_CLASS(gtk_vlc_player_parent_class)->map(widget);
+
+	if (player->priv->suspend_id != 0) {
+		g_source_remove(player->priv->suspend_id);
+		player->priv->suspend_id = 0;
+	}
+	if (player->priv->auto_suspend)
+		gtk_vlc_player_resume(player);
 }
 
-/**
- * @brief Unlocks GDK mutex if necessary.
- *
- * @see maybe_lock_gdk
- */
-static inline void
-maybe_unlock_gdk(void)
+static void
+gtk_vlc_player_unmap(GtkWidget *widget)
 {
-	if (!g_main_context_is_owner(g_main_context_default()))
-		gdk_threads_leave();
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(widget);
+
+	/*
+	 * the video is still visible in fullscreen mode,
+	 * suspension is scheduled when leaving it
+	 */
+	if (player->priv->auto_suspend && player->priv->suspend_id == 0 &&
+	    !player->priv->isFullscreen && player->priv->media_player != NULL)
+		player->priv->suspend_id = gdk_threads_add_timeout(SUSPEND_DELAY,
+								   suspend_timeout_cb,
+								   player);
+
+	/* Chain up to the parent class */
+	GTK_WIDGET_CLASS(gtk_vlc_player_parent_class)->unmap(widget);
 }
 
 #ifdef G_OS_WIN32
@@ -364,7 +1558,7 @@ enumerate_vlc_windows_cb(HWND hWndvlc, LPARAM lParam)
 static gboolean
 poll_vlc_event_window_cb(gpointer data)
 {
-	GtkWidget *drawing_area = gtk_bin_get_child(GTK_BIN(data));
+	GtkWidget *drawing_area = GTK_VLC_PLAYER(data)->priv->drawing_area;
 	GdkWindow *window = gtk_widget_get_window(drawing_area);
 
 	gboolean ret = TRUE;
@@ -376,68 +1570,276 @@ poll_vlc_event_window_cb(gpointer data)
 }
 
 static void
-widget_on_realize(GtkWidget *widget, gpointer user_data)
+vlc_player_set_window(libvlc_media_player_t *media_player, GtkWidget *widget)
 {
-	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
 	GdkWindow *window = gtk_widget_get_window(widget);
 
-	libvlc_media_player_set_hwnd(player->priv->media_player,
-				     GDK_WINDOW_HWND(window));
+	libvlc_media_player_set_hwnd(media_player, GDK_WINDOW_HWND(window));
 }
 
 #else
 
 static void
-widget_on_realize(GtkWidget *widget, gpointer user_data)
+vlc_player_set_window(libvlc_media_player_t *media_player, GtkWidget *widget)
 {
-	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
 	GdkWindow *window = gtk_widget_get_window(widget);
 
-	libvlc_media_player_set_xwindow(player->priv->media_player,
-					GDK_WINDOW_XID(window));
+	libvlc_media_player_set_xwindow(media_player, GDK_WINDOW_XID(window));
 }
 
 #endif
 
+/**
+ * @brief Direct video output of a media player to a drawing area.
+ *
+ * In window render mode, libVLC renders into the area's window, so this
+ * has no effect until the area is realized. In software render mode,
+ * frames are delivered to the area's software renderer.
+ *
+ * @param player       \e GtkVlcPlayer instance
+ * @param media_player libVLC media player
+ * @param widget       Drawing area
+ */
+static void
+vlc_player_set_output(GtkVlcPlayer *player,
+		      libvlc_media_player_t *media_player, GtkWidget *widget)
+{
+	if (player->priv->render_mode == GTK_VLC_PLAYER_RENDER_SOFTWARE) {
+		GtkVlcRenderer *renderer;
+
+		renderer = g_object_get_data(G_OBJECT(widget), "gtk-vlc-renderer");
+		_gtk_vlc_renderer_attach(renderer, media_player);
+	} else if (gtk_widget_get_realized(widget)) {
+		vlc_player_set_window(media_player, widget);
+	}
+}
+
+/**
+ * @brief Callback for software renderers when a new frame is ready.
+ *
+ * Invoked from a libVLC thread, so the redraw is only queued as a VLC
+ * event.
+ */
+static void
+renderer_frame_ready_cb(gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	VlcEventSlot vlc_event;
+
+	vlc_event.type = VLC_EVENT_FRAME_READY;
+	if (vlc_event_queue_push(&player->priv->event_queue, &vlc_event))
+		g_main_context_wakeup(NULL);
+}
+
+static void
+widget_on_realize(GtkWidget *widget, gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+
+	if (widget == player->priv->drawing_area) {
+		/*
+		 * the output is set up along with a new media player
+		 * (when resuming, for suspended players)
+		 */
+		if (player->priv->media_player == NULL) {
+			if (!player->priv->suspended)
+				vlc_player_ensure(player);
+		} else
+			vlc_player_set_output(player, player->priv->media_player,
+					      widget);
+
+		/*
+		 * the hidden standby drawing area is not realized
+		 * automatically, but needs a window for pre-rolling
+		 */
+		gtk_widget_realize(player->priv->standby_area);
+	} else if (player->priv->standby_player != NULL) {
+		vlc_player_set_output(player, player->priv->standby_player, widget);
+	}
+
+	/* fullscreen mode was enabled before realization */
+	if (player->priv->isFullscreen) {
+		gdk_window_reparent(gtk_widget_get_window(widget),
+				    gtk_widget_get_window(player->priv->fullscreen_window),
+				    0, 0);
+		fullscreen_fit_areas(player);
+	}
+}
+
+static gboolean
+widget_on_expose(GtkWidget *widget, GdkEventExpose *event, gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	GtkVlcRenderer *renderer;
+	GdkWindow *window = gtk_widget_get_window(widget);
+	gint width, height;
+	cairo_t *cr;
+
+	/* in window render mode, libVLC paints the window itself */
+	if (player->priv->render_mode != GTK_VLC_PLAYER_RENDER_SOFTWARE)
+		return FALSE;
+
+	renderer = g_object_get_data(G_OBJECT(widget), "gtk-vlc-renderer");
+	/* differs from the allocation in fullscreen mode */
+	gdk_drawable_get_size(GDK_DRAWABLE(window), &width, &height);
+
+	cr = gdk_cairo_create(window);
+	gdk_cairo_region(cr, event->region);
+	cairo_clip(cr);
+	/* background (black) has already been drawn by GTK */
+	_gtk_vlc_renderer_paint(renderer, cr, width, height);
+	cairo_destroy(cr);
+
+	return TRUE;
+}
+
 static gboolean
 widget_on_click(GtkWidget *widget, GdkEventButton *event, gpointer user_data)
 {
 	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
-	GtkWidget *fullscreen_window = player->priv->fullscreen_window;
 
-	if (fullscreen_window == NULL)
-		return TRUE;
+	if (event->type == GDK_2BUTTON_PRESS && event->button == 1)
+		gtk_vlc_player_set_fullscreen(player, !player->priv->isFullscreen);
 
-	if (event->type != GDK_2BUTTON_PRESS || event->button != 1)
-		return TRUE;
+	return TRUE;
+}
 
-	if (player->priv->isFullscreen) {
-		gtk_widget_reparent(widget, GTK_WIDGET(player));
-		gtk_widget_show(widget);
-		gtk_window_unfullscreen(GTK_WINDOW(fullscreen_window));
-		gtk_widget_hide(fullscreen_window);
+static void
+widget_on_size_allocate(GtkWidget *widget, GtkAllocation *allocation,
+			gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
 
-		player->priv->isFullscreen = FALSE;
-	} else {
-		set_transient_toplevel_window(GTK_WINDOW(fullscreen_window),
-					      GTK_WIDGET(player));
+	/* undo moving the window back into the player's window */
+	if (player->priv->isFullscreen)
+		fullscreen_fit_areas(player);
+}
+
+static void
+fullscreen_window_on_size_allocate(GtkWidget *widget,
+				   GtkAllocation *allocation, gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+
+	/* window manager might resize the fullscreen window asynchronously */
+	if (player->priv->isFullscreen)
+		fullscreen_fit_areas(player);
+}
+
+/**
+ * @brief Resize the drawing areas' windows to fill the fullscreen window.
+ */
+static void
+fullscreen_fit_areas(GtkVlcPlayer *player)
+{
+	GtkWidget *areas[] = {player->priv->drawing_area,
+			      player->priv->standby_area};
+	GtkAllocation allocation;
 
-		gtk_window_fullscreen(GTK_WINDOW(fullscreen_window));
-		gtk_widget_show(fullscreen_window);
-		gtk_widget_reparent(widget, fullscreen_window);
-		gtk_widget_show(widget);
+	gtk_widget_get_allocation(player->priv->fullscreen_window, &allocation);
 
-		player->priv->isFullscreen = TRUE;
+	for (guint i = 0; i < G_N_ELEMENTS(areas); i++) {
+		GdkWindow *window = gtk_widget_get_window(areas[i]);
+
+		if (window != NULL)
+			gdk_window_move_resize(window, 0, 0,
+					       allocation.width, allocation.height);
 	}
 
-	return TRUE;
+	player->priv->fullscreen_fitted_at = g_get_monotonic_time();
+}
+
+/**
+ * @brief Count frames lost by libVLC and the software renderer.
+ */
+static guint
+count_dropped_frames(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerFrameStats frame_stats;
+	libvlc_media_t *media;
+	guint dropped;
+
+	gtk_vlc_player_get_frame_stats(player, &frame_stats);
+	dropped = frame_stats.dropped;
+	if (player->priv->media_player == NULL)
+		return dropped;
+
+	media = libvlc_media_player_get_media(player->priv->media_player);
+	if (media != NULL) {
+		libvlc_media_stats_t vlc_stats;
+
+		if (libvlc_media_get_stats(media, &vlc_stats))
+			dropped += (guint)vlc_stats.i_lost_pictures;
+		libvlc_media_release(media);
+	}
+
+	return dropped;
+}
+
+static gboolean
+fullscreen_measure_cb(gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	GtkVlcPlayerFullscreenStats *stats = &player->priv->fullscreen_stats;
+	guint dropped = count_dropped_frames(player);
+
+	player->priv->fullscreen_measure_id = 0;
+
+	stats->toggles++;
+	stats->last_latency = player->priv->fullscreen_fitted_at -
+			      player->priv->fullscreen_toggled_at;
+	stats->max_latency = MAX(stats->max_latency, stats->last_latency);
+	/* counters are reset when loading other media */
+	stats->last_dropped_frames = dropped >= player->priv->fullscreen_dropped_before
+					? dropped - player->priv->fullscreen_dropped_before
+					: 0;
+	stats->dropped_frames += stats->last_dropped_frames;
+
+	return FALSE;
 }
 
+/**
+ * @brief Seek when the time-adjustment is changed by another widget.
+ *
+ * Changes in quick succession (i.e. dragging a scale) are considered
+ * scrubbing and result in fast (keyframe) seeks. When the adjustment
+ * has settled, a precise seek to the final position is issued.
+ */
 static void
 time_adj_on_value_changed(GtkAdjustment *adj, gpointer user_data)
 {
-	gtk_vlc_player_seek(GTK_VLC_PLAYER(user_data),
-			    (gint64)gtk_adjustment_get_value(adj));
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	GtkVlcPlayerPrivate *priv = player->priv;
+	gint64 now = g_get_monotonic_time();
+	gboolean fast;
+
+	fast = now - priv->scrub_last_change < SCRUB_INTERVAL*1000;
+	priv->scrub_last_change = now;
+	priv->scrub_time = (gint64)gtk_adjustment_get_value(adj);
+	priv->scrub_fast |= fast;
+
+	seek_schedule(player, priv->scrub_time, fast);
+
+	if (priv->scrub_settle_id != 0)
+		g_source_remove(priv->scrub_settle_id);
+	priv->scrub_settle_id = gdk_threads_add_timeout(SCRUB_SETTLE_TIMEOUT,
+							scrub_settle_cb, player);
+}
+
+static gboolean
+scrub_settle_cb(gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	priv->scrub_settle_id = 0;
+
+	if (priv->scrub_fast) {
+		priv->scrub_fast = FALSE;
+		seek_schedule(player, priv->scrub_time, FALSE);
+	}
+
+	return FALSE;
 }
 
 static void
@@ -470,31 +1872,381 @@ set_transient_toplevel_window(GtkWindow *target, GtkWidget *widget)
 		gtk_window_set_transient_for(target, GTK_WINDOW(toplevel));
 }
 
-static void
-update_time(GtkVlcPlayer *player, gint64 new_time)
+/*
+ * libVLC's time seeks are precise (unless the input-fast-seek option is
+ * set for the entire input), decoding forward from the preceding keyframe.
+ * Position seeks are served by the demuxers from their index or from
+ * byte offsets instead, landing near the requested time.
+ */
+static inline void
+vlc_player_set_time(libvlc_media_player_t *media_player, gint64 time,
+		    gboolean fast)
 {
-	g_signal_emit(player, gtk_vlc_player_signals[TIME_CHANGED_SIGNAL], 0,
-		      new_time);
+	gint64 length = (gint64)libvlc_media_player_get_length(media_player);
 
-	if (player->priv->time_adjustment != NULL) {
-		/* ensure that time_adj_on_value_changed() will not be executed */
-		g_signal_handler_block(G_OBJECT(player->priv->time_adjustment),
-				       player->priv->time_adj_on_value_changed_id);
-		gtk_adjustment_set_value(GTK_ADJUSTMENT(player->priv->time_adjustment),
-					 (gdouble)new_time);
-		g_signal_handler_unblock(G_OBJECT(player->priv->time_adjustment),
-					 player->priv->time_adj_on_value_changed_id);
-	}
+	if (fast && length > 0)
+		libvlc_media_player_set_position(media_player,
+						 (float)time/length);
+	else
+		libvlc_media_player_set_time(media_player, (libvlc_time_t)time);
 }
 
+/**
+ * @brief Request a seek via the seek scheduler.
+ *
+ * If no seek is in flight, it is issued immediately. Otherwise it replaces
+ * any other pending request and is issued when the current seek completes.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param time   New position in media (milliseconds)
+ * @param fast   Whether to seek fast (to a keyframe) instead of precisely
+ */
 static void
-update_length(GtkVlcPlayer *player, gint64 new_length)
+seek_schedule(GtkVlcPlayer *player, gint64 time, gboolean fast)
 {
-	g_signal_emit(player, gtk_vlc_player_signals[LENGTH_CHANGED_SIGNAL], 0,
-		      new_length);
+	GtkVlcPlayerPrivate *priv = player->priv;
 
-	if (player->priv->time_adjustment != NULL) {
-		GtkAdjustment *adj = GTK_ADJUSTMENT(player->priv->time_adjustment);
+	/* applied when resuming */
+	if (priv->suspended) {
+		priv->suspend_time = time;
+		update_time(player, time);
+		return;
+	}
+
+	/* nothing loaded yet */
+	if (priv->media_player == NULL)
+		return;
+
+	priv->seek_stats.requested++;
+	if (priv->seek_pending)
+		priv->seek_stats.coalesced++;
+
+	priv->seek_pending = TRUE;
+	priv->seek_pending_time = time;
+	priv->seek_pending_fast = fast;
+
+	if (!priv->seek_in_flight)
+		seek_issue_pending(player);
+}
+
+static void
+seek_issue_pending(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	gint64 time, frame_time, keyframe_time;
+	gboolean fast;
+	VlcEventData stale;
+
+	if (!priv->seek_pending)
+		return;
+	priv->seek_pending = FALSE;
+
+	time = priv->seek_pending_time;
+	fast = priv->seek_pending_fast;
+	priv->seek_forward_time = -1;
+	if (!fast && priv->frame_index != NULL &&
+	    gtk_vlc_frame_index_lookup(priv->frame_index, time,
+				       &frame_time, &keyframe_time)) {
+		/*
+		 * libVLC decodes forward from the preceding keyframe to the
+		 * frame's exact time (a keyframe is landed on directly)
+		 */
+		time = frame_time;
+		priv->seek_forward_time = frame_time;
+		priv->seek_forward_steps = 0;
+	}
+
+	priv->seek_in_flight = TRUE;
+	priv->seek_issued_at = g_get_monotonic_time();
+	priv->seek_target = time;
+	priv->seek_landing_window = fast ? SEEK_FAST_LANDING_WINDOW
+					 : SEEK_LANDING_WINDOW;
+	priv->seek_stats.issued++;
+	/* the new time must not be slewed in */
+	priv->clock_resync = TRUE;
+
+	/* times reported before the seek was issued are stale */
+	vlc_event_queue_take(&priv->event_queue, VLC_EVENT_TIME, &stale);
+
+	vlc_player_set_time(priv->media_player, time, fast);
+
+	priv->seek_timeout_id = gdk_threads_add_timeout(SEEK_TIMEOUT,
+							seek_timeout_cb, player);
+}
+
+/**
+ * @brief Check whether a reported time is that of the seek in flight.
+ *
+ * libVLC performs seeks asynchronously, so it may still report times of
+ * the previous position after the seek was issued.
+ *
+ * @param priv Private player data
+ * @param time Time reported by libVLC (milliseconds)
+ * @return \c TRUE if the seek has landed
+ */
+static inline gboolean
+seek_has_landed(GtkVlcPlayerPrivate *priv, gint64 time)
+{
+	return ABS(time - priv->seek_target) <= priv->seek_landing_window;
+}
+
+/**
+ * @brief Mark the seek in flight as completed.
+ *
+ * This is called when libVLC reports a time near the seek's target
+ * (or after a timeout). Seek latency statistics are updated and the next
+ * pending seek is issued.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+static void
+seek_complete(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	GtkVlcPlayerSeekStats *stats = &priv->seek_stats;
+	gint64 latency;
+
+	if (!priv->seek_in_flight)
+		return;
+	priv->seek_in_flight = FALSE;
+
+	if (priv->seek_timeout_id != 0) {
+		g_source_remove(priv->seek_timeout_id);
+		priv->seek_timeout_id = 0;
+	}
+
+	latency = g_get_monotonic_time() - priv->seek_issued_at;
+	stats->last_latency = latency;
+	if (!stats->completed || latency < stats->min_latency)
+		stats->min_latency = latency;
+	if (latency > stats->max_latency)
+		stats->max_latency = latency;
+	stats->total_latency += latency;
+	stats->completed++;
+
+	seek_issue_pending(player);
+}
+
+/**
+ * @brief Step to the frame of an indexed seek.
+ *
+ * Some demuxers cannot seek precisely and land before the requested
+ * frame. While paused, the remaining frames are stepped one decode at a
+ * time (every step results in another time report).
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param time   Time reported by libVLC (milliseconds)
+ */
+static void
+seek_decode_forward(GtkVlcPlayer *player, gint64 time)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	gdouble fps;
+
+	if (priv->seek_forward_time < 0 || priv->seek_in_flight)
+		return;
+
+	/* tolerate libVLC's rounding of times */
+	fps = gtk_vlc_player_get_frame_rate(player);
+	if (fps <= 0. ||
+	    time + (gint64)(500./fps) >= priv->seek_forward_time ||
+	    priv->seek_forward_steps >= SEEK_FORWARD_MAX_STEPS ||
+	    libvlc_media_player_get_state(priv->media_player) != libvlc_Paused) {
+		priv->seek_forward_time = -1;
+		return;
+	}
+
+	priv->seek_forward_steps++;
+	libvlc_media_player_next_frame(priv->media_player);
+}
+
+static gboolean
+seek_timeout_cb(gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+
+	player->priv->seek_timeout_id = 0;
+	player->priv->seek_stats.timed_out++;
+	seek_complete(player);
+
+	return FALSE;
+}
+
+/**
+ * @brief Get the interpolated clock's time.
+ *
+ * While playing, the time is extrapolated from the last anchor, slewing
+ * in the latest correction. It never goes backwards unless the clock is
+ * anchored again.
+ *
+ * @param priv Private player data
+ * @param now  Monotonic time (microseconds)
+ * @return Media time (milliseconds)
+ */
+static gint64
+clock_now(GtkVlcPlayerPrivate *priv, gint64 now)
+{
+	gint64 elapsed, time;
+
+	if (!priv->clock_running)
+		return priv->clock_last;
+
+	elapsed = (now - priv->clock_anchor_mono)/1000;
+	time = priv->clock_anchor_time + (gint64)(elapsed*priv->clock_rate) +
+	       priv->clock_correction*MIN(elapsed, CLOCK_SLEW_PERIOD) /
+	       CLOCK_SLEW_PERIOD;
+
+	priv->clock_last = MAX(time, priv->clock_last);
+	return priv->clock_last;
+}
+
+/** @brief Let the interpolated clock jump to \e time (even backwards). */
+static void
+clock_anchor(GtkVlcPlayerPrivate *priv, gint64 time)
+{
+	priv->clock_anchor_time = time;
+	priv->clock_anchor_mono = g_get_monotonic_time();
+	priv->clock_correction = 0;
+	priv->clock_last = time;
+}
+
+/**
+ * @brief Synchronize the interpolated clock with a time reported by libVLC.
+ *
+ * While playing, small differences are slewed in over
+ * \ref CLOCK_SLEW_PERIOD. The correction is limited so that the clock
+ * advances at least at half the playback rate, i.e. it never stalls or
+ * goes backwards.
+ * After seeks and for large differences, the clock jumps instead and
+ * "time-changed" is emitted immediately.
+ */
+static void
+clock_sync(GtkVlcPlayer *player, gint64 time)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	gint64 now, predicted, error;
+
+	if (!priv->clock_running || priv->clock_update_rate == 0 ||
+	    priv->clock_resync) {
+		priv->clock_resync = FALSE;
+		update_time(player, time);
+		return;
+	}
+
+	now = g_get_monotonic_time();
+	predicted = clock_now(priv, now);
+	error = time - predicted;
+	if (ABS(error) > CLOCK_RESYNC_THRESHOLD) {
+		update_time(player, time);
+		return;
+	}
+
+	priv->clock_anchor_time = predicted;
+	priv->clock_anchor_mono = now;
+	priv->clock_correction = CLAMP(error,
+				       -(gint64)(CLOCK_SLEW_PERIOD*priv->clock_rate/2),
+				       CLOCK_SLEW_PERIOD);
+}
+
+/**
+ * @brief Start or stop extrapolating the interpolated clock.
+ *
+ * The playback rate is sampled here, so the clock does not have to call
+ * into libVLC while playing.
+ * While running, "time-changed" is emitted by a timeout at the configured
+ * update rate.
+ */
+static void
+clock_set_running(GtkVlcPlayer *player, gboolean running)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	clock_anchor(priv, clock_now(priv, g_get_monotonic_time()));
+	priv->clock_running = running;
+	if (running) {
+		gfloat rate = libvlc_media_player_get_rate(priv->media_player);
+
+		priv->clock_rate = rate > 0. ? rate : 1.;
+	}
+
+	if (priv->clock_tick_id != 0) {
+		g_source_remove(priv->clock_tick_id);
+		priv->clock_tick_id = 0;
+	}
+	if (running && priv->clock_update_rate > 0)
+		priv->clock_tick_id = gdk_threads_add_timeout(1000/priv->clock_update_rate,
+							      clock_tick_cb, player);
+}
+
+/**
+ * @brief Emit the interpolated time if it changed.
+ *
+ * Updates are rate-limited to the clock's update rate, so this may be
+ * called for every painted frame.
+ */
+static void
+clock_update(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	gint64 now = g_get_monotonic_time();
+	gint64 time;
+
+	if (!priv->clock_running || priv->clock_update_rate == 0 ||
+	    now - priv->clock_emitted_at < 1000000/priv->clock_update_rate)
+		return;
+
+	/* do not fight with widgets scrubbing the time-adjustment */
+	if (priv->scrub_settle_id != 0 || priv->seek_in_flight)
+		return;
+
+	time = clock_now(priv, now);
+	if (time != priv->clock_emitted)
+		emit_time(player, time);
+}
+
+static gboolean
+clock_tick_cb(gpointer user_data)
+{
+	clock_update(GTK_VLC_PLAYER(user_data));
+	return TRUE;
+}
+
+static void
+emit_time(GtkVlcPlayer *player, gint64 new_time)
+{
+	player->priv->clock_emitted = new_time;
+	player->priv->clock_emitted_at = g_get_monotonic_time();
+
+	g_signal_emit(player, gtk_vlc_player_signals[TIME_CHANGED_SIGNAL], 0,
+		      new_time);
+
+	if (player->priv->time_adjustment != NULL) {
+		/* ensure that time_adj_on_value_changed() will not be executed */
+		g_signal_handler_block(G_OBJECT(player->priv->time_adjustment),
+				       player->priv->time_adj_on_value_changed_id);
+		gtk_adjustment_set_value(GTK_ADJUSTMENT(player->priv->time_adjustment),
+					 (gdouble)new_time);
+		g_signal_handler_unblock(G_OBJECT(player->priv->time_adjustment),
+					 player->priv->time_adj_on_value_changed_id);
+	}
+}
+
+/** @brief Let the clock jump to \e new_time and emit it immediately. */
+static void
+update_time(GtkVlcPlayer *player, gint64 new_time)
+{
+	clock_anchor(player->priv, new_time);
+	emit_time(player, new_time);
+}
+
+static void
+update_length(GtkVlcPlayer *player, gint64 new_length)
+{
+	g_signal_emit(player, gtk_vlc_player_signals[LENGTH_CHANGED_SIGNAL], 0,
+		      new_length);
+
+	if (player->priv->time_adjustment != NULL) {
+		GtkAdjustment *adj = GTK_ADJUSTMENT(player->priv->time_adjustment);
 
 		/* ensure that time_adj_on_changed() will not be executed */
 		g_signal_handler_block(G_OBJECT(adj),
@@ -507,227 +2259,2905 @@ update_length(GtkVlcPlayer *player, gint64 new_length)
 }
 
 static void
-vlc_time_changed(const struct libvlc_event_t *event, void *user_data)
+vlc_event_queue_init(VlcEventQueue *queue)
+{
+	for (gint i = 0; i < VLC_EVENT_QUEUE_SIZE; i++)
+		queue->slots[i].seq = i;
+	queue->head = queue->tail = 0;
+	queue->dropped = 0;
+
+	for (gint i = 0; i < VLC_EVENT_N_COALESCED; i++)
+		queue->values[i].seq = queue->values[i].pending = 0;
+}
+
+/**
+ * @brief Push event into a VLC event queue without locking.
+ *
+ * May be called from any thread.
+ * Values of coalesced event types replace the previous one, so
+ * they cannot fill up the queue while the main loop is busy.
+ * Positions and sequence numbers are compared as unsigned integers,
+ * so they may safely wrap around.
+ *
+ * @param queue Queue to push into
+ * @param event Event to push (only \e type and \e u are used)
+ * @return \c FALSE if the queue is full and the event was dropped
+ */
+static gboolean
+vlc_event_queue_push(VlcEventQueue *queue, const VlcEventSlot *event)
+{
+	VlcEventSlot *slot;
+	guint pos;
+
+	if (event->type < VLC_EVENT_N_COALESCED) {
+		VlcEventValue *value = queue->values + event->type;
+		gint seq;
+
+		/* concurrent producers are serialized by the odd sequence */
+		do
+			seq = g_atomic_int_get(&value->seq) & ~1;
+		while (!g_atomic_int_compare_and_exchange(&value->seq,
+							  seq, seq + 1));
+		value->u = event->u;
+		g_atomic_int_set(&value->seq, seq + 2);
+		g_atomic_int_set(&value->pending, TRUE);
+
+		return TRUE;
+	}
+
+	pos = (guint)g_atomic_int_get(&queue->head);
+	for (;;) {
+		gint diff;
+
+		slot = queue->slots + (pos & (VLC_EVENT_QUEUE_SIZE - 1));
+		diff = (gint)((guint)g_atomic_int_get(&slot->seq) - pos);
+
+		if (diff == 0) {
+			/* slot is free: try to claim it */
+			if (g_atomic_int_compare_and_exchange(&queue->head,
+							      (gint)pos,
+							      (gint)(pos + 1)))
+				break;
+		} else if (diff < 0) {
+			/* consumer has not yet freed the slot */
+			g_atomic_int_inc(&queue->dropped);
+			return FALSE;
+		}
+
+		pos = (guint)g_atomic_int_get(&queue->head);
+	}
+
+	slot->type = event->type;
+	slot->u = event->u;
+	/* publish slot (full memory barrier) */
+	g_atomic_int_set(&slot->seq, (gint)(pos + 1));
+
+	return TRUE;
+}
+
+/**
+ * @brief Pop event from a VLC event queue.
+ *
+ * Must only be called by the consumer (the main loop).
+ *
+ * @param queue Queue to pop from
+ * @param event Location to store the event in
+ * @return \c FALSE if the queue is empty
+ */
+static gboolean
+vlc_event_queue_pop(VlcEventQueue *queue, VlcEventSlot *event)
+{
+	guint pos = (guint)queue->tail;
+	VlcEventSlot *slot = queue->slots + (pos & (VLC_EVENT_QUEUE_SIZE - 1));
+
+	if ((guint)g_atomic_int_get(&slot->seq) != pos + 1)
+		return FALSE;
+
+	event->type = slot->type;
+	event->u = slot->u;
+	/* hand slot back to producers */
+	g_atomic_int_set(&slot->seq, (gint)(pos + VLC_EVENT_QUEUE_SIZE));
+	queue->tail = (gint)(pos + 1);
+
+	return TRUE;
+}
+
+/**
+ * @brief Take the latest value of a coalesced event type.
+ *
+ * Must only be called by the consumer (the main loop).
+ *
+ * @param queue Queue to take value from
+ * @param type  Coalesced event type
+ * @param data  Location to store the value in
+ * @return \c FALSE if no value was pushed since it was last taken
+ */
+static gboolean
+vlc_event_queue_take(VlcEventQueue *queue, VlcEventType type,
+		     VlcEventData *data)
 {
-	assert(event->type == libvlc_MediaPlayerTimeChanged);
+	VlcEventValue *value = queue->values + type;
+	gint seq;
+
+	if (!g_atomic_int_compare_and_exchange(&value->pending, TRUE, FALSE))
+		return FALSE;
+
+	do {
+		seq = g_atomic_int_get(&value->seq);
+		*data = value->u;
+	} while ((seq & 1) || g_atomic_int_get(&value->seq) != seq);
 
-	/* VLC callbacks may be invoked from another thread! */
-	maybe_lock_gdk();
-	update_time(GTK_VLC_PLAYER(user_data),
-		    (gint64)event->u.media_player_time_changed.new_time);
-	maybe_unlock_gdk();
+	return TRUE;
 }
 
+/**
+ * @brief Discard pending values of coalesced event types.
+ *
+ * Used when the time is reset on the main loop (stopping, loading media),
+ * so that values of the old playback are not applied afterwards.
+ * Must only be called by the consumer (the main loop).
+ *
+ * @param queue Queue to discard values of
+ */
 static void
-vlc_length_changed(const struct libvlc_event_t *event, void *user_data)
+vlc_event_queue_discard(VlcEventQueue *queue)
+{
+	for (gint i = 0; i < VLC_EVENT_N_COALESCED; i++)
+		g_atomic_int_set(&queue->values[i].pending, FALSE);
+}
+
+static inline gboolean
+vlc_event_queue_is_empty(VlcEventQueue *queue)
 {
-	assert(event->type == libvlc_MediaPlayerLengthChanged);
+	guint pos = (guint)queue->tail;
+	VlcEventSlot *slot = queue->slots + (pos & (VLC_EVENT_QUEUE_SIZE - 1));
 
-	/* VLC callbacks may be invoked from another thread! */
-	maybe_lock_gdk();
-	update_length(GTK_VLC_PLAYER(user_data),
-		      (gint64)event->u.media_player_length_changed.new_length);
-	maybe_unlock_gdk();
+	for (gint i = 0; i < VLC_EVENT_N_COALESCED; i++)
+		if (g_atomic_int_get(&queue->values[i].pending))
+			return FALSE;
+
+	return (guint)g_atomic_int_get(&slot->seq) != pos + 1;
 }
 
+/**
+ * @brief Callback for all libVLC media player events.
+ *
+ * VLC callbacks may be invoked from another thread, so the event is only
+ * queued (without locking) and the main loop woken up.
+ * It is then handled by \ref vlc_event_source_dispatch.
+ */
 static void
-vlc_player_load_media(GtkVlcPlayer *player, libvlc_media_t *media)
+vlc_player_event_cb(const struct libvlc_event_t *event, void *user_data)
 {
-	libvlc_media_parse(media);
-	libvlc_media_player_set_media(player->priv->media_player, media);
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	VlcEventSlot vlc_event;
+
+	switch (event->type) {
+	case libvlc_MediaPlayerTimeChanged:
+		vlc_event.type = VLC_EVENT_TIME;
+		vlc_event.u.time = (gint64)event->u.media_player_time_changed.new_time;
+		break;
+	case libvlc_MediaPlayerLengthChanged:
+		vlc_event.type = VLC_EVENT_LENGTH;
+		vlc_event.u.time = (gint64)event->u.media_player_length_changed.new_length;
+		break;
+	case libvlc_MediaPlayerBuffering:
+		vlc_event.type = VLC_EVENT_BUFFERING;
+		vlc_event.u.percent = (gfloat)event->u.media_player_buffering.new_cache;
+		break;
+	case libvlc_MediaPlayerOpening:
+		vlc_event.type = VLC_EVENT_STATE;
+		vlc_event.u.state = GTK_VLC_PLAYER_STATE_OPENING;
+		break;
+	case libvlc_MediaPlayerPlaying:
+		vlc_event.type = VLC_EVENT_STATE;
+		vlc_event.u.state = GTK_VLC_PLAYER_STATE_PLAYING;
+		break;
+	case libvlc_MediaPlayerPaused:
+		vlc_event.type = VLC_EVENT_STATE;
+		vlc_event.u.state = GTK_VLC_PLAYER_STATE_PAUSED;
+		break;
+	case libvlc_MediaPlayerStopped:
+		vlc_event.type = VLC_EVENT_STATE;
+		vlc_event.u.state = GTK_VLC_PLAYER_STATE_STOPPED;
+		break;
+	case libvlc_MediaPlayerEndReached:
+		vlc_event.type = VLC_EVENT_END_REACHED;
+		break;
+	case libvlc_MediaPlayerEncounteredError:
+		vlc_event.type = VLC_EVENT_ERROR;
+		break;
+	default:
+		return;
+	}
 
-	/* NOTE: media was parsed so get_duration works */
-	update_length(player, (gint64)libvlc_media_get_duration(media));
-	update_time(player, 0);
+	if (vlc_event_queue_push(&player->priv->event_queue, &vlc_event))
+		g_main_context_wakeup(NULL);
 }
 
-/*
- * API
+/**
+ * @brief Callback for events of the standby media player.
+ *
+ * Like \ref vlc_player_event_cb, it only queues the event.
  */
+static void
+standby_event_cb(const struct libvlc_event_t *event, void *user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	VlcEventSlot vlc_event;
+
+	assert(event->type == VLC_PREROLL_EVENT);
+
+	vlc_event.type = VLC_EVENT_STANDBY_PREROLLED;
+	if (vlc_event_queue_push(&player->priv->event_queue, &vlc_event))
+		g_main_context_wakeup(NULL);
+}
+
+static void
+vlc_player_attach_events(GtkVlcPlayer *player,
+			 libvlc_media_player_t *media_player)
+{
+	libvlc_event_manager_t *evman;
+
+	evman = libvlc_media_player_event_manager(media_player);
+
+	for (guint i = 0; i < G_N_ELEMENTS(vlc_player_events); i++)
+		libvlc_event_attach(evman, vlc_player_events[i],
+				    vlc_player_event_cb, player);
+}
+
+static void
+vlc_player_detach_events(GtkVlcPlayer *player,
+			 libvlc_media_player_t *media_player)
+{
+	libvlc_event_manager_t *evman;
+
+	evman = libvlc_media_player_event_manager(media_player);
+
+	for (guint i = 0; i < G_N_ELEMENTS(vlc_player_events); i++)
+		libvlc_event_detach(evman, vlc_player_events[i],
+				    vlc_player_event_cb, player);
+}
+
+static gboolean
+vlc_event_source_prepare(GSource *source, gint *timeout)
+{
+	GtkVlcPlayer *player = ((VlcEventSource *)source)->player;
+
+	*timeout = -1;
+	return !vlc_event_queue_is_empty(&player->priv->event_queue);
+}
+
+static gboolean
+vlc_event_source_check(GSource *source)
+{
+	GtkVlcPlayer *player = ((VlcEventSource *)source)->player;
+
+	return !vlc_event_queue_is_empty(&player->priv->event_queue);
+}
 
 /**
- * @brief Construct new \e GtkVlcPlayer widget instance.
+ * @brief Drain the player's VLC event queue on the main loop.
  *
- * @return New \e GtkVlcPlayer widget instance
+ * Only the latest time, length and buffering values are emitted (they are
+ * coalesced by the queue), after the state changes, end-reached and error
+ * events, which are emitted in order.
+ * Like sources added with \e gdk_threads_add_idle, this takes the GDK lock.
  */
-GtkWidget *
-gtk_vlc_player_new(void)
+static gboolean
+vlc_event_source_dispatch(GSource *source, GSourceFunc callback,
+			  gpointer user_data)
 {
-	return GTK_WIDGET(g_object_new(GTK_TYPE_VLC_PLAYER, NULL));
+	GtkVlcPlayer *player = ((VlcEventSource *)source)->player;
+	VlcEventSlot event;
+	VlcEventData new_time, new_length, new_cache;
+
+	gboolean have_time, have_length, have_buffering;
+	gboolean have_frame = FALSE;
+
+	gdk_threads_enter();
+	/* signal handlers might destroy the widget */
+	g_object_ref(player);
+
+	while (vlc_event_queue_pop(&player->priv->event_queue, &event)) {
+		switch (event.type) {
+		case VLC_EVENT_STATE:
+			/* buffers of new media are filled for the first time */
+			if (event.u.state == GTK_VLC_PLAYER_STATE_OPENING)
+				player->priv->live_buffered = FALSE;
+			if (player->priv->resuming &&
+			    !resume_restore(player, event.u.state))
+				break;
+			clock_set_running(player, event.u.state ==
+						  GTK_VLC_PLAYER_STATE_PLAYING);
+			g_signal_emit(player,
+				      gtk_vlc_player_signals[STATE_CHANGED_SIGNAL], 0,
+				      (gint)event.u.state);
+			break;
+		case VLC_EVENT_END_REACHED:
+			clock_set_running(player, FALSE);
+			g_signal_emit(player,
+				      gtk_vlc_player_signals[STATE_CHANGED_SIGNAL], 0,
+				      (gint)GTK_VLC_PLAYER_STATE_ENDED);
+			g_signal_emit(player,
+				      gtk_vlc_player_signals[END_REACHED_SIGNAL], 0);
+			playlist_advance(player);
+			break;
+		case VLC_EVENT_ERROR:
+			g_signal_emit(player,
+				      gtk_vlc_player_signals[STATE_CHANGED_SIGNAL], 0,
+				      (gint)GTK_VLC_PLAYER_STATE_ERROR);
+			g_signal_emit(player,
+				      gtk_vlc_player_signals[ERROR_SIGNAL], 0);
+			break;
+		case VLC_EVENT_STANDBY_PREROLLED:
+			playlist_standby_prerolled(player);
+			break;
+		case VLC_EVENT_FRAME_READY:
+			have_frame = TRUE;
+			break;
+		default:
+			/* coalesced types are not queued */
+			assert(event.type >= VLC_EVENT_N_COALESCED);
+			break;
+		}
+	}
+
+	have_length = vlc_event_queue_take(&player->priv->event_queue,
+					   VLC_EVENT_LENGTH, &new_length);
+	have_time = vlc_event_queue_take(&player->priv->event_queue,
+					 VLC_EVENT_TIME, &new_time);
+	have_buffering = vlc_event_queue_take(&player->priv->event_queue,
+					      VLC_EVENT_BUFFERING, &new_cache);
+
+	if (have_length)
+		update_length(player, new_length.time);
+	/* the time is restored when resuming */
+	if (have_time && !player->priv->resuming) {
+		if (seek_has_landed(player->priv, new_time.time))
+			seek_complete(player);
+
+		/* do not fight with widgets scrubbing the time-adjustment */
+		if (player->priv->scrub_settle_id == 0 &&
+		    !player->priv->seek_in_flight)
+			clock_sync(player, new_time.time);
+		seek_decode_forward(player, new_time.time);
+	}
+	if (have_buffering) {
+		if (player->priv->live_mode)
+			live_buffering(player, new_cache.percent);
+		g_signal_emit(player, gtk_vlc_player_signals[BUFFERING_SIGNAL], 0,
+			      new_cache.percent);
+	}
+	/* only the latest frame is painted */
+	if (have_frame) {
+		gtk_widget_queue_draw(player->priv->drawing_area);
+		/* keep time updates in step with the painted frames */
+		clock_update(player);
+	}
+
+	g_object_unref(player);
+	gdk_threads_leave();
+
+	return TRUE;
+}
+
+/**
+ * @brief Load media into player.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param media  Media to load
+ * @param info   Metadata of \e media from the media index, or \c NULL
+ *               to parse the media first
+ */
+static void
+vlc_player_load_media(GtkVlcPlayer *player, libvlc_media_t *media,
+		      const GtkVlcMediaInfo *info)
+{
+	gint64 length;
+
+	vlc_player_add_media_options(player, media);
+	vlc_player_set_frame_index(player, NULL);
+
+	/* supersede pending asynchronous loads */
+	g_atomic_int_inc(&player->priv->load_generation);
+
+	if (info == NULL) {
+		libvlc_media_parse(media);
+		/* NOTE: media was parsed so get_duration works */
+		length = (gint64)libvlc_media_get_duration(media);
+	} else {
+		length = info->duration;
+	}
+	vlc_player_ensure(player);
+	vlc_player_set_media(player, player->priv->media_player, media);
+	/* the previous media was stopped, drop its time events */
+	vlc_event_queue_discard(&player->priv->event_queue);
+
+	/* media does not belong to the playlist */
+	player->priv->playlist_pos = -1;
+	playlist_prefetch(player);
+
+	update_length(player, length);
+	update_time(player, 0);
+
+	g_signal_emit(player, gtk_vlc_player_signals[MEDIA_LOADED_SIGNAL], 0);
+}
+
+/**
+ * @brief Load media into player without blocking the main loop.
+ *
+ * The media is parsed on a thread of the process-wide parser pool.
+ * Setting the media on the media player and emitting the "length-changed",
+ * "time-changed" and "media-loaded" signals happens on the main loop
+ * afterwards.
+ * Any load that is pending when this function is called is superseded and
+ * completes with \c G_IO_ERROR_CANCELLED.
+ *
+ * @param player      \e GtkVlcPlayer instance
+ * @param media       Media to load (a reference is taken)
+ * @param file        Filename of \e media to add to the media index
+ *                    after parsing, or \c NULL
+ * @param cancellable Optional \e GCancellable or \c NULL
+ * @param callback    Callback to invoke when the operation completes
+ * @param user_data   Data to pass to \e callback
+ * @param source_tag  Source tag of the calling API function
+ */
+static void
+vlc_player_load_media_async(GtkVlcPlayer *player, libvlc_media_t *media,
+			    const gchar *file, GCancellable *cancellable,
+			    GAsyncReadyCallback callback, gpointer user_data,
+			    gpointer source_tag)
+{
+	LoadMediaData *data;
+
+	vlc_player_add_media_options(player, media);
+
+	data = g_new(LoadMediaData, 1);
+	data->player = g_object_ref(player);
+	libvlc_media_retain(media);
+	data->media = media;
+	data->cancellable = cancellable != NULL ? g_object_ref(cancellable)
+						: NULL;
+	data->result = g_simple_async_result_new(G_OBJECT(player),
+						 callback, user_data,
+						 source_tag);
+	data->file = g_strdup(file);
+	/*
+	 * supersede pending asynchronous loads
+	 * (the generation is only ever changed from the main thread)
+	 */
+	g_atomic_int_inc(&player->priv->load_generation);
+	data->generation = g_atomic_int_get(&player->priv->load_generation);
+
+	parse_pool_push(media, load_media_is_cancelled,
+			load_media_async_finish_cb, data);
+}
+
+/**
+ * @brief Parse media on the process-wide parser thread pool.
+ *
+ * @param media        Media to parse (must stay referenced until
+ *                     \e finish_cb is invoked)
+ * @param is_cancelled Optional function to check whether parsing can be
+ *                     skipped. It is called from the pool thread.
+ * @param finish_cb    Function to invoke on the main loop afterwards
+ * @param user_data    Data to pass to \e is_cancelled and \e finish_cb
+ */
+static void
+parse_pool_push(libvlc_media_t *media,
+		gboolean (*is_cancelled)(gpointer user_data),
+		GSourceFunc finish_cb, gpointer user_data)
+{
+	ParseJob *job;
+
+	if (g_once_init_enter(&parse_pool_initialized)) {
+		parse_pool = g_thread_pool_new(parse_pool_worker, NULL,
+					       PARSE_POOL_MAX_THREADS,
+					       FALSE, NULL);
+		g_once_init_leave(&parse_pool_initialized, 1);
+	}
+
+	job = g_new(ParseJob, 1);
+	job->media = media;
+	job->is_cancelled = is_cancelled;
+	job->finish_cb = finish_cb;
+	job->user_data = user_data;
+
+	g_thread_pool_push(parse_pool, job, NULL);
+}
+
+static void
+parse_pool_worker(gpointer data, gpointer user_data)
+{
+	ParseJob *job = data;
+
+	/*
+	 * NOTE: parsing cannot be interrupted, but superseded jobs
+	 * waiting in the pool can be skipped
+	 */
+	if (job->is_cancelled == NULL || !job->is_cancelled(job->user_data))
+		libvlc_media_parse(job->media);
+
+	gdk_threads_add_idle(job->finish_cb, job->user_data);
+	g_free(job);
+}
+
+static gboolean
+load_media_is_cancelled(gpointer user_data)
+{
+	LoadMediaData *data = user_data;
+
+	return g_cancellable_is_cancelled(data->cancellable) ||
+	       data->generation != g_atomic_int_get(&data->player->priv->load_generation);
+}
+
+static gboolean
+load_media_async_finish_cb(gpointer user_data)
+{
+	LoadMediaData *data = user_data;
+	GtkVlcPlayer *player = data->player;
+
+	if (load_media_is_cancelled(data)) {
+		g_simple_async_result_set_error(data->result,
+						G_IO_ERROR, G_IO_ERROR_CANCELLED,
+						"Media load was cancelled");
+	} else {
+		vlc_player_ensure(player);
+		vlc_player_set_media(player, player->priv->media_player,
+				     data->media);
+		vlc_event_queue_discard(&player->priv->event_queue);
+		vlc_player_set_frame_index(player, data->file);
+
+		/* media does not belong to the playlist */
+		player->priv->playlist_pos = -1;
+		playlist_prefetch(player);
+
+		if (data->file != NULL && player->priv->media_index != NULL) {
+			GtkVlcMediaInfo info;
+
+			_gtk_vlc_media_info_from_media(data->media, &info);
+			_gtk_vlc_media_index_insert(player->priv->media_index,
+						    data->file, &info);
+		}
+
+		update_length(player,
+			      (gint64)libvlc_media_get_duration(data->media));
+		update_time(player, 0);
+
+		g_signal_emit(player,
+			      gtk_vlc_player_signals[MEDIA_LOADED_SIGNAL], 0);
+		g_simple_async_result_set_op_res_gboolean(data->result, TRUE);
+	}
+
+	g_simple_async_result_complete(data->result);
+
+	g_object_unref(data->result);
+	GOBJECT_UNREF_SAFE(data->cancellable);
+	libvlc_media_release(data->media);
+	g_object_unref(data->player);
+	g_free(data->file);
+	g_free(data);
+
+	return FALSE;
+}
+
+/**
+ * @brief Prepare the playlist item following the current one for
+ *        gapless playback.
+ *
+ * The item is parsed in the background, loaded into the standby media player
+ * and pre-rolled (muted) into the hidden standby drawing area.
+ * When it has rendered its first frame, it is paused and can be swapped in
+ * by \ref playlist_swap_standby.
+ * This must be called whenever the current position or the item following it
+ * might have changed. If the standby player already holds the right item,
+ * nothing is done.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+static void
+playlist_prefetch(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	libvlc_media_t *media = NULL;
+	PrefetchData *data;
+
+	/* prefetched again when resuming */
+	if (priv->suspended)
+		return;
+
+	if (priv->playlist_pos >= 0)
+		media = g_queue_peek_nth(priv->playlist, priv->playlist_pos + 1);
+	if (media == priv->standby_media)
+		return;
+
+	/* invalidate current standby item */
+	g_atomic_int_inc(&priv->prefetch_generation);
+	priv->standby_ready = FALSE;
+	if (priv->standby_media != NULL) {
+		/* created only once the first prefetch has been parsed */
+		if (priv->standby_player != NULL)
+			libvlc_media_player_stop(priv->standby_player);
+		libvlc_media_release(priv->standby_media);
+		priv->standby_media = NULL;
+	}
+
+	if (media == NULL)
+		return;
+
+	libvlc_media_retain(media);
+	priv->standby_media = media;
+
+	data = g_new(PrefetchData, 1);
+	data->player = g_object_ref(player);
+	libvlc_media_retain(media);
+	data->media = media;
+	data->generation = g_atomic_int_get(&priv->prefetch_generation);
+
+	parse_pool_push(media, playlist_prefetch_is_cancelled,
+			playlist_prefetch_finish_cb, data);
+}
+
+static gboolean
+playlist_prefetch_is_cancelled(gpointer user_data)
+{
+	PrefetchData *data = user_data;
+
+	return data->generation !=
+	       g_atomic_int_get(&data->player->priv->prefetch_generation);
+}
+
+static gboolean
+playlist_prefetch_finish_cb(gpointer user_data)
+{
+	PrefetchData *data = user_data;
+	GtkVlcPlayerPrivate *priv = data->player->priv;
+
+	if (!playlist_prefetch_is_cancelled(data)) {
+		if (priv->standby_player == NULL) {
+			libvlc_event_manager_t *evman;
+
+			priv->standby_player = libvlc_media_player_new(priv->vlc_inst);
+			evman = libvlc_media_player_event_manager(priv->standby_player);
+			libvlc_event_attach(evman, VLC_PREROLL_EVENT,
+					    standby_event_cb, data->player);
+
+			vlc_player_set_output(data->player, priv->standby_player,
+					      priv->standby_area);
+			if (priv->rate != 1.)
+				libvlc_media_player_set_rate(priv->standby_player,
+							     priv->rate);
+		}
+
+		vlc_player_set_media(data->player, priv->standby_player,
+				     data->media);
+		libvlc_audio_set_mute(priv->standby_player, 1);
+		libvlc_media_player_play(priv->standby_player);
+	}
+
+	libvlc_media_release(data->media);
+	g_object_unref(data->player);
+	g_free(data);
+
+	return FALSE;
+}
+
+static void
+playlist_standby_prerolled(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (priv->standby_media == NULL || priv->standby_ready)
+		return;
+
+	/* hold first frame until the standby player is swapped in */
+	libvlc_media_player_set_pause(priv->standby_player, 1);
+	libvlc_audio_set_mute(priv->standby_player, 1);
+	priv->standby_ready = TRUE;
+}
+
+/**
+ * @brief Swap the pre-rolled standby media player in.
+ *
+ * The standby player and its drawing area become the current ones and
+ * playback continues on them immediately, so switching items costs about
+ * one frame. The previous media player becomes the standby player and the
+ * item after the new current one is prefetched.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return \c FALSE if there is no pre-rolled standby item
+ */
+static gboolean
+playlist_swap_standby(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	libvlc_media_player_t *media_player;
+	libvlc_event_manager_t *evman;
+	GtkWidget *area;
+	GtkVlcAudioMeter *meter;
+
+	if (!priv->standby_ready)
+		return FALSE;
+
+	vlc_player_detach_events(player, priv->media_player);
+	evman = libvlc_media_player_event_manager(priv->standby_player);
+	libvlc_event_detach(evman, VLC_PREROLL_EVENT, standby_event_cb, player);
+
+	media_player = priv->media_player;
+	priv->media_player = priv->standby_player;
+	priv->standby_player = media_player;
+
+	area = priv->drawing_area;
+	priv->drawing_area = priv->standby_area;
+	priv->standby_area = area;
+
+	meter = priv->audio_meter;
+	priv->audio_meter = priv->standby_meter;
+	priv->standby_meter = meter;
+
+	vlc_player_attach_events(player, priv->media_player);
+	evman = libvlc_media_player_event_manager(priv->standby_player);
+	libvlc_event_attach(evman, VLC_PREROLL_EVENT, standby_event_cb, player);
+
+	libvlc_audio_set_mute(priv->media_player, 0);
+	if (priv->volume_adjustment != NULL)
+		gtk_vlc_player_set_volume(player,
+					  gtk_adjustment_get_value(GTK_ADJUSTMENT(priv->volume_adjustment)));
+	libvlc_media_player_set_pause(priv->media_player, 0);
+
+	gtk_widget_show(priv->drawing_area);
+	gtk_widget_hide(priv->standby_area);
+
+	libvlc_media_player_stop(priv->standby_player);
+
+	libvlc_media_release(priv->standby_media);
+	priv->standby_media = NULL;
+	priv->standby_ready = FALSE;
+	priv->playlist_pos++;
+	vlc_player_set_frame_index(player, NULL);
+
+	/* values of the previous media player are superseded */
+	vlc_event_queue_discard(&priv->event_queue);
+	update_length(player,
+		      (gint64)libvlc_media_player_get_length(priv->media_player));
+	update_time(player,
+		    (gint64)libvlc_media_player_get_time(priv->media_player));
+	g_signal_emit(player, gtk_vlc_player_signals[PLAYLIST_ITEM_CHANGED_SIGNAL], 0,
+		      priv->playlist_pos);
+
+	playlist_prefetch(player);
+	return TRUE;
+}
+
+/**
+ * @brief Continue with next playlist item at end of media.
+ *
+ * If the next item is not yet pre-rolled, it is loaded the ordinary way.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+static void
+playlist_advance(GtkVlcPlayer *player)
+{
+	gint pos = player->priv->playlist_pos;
+
+	if (pos < 0 || playlist_swap_standby(player))
+		return;
+
+	if (pos + 1 < (gint)g_queue_get_length(player->priv->playlist))
+		gtk_vlc_player_playlist_jump(player, (guint)(pos + 1));
+}
+
+/**
+ * @brief Take a snapshot of the current video frame.
+ *
+ * With a software renderer, the decoded frame is converted and scaled
+ * directly. Otherwise, only libVLC has access to the frame, so it is
+ * encoded to a temporary file and read back.
+ * May be called from any thread.
+ *
+ * @param media_player libVLC media player
+ * @param renderer     Software renderer of the media player or \c NULL
+ * @param width        Width of snapshot (0 to derive it from \e height)
+ * @param height       Height of snapshot (0 to derive it from \e width)
+ * @param error        Location to store error in or \c NULL
+ * @return New pixbuf or \c NULL
+ */
+static GdkPixbuf *
+snapshot_take(libvlc_media_player_t *media_player, GtkVlcRenderer *renderer,
+	      guint width, guint height, GError **error)
+{
+	GdkPixbuf *pixbuf = NULL;
+	gchar *filename;
+	gint fd;
+
+	if (renderer != NULL) {
+		pixbuf = _gtk_vlc_renderer_snapshot(renderer, width, height);
+		if (pixbuf == NULL)
+			g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				    "No video frame available");
+		return pixbuf;
+	}
+
+	fd = g_file_open_tmp("gtk-vlc-snapshot-XXXXXX.png", &filename, error);
+	if (fd < 0)
+		return NULL;
+	close(fd);
+
+	if (libvlc_video_take_snapshot(media_player, 0, filename,
+				       width, height))
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			    "No video frame available");
+	else
+		pixbuf = gdk_pixbuf_new_from_file(filename, error);
+
+	g_unlink(filename);
+	g_free(filename);
+
+	return pixbuf;
+}
+
+static void
+snapshot_thread_cb(GSimpleAsyncResult *result, GObject *object,
+		   GCancellable *cancellable)
+{
+	SnapshotData *data = g_simple_async_result_get_op_res_gpointer(result);
+	GError *error = NULL;
+
+	if (!g_cancellable_set_error_if_cancelled(cancellable, &error))
+		data->pixbuf = snapshot_take(data->media_player, data->renderer,
+					     data->width, data->height, &error);
+
+	if (error != NULL) {
+		g_simple_async_result_set_from_error(result, error);
+		g_error_free(error);
+	}
+}
+
+static void
+snapshot_data_free(gpointer data)
+{
+	SnapshotData *snapshot = data;
+
+	GOBJECT_UNREF_SAFE(snapshot->pixbuf);
+	libvlc_media_player_release(snapshot->media_player);
+	g_free(snapshot);
+}
+
+static void
+export_progress_cb(gdouble progress, gpointer user_data)
+{
+	ExportData *data = user_data;
+
+	if (data->player != NULL)
+		g_signal_emit(data->player,
+			      gtk_vlc_player_signals[EXPORT_PROGRESS_SIGNAL], 0,
+			      data->job, progress);
+}
+
+static void
+export_finish_cb(gboolean success, gpointer user_data)
+{
+	ExportData *data = user_data;
+
+	if (data->player != NULL) {
+		g_hash_table_remove(data->player->priv->export_jobs,
+				    GUINT_TO_POINTER(data->job));
+		g_signal_emit(data->player,
+			      gtk_vlc_player_signals[EXPORT_FINISHED_SIGNAL], 0,
+			      data->job, success);
+	}
+
+	g_free(data);
+}
+
+/*
+ * API
+ */
+
+/**
+ * @private
+ * @brief Get the player's current libVLC media player.
+ *
+ * The media player changes when playlist items are swapped in.
+ * Suspended players have no media player. They are controlled via the
+ * public API, which changes their saved state.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return libVLC media player (not referenced) or \c NULL if suspended
+ */
+libvlc_media_player_t *
+_gtk_vlc_player_get_media_player(GtkVlcPlayer *player)
+{
+	/* creating a media player would replace the saved media */
+	if (player->priv->suspended)
+		return NULL;
+
+	vlc_player_ensure(player);
+	return player->priv->media_player;
+}
+
+/**
+ * @brief Construct new \e GtkVlcPlayer widget instance.
+ *
+ * @return New \e GtkVlcPlayer widget instance
+ */
+GtkWidget *
+gtk_vlc_player_new(void)
+{
+	return GTK_WIDGET(g_object_new(GTK_TYPE_VLC_PLAYER, NULL));
+}
+
+/**
+ * @brief Construct new \e GtkVlcPlayer widget instance on a given libVLC instance.
+ *
+ * By default, all players share libVLC instances from a process-wide pool.
+ * This constructor allows the application to supply its own instance,
+ * e.g. one created with custom options.
+ * The widget will hold its own reference to \e instance.
+ *
+ * @param instance libVLC instance to use (\e libvlc_instance_t)
+ * @return New \e GtkVlcPlayer widget instance
+ */
+GtkWidget *
+gtk_vlc_player_new_with_instance(struct libvlc_instance_t *instance)
+{
+	return GTK_WIDGET(g_object_new(GTK_TYPE_VLC_PLAYER,
+				       "vlc-instance", instance, NULL));
+}
+
+/**
+ * @brief Construct new \e GtkVlcPlayer widget instance with libVLC options.
+ *
+ * The player uses a libVLC instance created with the given command line
+ * options, e.g. \c --no-spu or \c --no-osd to disable unused modules, or
+ * \c --avcodec-threads to limit decoder threads.
+ * Players constructed with the same options share one instance from the
+ * process-wide pool.
+ * Options that only apply to inputs (like caching) can also be set per
+ * player using \ref gtk_vlc_player_set_media_options.
+ *
+ * @param options \c NULL-terminated array of libVLC options (copied)
+ * @return New \e GtkVlcPlayer widget instance
+ */
+GtkWidget *
+gtk_vlc_player_new_with_options(const gchar *const *options)
+{
+	return GTK_WIDGET(g_object_new(GTK_TYPE_VLC_PLAYER,
+				       "vlc-options", options, NULL));
+}
+
+/**
+ * @brief Select the player's preset media options
+ *
+ * The preset's options are added to all media loaded (or inserted into
+ * the playlist) afterwards:
+ *  - \ref GTK_VLC_PLAYER_PRESET_LOW_LATENCY_LIVE reduces network and
+ *    capture buffering to 100 ms and plays frames as they arrive,
+ *    for live streams and cameras.
+ *  - \ref GTK_VLC_PLAYER_PRESET_FAST_START reduces file buffering to 50 ms
+ *    and skips looking for subtitle files, for local files.
+ *  - \ref GTK_VLC_PLAYER_PRESET_LOW_CPU prefers hardware decoding and
+ *    trades software decoding quality for speed.
+ *
+ * @sa gtk_vlc_player_set_media_options
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param preset Preset
+ */
+void
+gtk_vlc_player_set_preset(GtkVlcPlayer *player, GtkVlcPlayerPreset preset)
+{
+	g_return_if_fail(preset < G_N_ELEMENTS(preset_options));
+
+	player->priv->preset = preset;
+}
+
+/**
+ * @brief Get the player's preset media options
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return Preset
+ */
+GtkVlcPlayerPreset
+gtk_vlc_player_get_preset(GtkVlcPlayer *player)
+{
+	return player->priv->preset;
+}
+
+/**
+ * @brief Set options added to all media the player loads
+ *
+ * Options are libVLC input options like \c :network-caching=300 and are
+ * added to all media loaded (or inserted into the playlist) afterwards.
+ * They are added after the preset's options, so they override them.
+ *
+ * @param player  \e GtkVlcPlayer instance
+ * @param options \c NULL-terminated array of options (copied) or
+ *                \c NULL to remove all options
+ */
+void
+gtk_vlc_player_set_media_options(GtkVlcPlayer *player,
+				 const gchar *const *options)
+{
+	g_strfreev(player->priv->media_options);
+	player->priv->media_options = g_strdupv((gchar **)options);
+}
+
+/**
+ * @brief Enable or disable live mode
+ *
+ * Live mode is meant for live network streams (e.g. UDP or RTP camera
+ * feeds) and applies to all media loaded (or inserted into the playlist)
+ * afterwards.
+ * Network and capture caching is capped (initially to 200 ms), frames are
+ * played as they arrive and late frames are dropped instead of stalling
+ * playback.
+ * While playing, the caching adapts to the observed jitter: if playback
+ * stalls to refill its buffers or many frames are late, the caching is
+ * doubled (up to 1000 ms). After 30 seconds without problems, it is
+ * reduced by a quarter (down to 50 ms).
+ * Since libVLC applies caching when opening media, every change
+ * restarts the stream.
+ *
+ * Enabling live mode resets the live mode statistics.
+ * Options set by \ref gtk_vlc_player_set_media_options still override
+ * live mode's options.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param live   \c TRUE to enable live mode
+ */
+void
+gtk_vlc_player_set_live_mode(GtkVlcPlayer *player, gboolean live)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (priv->live_adapt_id != 0) {
+		g_source_remove(priv->live_adapt_id);
+		priv->live_adapt_id = 0;
+	}
+
+	priv->live_mode = live;
+	if (!live)
+		return;
+
+	memset(&priv->live_stats, 0, sizeof(priv->live_stats));
+	priv->live_stats.caching = LIVE_CACHING_INITIAL;
+	priv->live_stable = 0;
+	priv->live_last_stalls = 0;
+	priv->live_last_lost = 0;
+	priv->live_stalled = FALSE;
+
+	priv->live_adapt_id = gdk_threads_add_timeout(LIVE_ADAPT_INTERVAL,
+						      live_adapt_cb, player);
+}
+
+/**
+ * @brief Get whether live mode is enabled
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return \c TRUE if live mode is enabled
+ */
+gboolean
+gtk_vlc_player_get_live_mode(GtkVlcPlayer *player)
+{
+	return player->priv->live_mode;
+}
+
+/**
+ * @brief Get statistics of live mode
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param stats  Location to store statistics in
+ */
+void
+gtk_vlc_player_get_live_stats(GtkVlcPlayer *player,
+			      GtkVlcPlayerLiveStats *stats)
+{
+	*stats = player->priv->live_stats;
+}
+
+/** @brief Suspend a player that stayed hidden. */
+static gboolean
+suspend_timeout_cb(gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+
+	player->priv->suspend_id = 0;
+	gtk_vlc_player_suspend(player);
+
+	return FALSE;
+}
+
+/**
+ * @brief Restore time and state of a resumed player.
+ *
+ * Invoked for the state changes of reopening the media. The time can only
+ * be restored once the media is playing. The state changes are not
+ * reported until the saved state is reached.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param state  New state reported by libVLC
+ * @return \c TRUE if the player was restored and \e state should be
+ *         reported, \c FALSE to swallow it
+ */
+static gboolean
+resume_restore(GtkVlcPlayer *player, GtkVlcPlayerState state)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	switch (state) {
+	case GTK_VLC_PLAYER_STATE_OPENING:
+		return FALSE;
+	case GTK_VLC_PLAYER_STATE_PLAYING:
+		if (priv->resume_time >= 0) {
+			/* decode forward to the same frame */
+			vlc_player_set_time(priv->media_player,
+					    priv->resume_time, FALSE);
+			priv->resume_time = -1;
+		}
+		if (priv->resume_paused) {
+			libvlc_media_player_set_pause(priv->media_player, 1);
+			return FALSE;
+		}
+		break;
+	default:
+		/* paused, or playback failed */
+		break;
+	}
+
+	priv->resuming = FALSE;
+	return TRUE;
+}
+
+/**
+ * @brief Enable or disable automatic suspension
+ *
+ * With automatic suspension, a player that is hidden (unmapped, e.g. on a
+ * background notebook page) for more than a second is suspended (see
+ * \ref gtk_vlc_player_suspend) and resumed when it is shown again.
+ * Players in fullscreen mode are not suspended, since their video is
+ * still visible.
+ * It is disabled by default.
+ *
+ * @param player       \e GtkVlcPlayer instance
+ * @param auto_suspend \c TRUE to enable automatic suspension
+ */
+void
+gtk_vlc_player_set_auto_suspend(GtkVlcPlayer *player, gboolean auto_suspend)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	priv->auto_suspend = auto_suspend;
+
+	if (!auto_suspend && priv->suspend_id != 0) {
+		g_source_remove(priv->suspend_id);
+		priv->suspend_id = 0;
+	} else if (auto_suspend && priv->suspend_id == 0 &&
+		   !gtk_widget_get_mapped(GTK_WIDGET(player)) &&
+		   !priv->isFullscreen && priv->media_player != NULL) {
+		priv->suspend_id = gdk_threads_add_timeout(SUSPEND_DELAY,
+							   suspend_timeout_cb,
+							   player);
+	}
+}
+
+/**
+ * @brief Get whether automatic suspension is enabled
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return \c TRUE if automatic suspension is enabled
+ */
+gboolean
+gtk_vlc_player_get_auto_suspend(GtkVlcPlayer *player)
+{
+	return player->priv->auto_suspend;
+}
+
+/**
+ * @brief Suspend player, releasing its media players
+ *
+ * The current media, playback time, state and volume are saved and the
+ * media players are released along with their decoders, video outputs
+ * and frame buffers. No signals are emitted for this.
+ *
+ * While suspended, playing, pausing, stopping and seeking only change
+ * the saved state. Loading media replaces the saved media and resumes the
+ * player (asynchronous loads once the media has been parsed).
+ * The playlist is kept and items may still be inserted and jumped to.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+void
+gtk_vlc_player_suspend(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (priv->suspended || priv->media_player == NULL)
+		return;
+
+	if (priv->resuming) {
+		/* not yet restored */
+		priv->suspend_state = priv->resume_paused
+					? GTK_VLC_PLAYER_STATE_PAUSED
+					: GTK_VLC_PLAYER_STATE_PLAYING;
+	} else {
+		switch (libvlc_media_player_get_state(priv->media_player)) {
+		case libvlc_Opening:
+		case libvlc_Buffering:
+		case libvlc_Playing:
+			priv->suspend_state = GTK_VLC_PLAYER_STATE_PLAYING;
+			break;
+		case libvlc_Paused:
+			priv->suspend_state = GTK_VLC_PLAYER_STATE_PAUSED;
+			break;
+		default:
+			priv->suspend_state = GTK_VLC_PLAYER_STATE_STOPPED;
+			break;
+		}
+	}
+	priv->resuming = FALSE;
+
+	priv->suspend_media = libvlc_media_player_get_media(priv->media_player);
+	/* the interpolated time is that of the frame displayed */
+	priv->suspend_time = gtk_vlc_player_get_time(player);
+	priv->suspend_length = gtk_vlc_player_get_length(player);
+	priv->suspend_volume = libvlc_audio_get_volume(priv->media_player);
+	priv->suspend_mute = libvlc_audio_get_mute(priv->media_player);
+
+	/* cancel pending loads, prefetches and seeks */
+	g_atomic_int_inc(&priv->load_generation);
+	g_atomic_int_inc(&priv->prefetch_generation);
+	if (priv->seek_timeout_id != 0) {
+		g_source_remove(priv->seek_timeout_id);
+		priv->seek_timeout_id = 0;
+	}
+	if (priv->scrub_settle_id != 0) {
+		g_source_remove(priv->scrub_settle_id);
+		priv->scrub_settle_id = 0;
+	}
+	priv->seek_in_flight = priv->seek_pending = FALSE;
+	priv->seek_forward_time = -1;
+
+	clock_set_running(player, FALSE);
+
+	/* no events are reported for stopping */
+	vlc_player_detach_events(player, priv->media_player);
+	libvlc_media_player_stop(priv->media_player);
+	libvlc_media_player_release(priv->media_player);
+	priv->media_player = NULL;
+
+	g_source_destroy(priv->event_source);
+	g_source_unref(priv->event_source);
+	priv->event_source = NULL;
+
+	if (priv->standby_player != NULL) {
+		libvlc_event_manager_t *evman;
+
+		evman = libvlc_media_player_event_manager(priv->standby_player);
+		libvlc_event_detach(evman, VLC_PREROLL_EVENT,
+				    standby_event_cb, player);
+		libvlc_media_player_stop(priv->standby_player);
+		libvlc_media_player_release(priv->standby_player);
+		priv->standby_player = NULL;
+	}
+	if (priv->standby_media != NULL) {
+		libvlc_media_release(priv->standby_media);
+		priv->standby_media = NULL;
+	}
+	priv->standby_ready = FALSE;
+
+	priv->suspended = TRUE;
+}
+
+/**
+ * @brief Resume suspended player
+ *
+ * A new media player is created and the saved media is reopened.
+ * If it was playing or paused, playback continues at the saved time,
+ * displaying the same frame. "state-changed" is only emitted once the
+ * saved state is reached again.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+void
+gtk_vlc_player_resume(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (!priv->suspended)
+		return;
+	priv->suspended = FALSE;
+
+	vlc_player_ensure(player);
+	libvlc_audio_set_volume(priv->media_player, priv->suspend_volume);
+	libvlc_audio_set_mute(priv->media_player, priv->suspend_mute);
+
+	if (priv->suspend_media == NULL)
+		return;
+	vlc_player_set_media(player, priv->media_player, priv->suspend_media);
+	libvlc_media_release(priv->suspend_media);
+	priv->suspend_media = NULL;
+
+	if (priv->suspend_state == GTK_VLC_PLAYER_STATE_PLAYING ||
+	    priv->suspend_state == GTK_VLC_PLAYER_STATE_PAUSED) {
+		priv->resuming = TRUE;
+		priv->resume_time = priv->suspend_time;
+		priv->resume_paused = priv->suspend_state ==
+				      GTK_VLC_PLAYER_STATE_PAUSED;
+		libvlc_media_player_play(priv->media_player);
+	}
+
+	if (priv->playlist_pos >= 0)
+		playlist_prefetch(player);
+}
+
+/**
+ * @brief Get whether player is suspended
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return \c TRUE if suspended
+ */
+gboolean
+gtk_vlc_player_is_suspended(GtkVlcPlayer *player)
+{
+	return player->priv->suspended;
+}
+
+/**
+ * @brief Load media with specified filename into player widget
+ *
+ * It does not start playing until playback is started or toggled.
+ * "time-changed", "length-changed" and "media-loaded" signals will be emitted
+ * immediately after successfully loading the media. The time-adjustment will also be
+ * reconfigured appropriately.
+ *
+ * @param player \e GtkVlcPlayer instance to load file into.
+ * @param file   \e Filename to load
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_load_filename(GtkVlcPlayer *player, const gchar *file)
+{
+	GtkVlcMediaIndex *index = player->priv->media_index;
+	GtkVlcMediaInfo info;
+	libvlc_media_t *media;
+
+	media = libvlc_media_new_path(vlc_player_ensure_instance(player),
+				      (const char *)file);
+	if (media == NULL)
+		return FALSE;
+
+	if (index != NULL && gtk_vlc_media_index_lookup(index, file, &info)) {
+		vlc_player_load_media(player, media, &info);
+	} else {
+		vlc_player_load_media(player, media, NULL);
+		if (index != NULL) {
+			_gtk_vlc_media_info_from_media(media, &info);
+			_gtk_vlc_media_index_insert(index, file, &info);
+		}
+	}
+	vlc_player_set_frame_index(player, file);
+	libvlc_media_release(media);
+
+	return TRUE;
+}
+
+/**
+ * @brief Load media with specified URI into player widget
+ *
+ * It is otherwise identical to \ref gtk_vlc_player_load_filename.
+ *
+ * @sa gtk_vlc_player_load_filename
+ *
+ * @param player \e GtkVlcPlayer instance to load media into.
+ * @param uri    \e URI to load
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_load_uri(GtkVlcPlayer *player, const gchar *uri)
+{
+	libvlc_media_t *media;
+
+	media = libvlc_media_new_location(vlc_player_ensure_instance(player),
+					  (const char *)uri);
+	if (media == NULL)
+		return FALSE;
+	vlc_player_load_media(player, media, NULL);
+	libvlc_media_release(media);
+
+	return TRUE;
+}
+
+/**
+ * @brief Load media from a \e GInputStream into player widget
+ *
+ * The media is read directly from \e stream, e.g. a decrypting or
+ * archive-extracting stream, so it does not have to be written to a
+ * temporary file first.
+ * The player keeps a reference to \e stream and closes it when the media
+ * is no longer used.
+ * If \e stream is seekable (\e GSeekable), the player can seek in the media
+ * and the media is parsed just like \ref gtk_vlc_player_load_filename does.
+ * Otherwise the media is not parsed, since that would consume the stream,
+ * so its length is only known once playback started.
+ *
+ * Loading streams requires libVLC 3.0 or later.
+ *
+ * @param player \e GtkVlcPlayer instance to load media into.
+ * @param stream \e GInputStream to read media from
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_load_stream(GtkVlcPlayer *player, GInputStream *stream)
+{
+	static const GtkVlcMediaInfo unparsed_info; /* all zero */
+	libvlc_media_t *media;
+	gboolean seekable;
+
+	g_return_val_if_fail(G_IS_INPUT_STREAM(stream), FALSE);
+
+	seekable = G_IS_SEEKABLE(stream) &&
+		   g_seekable_can_seek(G_SEEKABLE(stream));
+
+	media = _gtk_vlc_media_new_stream(vlc_player_ensure_instance(player),
+					  stream);
+	if (media == NULL)
+		return FALSE;
+	vlc_player_load_media(player, media, seekable ? NULL : &unparsed_info);
+	libvlc_media_release(media);
+
+	return TRUE;
+}
+
+/**
+ * @brief Load media from memory into player widget
+ *
+ * \e data is read in place, so it may for instance be a memory mapped
+ * file (see \e GMappedFile) or a clip decrypted into memory.
+ * It must stay valid until the player no longer uses the media, i.e. until
+ * another media is loaded or the player is destroyed.
+ * \e destroy is invoked with \e user_data at that point to free it, or
+ * immediately if loading fails.
+ * It is otherwise identical to \ref gtk_vlc_player_load_filename.
+ *
+ * Loading from memory requires libVLC 3.0 or later.
+ *
+ * @param player    \e GtkVlcPlayer instance to load media into.
+ * @param data      Media data
+ * @param size      Size of \e data in bytes
+ * @param destroy   Function to free \e data with or \c NULL
+ * @param user_data Data to pass to \e destroy (e.g. the \e GMappedFile)
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_load_bytes(GtkVlcPlayer *player, gconstpointer data, gsize size,
+			  GDestroyNotify destroy, gpointer user_data)
+{
+	libvlc_media_t *media;
+
+	media = _gtk_vlc_media_new_bytes(vlc_player_ensure_instance(player),
+					 data, size, destroy, user_data);
+	if (media == NULL)
+		return FALSE;
+	vlc_player_load_media(player, media, NULL);
+	libvlc_media_release(media);
+
+	return TRUE;
+}
+
+/**
+ * @brief Asynchronously load media with specified filename into player widget
+ *
+ * In contrast to \ref gtk_vlc_player_load_filename, the media is parsed in
+ * a background thread, so the main loop is never blocked.
+ * When parsing is done, the media is loaded into the player, "length-changed",
+ * "time-changed" and "media-loaded" signals are emitted and \e callback is
+ * invoked on the main loop.
+ * Starting another load on \e player (synchronous or asynchronous)
+ * supersedes a pending one, which will then fail with
+ * \c G_IO_ERROR_CANCELLED.
+ * If the player has a media index with a fresh entry for \e file, parsing is
+ * skipped and the media is loaded immediately.
+ *
+ * @sa gtk_vlc_player_set_media_index
+ *
+ * @param player      \e GtkVlcPlayer instance to load file into.
+ * @param file        \e Filename to load
+ * @param cancellable Optional \e GCancellable object, \c NULL to ignore
+ * @param callback    Callback to invoke when the request is satisfied
+ * @param user_data   The data to pass to \e callback
+ */
+void
+gtk_vlc_player_load_filename_async(GtkVlcPlayer *player, const gchar *file,
+				   GCancellable *cancellable,
+				   GAsyncReadyCallback callback,
+				   gpointer user_data)
+{
+	GtkVlcMediaInfo info;
+	libvlc_media_t *media;
+
+	media = libvlc_media_new_path(vlc_player_ensure_instance(player),
+				      (const char *)file);
+	if (media == NULL) {
+		g_simple_async_report_error_in_idle(G_OBJECT(player),
+						    callback, user_data,
+						    G_IO_ERROR, G_IO_ERROR_FAILED,
+						    "Cannot create media for \"%s\"",
+						    file);
+		return;
+	}
+
+	if (player->priv->media_index != NULL &&
+	    gtk_vlc_media_index_lookup(player->priv->media_index, file, &info)) {
+		GSimpleAsyncResult *result;
+
+		/* no need to parse, so this does not block */
+		vlc_player_load_media(player, media, &info);
+		vlc_player_set_frame_index(player, file);
+
+		result = g_simple_async_result_new(G_OBJECT(player),
+						   callback, user_data,
+						   gtk_vlc_player_load_filename_async);
+		g_simple_async_result_set_op_res_gboolean(result, TRUE);
+		g_simple_async_result_complete_in_idle(result);
+		g_object_unref(result);
+	} else {
+		vlc_player_load_media_async(player, media, file, cancellable,
+					    callback, user_data,
+					    gtk_vlc_player_load_filename_async);
+	}
+	libvlc_media_release(media);
+}
+
+/**
+ * @brief Finish asynchronous load started with
+ *        \ref gtk_vlc_player_load_filename_async
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param result \e GAsyncResult passed to the callback
+ * @param error  Return location for a \e GError, or \c NULL
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_load_filename_finish(GtkVlcPlayer *player, GAsyncResult *result,
+				    GError **error)
+{
+	GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT(result);
+
+	if (g_simple_async_result_propagate_error(simple, error))
+		return FALSE;
+
+	return g_simple_async_result_get_op_res_gboolean(simple);
+}
+
+/**
+ * @brief Asynchronously load media with specified URI into player widget
+ *
+ * It is otherwise identical to \ref gtk_vlc_player_load_filename_async.
+ *
+ * @sa gtk_vlc_player_load_filename_async
+ *
+ * @param player      \e GtkVlcPlayer instance to load media into.
+ * @param uri         \e URI to load
+ * @param cancellable Optional \e GCancellable object, \c NULL to ignore
+ * @param callback    Callback to invoke when the request is satisfied
+ * @param user_data   The data to pass to \e callback
+ */
+void
+gtk_vlc_player_load_uri_async(GtkVlcPlayer *player, const gchar *uri,
+			      GCancellable *cancellable,
+			      GAsyncReadyCallback callback, gpointer user_data)
+{
+	libvlc_media_t *media;
+
+	media = libvlc_media_new_location(vlc_player_ensure_instance(player),
+					  (const char *)uri);
+	if (media == NULL) {
+		g_simple_async_report_error_in_idle(G_OBJECT(player),
+						    callback, user_data,
+						    G_IO_ERROR, G_IO_ERROR_FAILED,
+						    "Cannot create media for \"%s\"",
+						    uri);
+		return;
+	}
+	vlc_player_load_media_async(player, media, NULL, cancellable,
+				    callback, user_data,
+				    gtk_vlc_player_load_uri_async);
+	libvlc_media_release(media);
+}
+
+/**
+ * @brief Finish asynchronous load started with
+ *        \ref gtk_vlc_player_load_uri_async
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param result \e GAsyncResult passed to the callback
+ * @param error  Return location for a \e GError, or \c NULL
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_load_uri_finish(GtkVlcPlayer *player, GAsyncResult *result,
+			       GError **error)
+{
+	return gtk_vlc_player_load_filename_finish(player, result, error);
+}
+
+/**
+ * @brief Set media index used when loading files
+ *
+ * When loading files with \ref gtk_vlc_player_load_filename or
+ * \ref gtk_vlc_player_load_filename_async, the index is consulted first.
+ * If it contains a fresh entry for the file, parsing is skipped.
+ * Otherwise the file is parsed and the index is updated.
+ * The index is not owned by the player and must stay valid until it is
+ * unset or the player is destroyed.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param index  Media index or \c NULL to unset it
+ */
+void
+gtk_vlc_player_set_media_index(GtkVlcPlayer *player, GtkVlcMediaIndex *index)
+{
+	player->priv->media_index = index;
+}
+
+/**
+ * @brief Replace the frame index of the current media.
+ *
+ * With frame-accurate seeking, an index of \e file is built (or loaded
+ * from the cache next to the media index).
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param file   Filename of current media or \c NULL
+ */
+static void
+vlc_player_set_frame_index(GtkVlcPlayer *player, const gchar *file)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	gchar *cache_dir = NULL;
+
+	if (priv->frame_index != NULL) {
+		gtk_vlc_frame_index_free(priv->frame_index);
+		priv->frame_index = NULL;
+	}
+	priv->seek_forward_time = -1;
+
+	if (file == NULL || !priv->frame_accurate)
+		return;
+
+	if (priv->media_index != NULL)
+		cache_dir = _gtk_vlc_media_index_get_cache_dir(priv->media_index);
+	priv->frame_index = gtk_vlc_frame_index_new(file, cache_dir);
+	g_free(cache_dir);
+}
+
+/**
+ * @brief Enable or disable frame-accurate seeking
+ *
+ * For files loaded afterwards with \ref gtk_vlc_player_load_filename or
+ * \ref gtk_vlc_player_load_filename_async, an index of frame and
+ * keyframe positions is built in the background (see
+ * \ref gtk_vlc_frame_index_new). If a media index is set, the frame
+ * index is cached in a directory next to it.
+ *
+ * Seeks (except fast seeks while scrubbing) into the part of the file
+ * indexed so far land on the exact frame displayed at the requested time:
+ * the seek targets the frame's time, so libVLC decodes forward from the
+ * nearest preceding keyframe. If the demuxer lands before the frame while
+ * paused, the remaining frames are stepped.
+ *
+ * @param player   \e GtkVlcPlayer instance
+ * @param accurate \c TRUE to enable frame-accurate seeking
+ */
+void
+gtk_vlc_player_set_frame_accurate(GtkVlcPlayer *player, gboolean accurate)
+{
+	player->priv->frame_accurate = accurate;
+	if (!accurate)
+		vlc_player_set_frame_index(player, NULL);
+}
+
+/**
+ * @brief Get whether frame-accurate seeking is enabled
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return \c TRUE if frame-accurate seeking is enabled
+ */
+gboolean
+gtk_vlc_player_get_frame_accurate(GtkVlcPlayer *player)
+{
+	return player->priv->frame_accurate;
+}
+
+/**
+ * @brief Get the frame index of the current media
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return Frame index owned by the player or \c NULL if frame-accurate
+ *         seeking is disabled or the media is not a file
+ */
+GtkVlcFrameIndex *
+gtk_vlc_player_get_frame_index(GtkVlcPlayer *player)
+{
+	return player->priv->frame_index;
+}
+
+/**
+ * @brief Play back media if playback is currently paused
+ *
+ * If it is already playing, do nothing.
+ * In playback mode, there will be constant "time-changed" signal emissions
+ * and the time-adjustment's value will be set accordingly.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+void
+gtk_vlc_player_play(GtkVlcPlayer *player)
+{
+	if (player->priv->suspended) {
+		player->priv->suspend_state = GTK_VLC_PLAYER_STATE_PLAYING;
+		return;
+	}
+	if (player->priv->media_player == NULL ||
+	    libvlc_media_player_play(player->priv->media_player) < 0)
+		return;
+
+	/*
+	 * Workaround to get mouse click events on the drawing area widget
+	 * that provides the low-level window for libVLC.
+	 * On Win32, libVLC creates an event window (in a different thread)
+	 * after playback start that "swallows" all click events.
+	 * So we have to poll for the availability of that window and disable
+	 * it.
+	 */
+#ifdef G_OS_WIN32
+	g_timeout_add(POLL_VLC_EVENT_WINDOW_INTERVAL,
+		      poll_vlc_event_window_cb, player);
+#endif
+}
+
+/**
+ * @brief Pause media playback if it is currently playing
+ *
+ * If it is already paused, do nothing.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+void
+gtk_vlc_player_pause(GtkVlcPlayer *player)
+{
+	if (player->priv->suspended &&
+	    player->priv->suspend_state == GTK_VLC_PLAYER_STATE_PLAYING)
+		player->priv->suspend_state = GTK_VLC_PLAYER_STATE_PAUSED;
+	if (player->priv->media_player != NULL)
+		libvlc_media_player_pause(player->priv->media_player);
+}
+
+/**
+ * @brief Toggle media playback
+ *
+ * If it is currently playing, pause playback. If it is currently paused,
+ * start playback.
+ *
+ * @sa gtk_vlc_player_play
+ * @sa gtk_vlc_player_pause
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return \c TRUE if media is playing \b after the operation,
+ *         \c FALSE if it is paused.
+ */
+gboolean
+gtk_vlc_player_toggle(GtkVlcPlayer *player)
+{
+	if (player->priv->suspended) {
+		if (player->priv->suspend_state == GTK_VLC_PLAYER_STATE_PLAYING)
+			gtk_vlc_player_pause(player);
+		else
+			gtk_vlc_player_play(player);
+
+		return player->priv->suspend_state == GTK_VLC_PLAYER_STATE_PLAYING;
+	}
+	if (player->priv->media_player == NULL)
+		return FALSE;
+
+	if (libvlc_media_player_is_playing(player->priv->media_player))
+		gtk_vlc_player_pause(player);
+	else
+		gtk_vlc_player_play(player);
+
+	return (gboolean)libvlc_media_player_is_playing(player->priv->media_player);
+}
+
+/**
+ * @brief Stop media playback
+ *
+ * A "time-changed" signal will be emitted and the time-adjustment will be
+ * reset appropriately.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+void
+gtk_vlc_player_stop(GtkVlcPlayer *player)
+{
+	if (player->priv->suspended) {
+		player->priv->suspend_state = GTK_VLC_PLAYER_STATE_STOPPED;
+		player->priv->suspend_time = 0;
+	}
+	if (player->priv->media_player != NULL) {
+		gtk_vlc_player_pause(player);
+		/* time events are not emitted after stopping returns */
+		libvlc_media_player_stop(player->priv->media_player);
+		vlc_event_queue_discard(&player->priv->event_queue);
+	}
+
+	update_time(player, 0);
+}
+
+/**
+ * @brief Set point of time in playback
+ *
+ * There is at most one seek in flight at a time. If another seek is still
+ * being processed by libVLC, the request is deferred until it completes
+ * and replaces any other deferred request (latest wins).
+ *
+ * @sa gtk_vlc_player_get_seek_stats
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param time   New position in media (milliseconds)
+ */
+void
+gtk_vlc_player_seek(GtkVlcPlayer *player, gint64 time)
+{
+	seek_schedule(player, time, FALSE);
+}
+
+/**
+ * @brief Advance playback by one video frame
+ *
+ * Playback is paused (if it is not already) and the next frame is
+ * decoded and displayed. Unlike seeking, this does not decode from the
+ * preceding keyframe, so it is cheap enough for stepping through media
+ * frame by frame.
+ * The playback time advances by one frame duration if the frame rate is
+ * known (see \ref gtk_vlc_player_get_frame_rate).
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+void
+gtk_vlc_player_next_frame(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	gint64 frame;
+
+	if (priv->media_player == NULL)
+		return;
+
+	libvlc_media_player_next_frame(priv->media_player);
+	priv->seek_forward_time = -1;
+
+	/* libVLC reports the paused state and new time later */
+	clock_set_running(player, FALSE);
+	frame = gtk_vlc_player_time_to_frame(player, priv->clock_last);
+	if (frame >= 0)
+		update_time(player, gtk_vlc_player_frame_to_time(player, frame + 1));
+}
+
+/**
+ * @brief Set playback rate
+ *
+ * Rates below 1.0 slow playback down, rates above 1.0 speed it up
+ * (e.g. for shuttling through media at 0.25x to 8x).
+ * Audio is time-stretched by libVLC, preserving its pitch (unless the
+ * libVLC instance was created with \c --no-audio-time-stretch).
+ * The rate is kept for all media loaded afterwards.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param rate   Playback rate (1.0 is normal speed)
+ */
+void
+gtk_vlc_player_set_rate(GtkVlcPlayer *player, gfloat rate)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	g_return_if_fail(rate > 0.);
+
+	priv->rate = rate;
+	if (priv->media_player != NULL)
+		libvlc_media_player_set_rate(priv->media_player, rate);
+	if (priv->standby_player != NULL)
+		libvlc_media_player_set_rate(priv->standby_player, rate);
+
+	/* extrapolate at the new rate from now on */
+	clock_anchor(priv, clock_now(priv, g_get_monotonic_time()));
+	priv->clock_rate = rate;
+}
+
+/**
+ * @brief Get playback rate
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return Playback rate (1.0 is normal speed)
+ */
+gfloat
+gtk_vlc_player_get_rate(GtkVlcPlayer *player)
+{
+	return player->priv->rate;
+}
+
+/**
+ * @brief Get seek statistics
+ *
+ * Statistics cover all seeks since the player was constructed or the
+ * statistics were reset, including seeks caused by changing the
+ * time-adjustment.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param stats  Location to store statistics in
+ */
+void
+gtk_vlc_player_get_seek_stats(GtkVlcPlayer *player,
+			      GtkVlcPlayerSeekStats *stats)
+{
+	*stats = player->priv->seek_stats;
+}
+
+/**
+ * @brief Reset seek statistics
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+void
+gtk_vlc_player_reset_seek_stats(GtkVlcPlayer *player)
+{
+	memset(&player->priv->seek_stats, 0, sizeof(player->priv->seek_stats));
+}
+
+/**
+ * @brief Set how the player renders video
+ *
+ * In \ref GTK_VLC_PLAYER_RENDER_WINDOW mode (the default), libVLC renders
+ * directly into the widget's window. This is the most efficient mode, but
+ * the video cannot be composited with other drawing.
+ * In \ref GTK_VLC_PLAYER_RENDER_SOFTWARE mode, libVLC delivers decoded
+ * frames into a small ring of reusable buffers and the widget paints the
+ * latest one using cairo. Frames replaced before they could be painted
+ * are dropped, so a busy main loop never stalls the decoder.
+ *
+ * The mode takes effect when the video output is (re)created, so it
+ * should be set before loading media.
+ *
+ * @sa gtk_vlc_player_get_frame_stats
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param mode   Render mode
+ */
+void
+gtk_vlc_player_set_render_mode(GtkVlcPlayer *player,
+			       GtkVlcPlayerRenderMode mode)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (priv->render_mode == mode)
+		return;
+	priv->render_mode = mode;
+
+	if (mode == GTK_VLC_PLAYER_RENDER_SOFTWARE && priv->renderers[0] == NULL) {
+		priv->renderers[0] = _gtk_vlc_renderer_new(renderer_frame_ready_cb,
+							   player);
+		g_object_set_data(G_OBJECT(priv->drawing_area), "gtk-vlc-renderer",
+				  priv->renderers[0]);
+		priv->renderers[1] = _gtk_vlc_renderer_new(renderer_frame_ready_cb,
+							   player);
+		g_object_set_data(G_OBJECT(priv->standby_area), "gtk-vlc-renderer",
+				  priv->renderers[1]);
+	}
+
+	if (priv->media_player != NULL)
+		vlc_player_set_output(player, priv->media_player,
+				      priv->drawing_area);
+	if (priv->standby_player != NULL)
+		vlc_player_set_output(player, priv->standby_player,
+				      priv->standby_area);
+
+	gtk_widget_queue_draw(priv->drawing_area);
+}
+
+/**
+ * @brief Get how the player renders video
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return Render mode
+ */
+GtkVlcPlayerRenderMode
+gtk_vlc_player_get_render_mode(GtkVlcPlayer *player)
+{
+	return player->priv->render_mode;
+}
+
+/**
+ * @brief Get frame statistics of the software renderer
+ *
+ * Statistics accumulate over the player's lifetime and are all zero
+ * unless the software render mode has been used.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param stats  Location to store statistics in
+ */
+void
+gtk_vlc_player_get_frame_stats(GtkVlcPlayer *player,
+			       GtkVlcPlayerFrameStats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	for (guint i = 0; i < G_N_ELEMENTS(player->priv->renderers); i++)
+		if (player->priv->renderers[i] != NULL)
+			_gtk_vlc_renderer_add_stats(player->priv->renderers[i],
+						    stats);
+}
+
+/**
+ * @brief Take a snapshot of the current video frame
+ *
+ * In \ref GTK_VLC_PLAYER_RENDER_SOFTWARE mode, the snapshot is converted
+ * and scaled straight from the latest decoded frame, without encoding it.
+ * This takes about as long as painting the frame once.
+ * In \ref GTK_VLC_PLAYER_RENDER_WINDOW mode, the decoded frame is only
+ * accessible to libVLC, so it is written to a temporary PNG file and
+ * read back, which is considerably slower.
+ *
+ * If only one of \e width and \e height is 0, it is derived from the
+ * other one, preserving the aspect ratio. If both are 0, the snapshot has
+ * the video's size.
+ *
+ * @sa gtk_vlc_player_snapshot_async
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param width  Width of snapshot
+ * @param height Height of snapshot
+ * @return New \e GdkPixbuf (unreference with \c g_object_unref) or
+ *         \c NULL if there is no video frame
+ */
+GdkPixbuf *
+gtk_vlc_player_snapshot(GtkVlcPlayer *player, guint width, guint height)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	GtkVlcRenderer *renderer = NULL;
+
+	if (priv->media_player == NULL)
+		return NULL;
+
+	if (priv->render_mode == GTK_VLC_PLAYER_RENDER_SOFTWARE)
+		renderer = g_object_get_data(G_OBJECT(priv->drawing_area),
+					     "gtk-vlc-renderer");
+
+	return snapshot_take(priv->media_player, renderer,
+			     width, height, NULL);
+}
+
+/**
+ * @brief Take a snapshot of the current video frame asynchronously
+ *
+ * The frame is pinned (software render mode) or requested from libVLC
+ * (window render mode) in a worker thread, and scaled there, so the main
+ * loop is never blocked.
+ * See \ref gtk_vlc_player_snapshot for details.
+ *
+ * @param player      \e GtkVlcPlayer instance
+ * @param width       Width of snapshot
+ * @param height      Height of snapshot
+ * @param cancellable Optional \e GCancellable or \c NULL
+ * @param callback    Callback to invoke when the snapshot has been taken
+ * @param user_data   Data to pass to \e callback
+ */
+void
+gtk_vlc_player_snapshot_async(GtkVlcPlayer *player, guint width, guint height,
+			      GCancellable *cancellable,
+			      GAsyncReadyCallback callback, gpointer user_data)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	GSimpleAsyncResult *result;
+	SnapshotData *data;
+
+	if (priv->media_player == NULL) {
+		g_simple_async_report_error_in_idle(G_OBJECT(player),
+						    callback, user_data,
+						    G_IO_ERROR, G_IO_ERROR_FAILED,
+						    "No video frame available");
+		return;
+	}
+
+	data = g_new0(SnapshotData, 1);
+	/* the media player may be swapped by the playlist meanwhile */
+	libvlc_media_player_retain(priv->media_player);
+	data->media_player = priv->media_player;
+	/* renderers live as long as the player, which the result references */
+	if (priv->render_mode == GTK_VLC_PLAYER_RENDER_SOFTWARE)
+		data->renderer = g_object_get_data(G_OBJECT(priv->drawing_area),
+						   "gtk-vlc-renderer");
+	data->width = width;
+	data->height = height;
+
+	result = g_simple_async_result_new(G_OBJECT(player), callback, user_data,
+					   gtk_vlc_player_snapshot_async);
+	g_simple_async_result_set_op_res_gpointer(result, data,
+						  snapshot_data_free);
+	g_simple_async_result_run_in_thread(result, snapshot_thread_cb,
+					    G_PRIORITY_DEFAULT, cancellable);
+	g_object_unref(result);
+}
+
+/**
+ * @brief Finish a snapshot started with \ref gtk_vlc_player_snapshot_async
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param result Result passed to the callback
+ * @param error  Location to store error in or \c NULL
+ * @return New \e GdkPixbuf (unreference with \c g_object_unref) or
+ *         \c NULL on error
+ */
+GdkPixbuf *
+gtk_vlc_player_snapshot_finish(GtkVlcPlayer *player, GAsyncResult *result,
+			       GError **error)
+{
+	GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT(result);
+	SnapshotData *data;
+
+	if (g_simple_async_result_propagate_error(simple, error))
+		return NULL;
+
+	data = g_simple_async_result_get_op_res_gpointer(simple);
+	return g_object_ref(data->pixbuf);
+}
+
+/**
+ * @brief Export a segment of the current media to a file
+ *
+ * The segment from \e in to \e out is written in the background by a
+ * headless libVLC media player, independent of playback. At most two
+ * segments are written at a time, further exports are queued.
+ * The container format is chosen by the extension of \e filename
+ * (e.g. ".mp4", ".mkv" or ".ts").
+ *
+ * The streams are copied without re-encoding (remuxed) if the cut
+ * allows it. With frame-accurate seeking enabled (see
+ * \ref gtk_vlc_player_set_frame_accurate) and the frame index complete,
+ * the segment is re-encoded if \e in is not on a keyframe. Otherwise it
+ * is always remuxed, starting at the keyframe at or before \e in.
+ *
+ * "export-progress" signals report the job's progress while writing,
+ * "export-finished" signals its completion. Unsuccessful or cancelled
+ * exports leave no file behind.
+ *
+ * @param player   \e GtkVlcPlayer instance
+ * @param filename File to write
+ * @param in       Start of segment (milliseconds)
+ * @param out      End of segment (milliseconds)
+ * @return Job number identifying the export in signals, or 0 if there
+ *         is no media or it cannot be exported (e.g. media loaded from
+ *         memory or streams)
+ */
+guint
+gtk_vlc_player_export_segment(GtkVlcPlayer *player, const gchar *filename,
+			      gint64 in, gint64 out)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	libvlc_media_t *media = NULL;
+	gchar *mrl = NULL;
+	gint64 frame_time, keyframe_time;
+	gboolean remux = TRUE;
+	ExportData *data;
+
+	g_return_val_if_fail(filename != NULL && in >= 0 && out > in, 0);
+
+	if (priv->suspended) {
+		media = priv->suspend_media;
+		if (media != NULL)
+			libvlc_media_retain(media);
+	} else if (priv->media_player != NULL) {
+		media = libvlc_media_player_get_media(priv->media_player);
+	}
+	if (media != NULL) {
+		mrl = libvlc_media_get_mrl(media);
+		libvlc_media_release(media);
+	}
+	/* media read through callbacks cannot be opened again */
+	if (mrl == NULL || g_str_has_prefix(mrl, "imem://")) {
+		libvlc_free(mrl);
+		return 0;
+	}
+
+	if (priv->frame_index != NULL &&
+	    gtk_vlc_frame_index_is_complete(priv->frame_index) &&
+	    gtk_vlc_frame_index_lookup(priv->frame_index, in,
+				       &frame_time, &keyframe_time)) {
+		in = frame_time;
+		remux = frame_time == keyframe_time;
+	}
+
+	data = g_new(ExportData, 1);
+	data->player = player;
+	/* job numbers are never 0 */
+	if (++priv->export_last_job == 0)
+		priv->export_last_job++;
+	data->job = priv->export_last_job;
+	data->export_job = _gtk_vlc_export_push(mrl, filename, in, out, remux,
+						export_progress_cb,
+						export_finish_cb, data);
+	libvlc_free(mrl);
+
+	g_hash_table_insert(priv->export_jobs,
+			    GUINT_TO_POINTER(data->job), data);
+
+	return data->job;
+}
+
+/**
+ * @brief Cancel a segment export
+ *
+ * The export still finishes with an unsuccessful "export-finished"
+ * signal.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param job    Job number returned by \ref gtk_vlc_player_export_segment
+ */
+void
+gtk_vlc_player_export_cancel(GtkVlcPlayer *player, guint job)
+{
+	ExportData *data;
+
+	data = g_hash_table_lookup(player->priv->export_jobs,
+				   GUINT_TO_POINTER(job));
+	if (data != NULL)
+		_gtk_vlc_export_cancel(data->export_job);
+}
+
+/**
+ * @brief Switch fullscreen mode of player
+ *
+ * In fullscreen mode, the video is displayed in a separate fullscreen
+ * window. Only the native windows that libVLC renders into are moved,
+ * so switching does not interrupt the video output.
+ * Double-clicking the player also toggles fullscreen mode.
+ *
+ * @sa gtk_vlc_player_get_fullscreen_stats
+ *
+ * @param player     \e GtkVlcPlayer instance
+ * @param fullscreen Whether to enable fullscreen mode
+ */
+void
+gtk_vlc_player_set_fullscreen(GtkVlcPlayer *player, gboolean fullscreen)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	GtkWidget *areas[] = {priv->drawing_area, priv->standby_area};
+
+	if (!priv->isFullscreen == !fullscreen)
+		return;
+	if (priv->fullscreen_window == NULL)
+		priv->fullscreen_window = create_fullscreen_window(player);
+
+	/* only measured while statistics are collected */
+	priv->fullscreen_toggled_at = g_get_monotonic_time();
+	if (priv->stats_interval_id != 0) {
+		if (priv->fullscreen_measure_id == 0)
+			priv->fullscreen_dropped_before = count_dropped_frames(player);
+		else
+			g_source_remove(priv->fullscreen_measure_id);
+		priv->fullscreen_measure_id = gdk_threads_add_timeout(FULLSCREEN_MEASURE_PERIOD,
+								      fullscreen_measure_cb,
+								      player);
+	}
+
+	if (fullscreen) {
+		GdkWindow *parent;
+
+		set_transient_toplevel_window(GTK_WINDOW(priv->fullscreen_window),
+					      GTK_WIDGET(player));
+		gtk_window_fullscreen(GTK_WINDOW(priv->fullscreen_window));
+		gtk_widget_show(priv->fullscreen_window);
+		parent = gtk_widget_get_window(priv->fullscreen_window);
+
+		priv->isFullscreen = TRUE;
+		/* the video stays visible even if the player is unmapped */
+		if (priv->suspend_id != 0) {
+			g_source_remove(priv->suspend_id);
+			priv->suspend_id = 0;
+		}
+
+		/* areas are moved by widget_on_realize() once realized */
+		for (guint i = 0; i < G_N_ELEMENTS(areas); i++) {
+			GdkWindow *window = gtk_widget_get_window(areas[i]);
+
+			if (window != NULL)
+				gdk_window_reparent(window, parent, 0, 0);
+		}
+		fullscreen_fit_areas(player);
+	} else {
+		priv->isFullscreen = FALSE;
+
+		for (guint i = 0; i < G_N_ELEMENTS(areas); i++) {
+			GdkWindow *window = gtk_widget_get_window(areas[i]);
+			GtkAllocation allocation;
+
+			if (window == NULL)
+				continue;
+
+			gtk_widget_get_allocation(areas[i], &allocation);
+			gdk_window_reparent(window,
+					    gtk_widget_get_parent_window(areas[i]),
+					    allocation.x, allocation.y);
+			gdk_window_resize(window, allocation.width,
+					  allocation.height);
+		}
+		priv->fullscreen_fitted_at = g_get_monotonic_time();
+
+		gtk_window_unfullscreen(GTK_WINDOW(priv->fullscreen_window));
+		gtk_widget_hide(priv->fullscreen_window);
+
+		/* the player was hidden while in fullscreen mode */
+		if (priv->auto_suspend && priv->suspend_id == 0 &&
+		    !gtk_widget_get_mapped(GTK_WIDGET(player)) &&
+		    priv->media_player != NULL)
+			priv->suspend_id = gdk_threads_add_timeout(SUSPEND_DELAY,
+								   suspend_timeout_cb,
+								   player);
+	}
+}
+
+/**
+ * @brief Get whether player is in fullscreen mode
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return \c TRUE if in fullscreen mode
+ */
+gboolean
+gtk_vlc_player_get_fullscreen(GtkVlcPlayer *player)
+{
+	return player->priv->isFullscreen;
+}
+
+/**
+ * @brief Get statistics of fullscreen toggles
+ *
+ * Every toggle is measured for one second: its latency is the time
+ * until the video had its final size (the window manager may resize the
+ * fullscreen window asynchronously) and dropped frames are the frames
+ * lost by libVLC and the software renderer in that period.
+ * Toggles are only measured while statistics collection is enabled
+ * (see \ref gtk_vlc_player_set_stats_interval).
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param stats  Location to store statistics in
+ */
+void
+gtk_vlc_player_get_fullscreen_stats(GtkVlcPlayer *player,
+				    GtkVlcPlayerFullscreenStats *stats)
+{
+	*stats = player->priv->fullscreen_stats;
+}
+
+/**
+ * @brief Sample playback statistics of current media.
+ *
+ * Invoked periodically (with the GDK lock held) while statistics
+ * collection is enabled.
+ */
+static gboolean
+stats_sample_cb(gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	libvlc_media_t *media;
+	libvlc_media_stats_t vlc_stats;
+	GtkVlcPlayerStats *stats;
+	gboolean have_stats;
+
+	if (priv->media_player == NULL)
+		return TRUE;
+	media = libvlc_media_player_get_media(priv->media_player);
+	if (media == NULL)
+		return TRUE;
+	have_stats = libvlc_media_get_stats(media, &vlc_stats);
+	libvlc_media_release(media);
+	if (!have_stats)
+		return TRUE;
+
+	stats = priv->stats + priv->stats_head;
+	priv->stats_head = (priv->stats_head + 1) % STATS_HISTORY_SIZE;
+	if (priv->stats_count < STATS_HISTORY_SIZE)
+		priv->stats_count++;
+
+	stats->timestamp = g_get_monotonic_time();
+
+	stats->decoded_video = (guint)vlc_stats.i_decoded_video;
+	stats->displayed_pictures = (guint)vlc_stats.i_displayed_pictures;
+	stats->lost_pictures = (guint)vlc_stats.i_lost_pictures;
+
+	stats->decoded_audio = (guint)vlc_stats.i_decoded_audio;
+	stats->played_abuffers = (guint)vlc_stats.i_played_abuffers;
+	stats->lost_abuffers = (guint)vlc_stats.i_lost_abuffers;
+
+	/* libVLC bitrates are in bytes per microsecond */
+	stats->read_bytes = (gint64)vlc_stats.i_read_bytes;
+	stats->input_bitrate = vlc_stats.f_input_bitrate*8000.;
+	stats->demux_read_bytes = (gint64)vlc_stats.i_demux_read_bytes;
+	stats->demux_bitrate = vlc_stats.f_demux_bitrate*8000.;
+	stats->demux_corrupted = (guint)vlc_stats.i_demux_corrupted;
+	stats->demux_discontinuity = (guint)vlc_stats.i_demux_discontinuity;
+
+	if (stats->timestamp - priv->stats_last_signal >=
+	    STATS_SIGNAL_INTERVAL*1000) {
+		priv->stats_last_signal = stats->timestamp;
+		g_signal_emit(player, gtk_vlc_player_signals[STATS_UPDATED_SIGNAL], 0,
+			      stats);
+	}
+
+	return TRUE;
+}
+
+/**
+ * @brief Set interval of sampling playback statistics
+ *
+ * Samples of the current media's statistics are kept in a fixed-size
+ * history and announced by the "stats-updated" signal, which is emitted
+ * at most once per second. Statistics collection is disabled by default.
+ * Changing the interval keeps the collected samples.
+ *
+ * @sa gtk_vlc_player_get_stats, gtk_vlc_player_get_stats_history
+ *
+ * @param player   \e GtkVlcPlayer instance
+ * @param interval Sampling interval in milliseconds, 0 disables collection
+ */
+void
+gtk_vlc_player_set_stats_interval(GtkVlcPlayer *player, guint interval)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (priv->stats_interval_id != 0) {
+		g_source_remove(priv->stats_interval_id);
+		priv->stats_interval_id = 0;
+	}
+
+	if (interval > 0)
+		priv->stats_interval_id = gdk_threads_add_timeout(interval,
+								  stats_sample_cb,
+								  player);
+}
+
+/**
+ * @brief Get latest playback statistics sample
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param stats  Location to store sample in
+ * @return \c FALSE if no statistics have been sampled yet
+ */
+gboolean
+gtk_vlc_player_get_stats(GtkVlcPlayer *player, GtkVlcPlayerStats *stats)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (priv->stats_count == 0)
+		return FALSE;
+
+	*stats = priv->stats[(priv->stats_head + STATS_HISTORY_SIZE - 1) %
+			     STATS_HISTORY_SIZE];
+	return TRUE;
+}
+
+/**
+ * @brief Get history of playback statistics samples
+ *
+ * At most the last 64 samples are kept.
+ *
+ * @param player    \e GtkVlcPlayer instance
+ * @param samples   Array to store samples in, oldest sample first
+ * @param n_samples Maximum number of (most recent) samples to store
+ * @return Number of samples stored
+ */
+guint
+gtk_vlc_player_get_stats_history(GtkVlcPlayer *player,
+				 GtkVlcPlayerStats *samples, guint n_samples)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	guint first;
+
+	n_samples = MIN(n_samples, priv->stats_count);
+	first = priv->stats_head + STATS_HISTORY_SIZE - n_samples;
+
+	for (guint i = 0; i < n_samples; i++)
+		samples[i] = priv->stats[(first + i) % STATS_HISTORY_SIZE];
+
+	return n_samples;
+}
+
+/**
+ * @brief Count playback stalls in live mode.
+ *
+ * Once the buffers were filled, libVLC only reports buffering again
+ * when playback stalls to refill them.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param cache  Buffer fill level (percent)
+ */
+static void
+live_buffering(GtkVlcPlayer *player, gfloat cache)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (cache >= 100.) {
+		priv->live_buffered = TRUE;
+		priv->live_stalled = FALSE;
+	} else if (priv->live_buffered && !priv->live_stalled) {
+		priv->live_stalled = TRUE;
+		priv->live_stats.stalls++;
+	}
+}
+
+/**
+ * @brief Restart the current stream with a new caching.
+ *
+ * The media is recreated from its location, so that the live mode
+ * options are added again.
+ *
+ * @param player  \e GtkVlcPlayer instance
+ * @param caching New caching (milliseconds)
+ */
+static void
+live_restart(GtkVlcPlayer *player, guint caching)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	libvlc_media_t *media;
+	gchar *mrl;
+
+	media = libvlc_media_player_get_media(priv->media_player);
+	if (media == NULL)
+		return;
+	mrl = libvlc_media_get_mrl(media);
+	libvlc_media_release(media);
+	if (mrl == NULL)
+		return;
+
+	priv->live_stats.caching = caching;
+
+	/* streams of callbacks cannot be reopened by location */
+	if (!g_str_has_prefix(mrl, "imem://")) {
+		media = libvlc_media_new_location(priv->vlc_inst, mrl);
+		vlc_player_add_media_options(player, media);
+		vlc_player_set_media(player, priv->media_player, media);
+		libvlc_media_release(media);
+
+		priv->live_last_lost = 0;
+		libvlc_media_player_play(priv->media_player);
+		priv->live_stats.restarts++;
+	}
+
+	libvlc_free(mrl);
+}
+
+/**
+ * @brief Adapt the caching of live streams to the observed jitter.
+ *
+ * Invoked periodically (with the GDK lock held) while live mode
+ * is enabled.
+ */
+static gboolean
+live_adapt_cb(gpointer user_data)
+{
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	libvlc_media_t *media;
+	libvlc_media_stats_t vlc_stats;
+	guint stalls, late;
+
+	if (priv->media_player == NULL ||
+	    libvlc_media_player_get_state(priv->media_player) != libvlc_Playing)
+		return TRUE;
+
+	media = libvlc_media_player_get_media(priv->media_player);
+	if (media == NULL)
+		return TRUE;
+	if (!libvlc_media_get_stats(media, &vlc_stats))
+		vlc_stats.i_lost_pictures = priv->live_last_lost;
+	libvlc_media_release(media);
+
+	/* counters restart with new media */
+	late = (guint)vlc_stats.i_lost_pictures;
+	if (late >= priv->live_last_lost)
+		late -= priv->live_last_lost;
+	priv->live_last_lost = (guint)vlc_stats.i_lost_pictures;
+	priv->live_stats.late_frames += late;
+
+	stalls = priv->live_stats.stalls - priv->live_last_stalls;
+	priv->live_last_stalls = priv->live_stats.stalls;
+
+	if (stalls > 0 || late > LIVE_LATE_FRAMES_THRESHOLD) {
+		priv->live_stable = 0;
+		if (priv->live_stats.caching < LIVE_CACHING_MAX)
+			live_restart(player, MIN(priv->live_stats.caching*2,
+						 LIVE_CACHING_MAX));
+	} else if (++priv->live_stable >= LIVE_STABLE_INTERVALS) {
+		priv->live_stable = 0;
+		if (priv->live_stats.caching > LIVE_CACHING_MIN)
+			live_restart(player, MAX(priv->live_stats.caching*3/4,
+						 LIVE_CACHING_MIN));
+	}
+
+	return TRUE;
 }
 
 /**
- * @brief Load media with specified filename into player widget
- *
- * It does not start playing until playback is started or toggled.
- * "time-changed" and "length-changed" signals will be emitted immediately
- * after successfully loading the media. The time-adjustment will also be
- * reconfigured appropriately.
+ * @brief Callback for emitting measured audio levels.
  *
- * @param player \e GtkVlcPlayer instance to load file into.
- * @param file   \e Filename to load
- * @return \c TRUE on success, else \c FALSE
+ * Levels are computed by the audio meter on libVLC's input thread,
+ * so this only collects them.
  */
-gboolean
-gtk_vlc_player_load_filename(GtkVlcPlayer *player, const gchar *file)
+static gboolean
+audio_levels_cb(gpointer user_data)
 {
-	libvlc_media_t *media;
+	GtkVlcPlayer *player = GTK_VLC_PLAYER(user_data);
+	GtkVlcPlayerAudioLevels levels;
 
-	media = libvlc_media_new_path(player->priv->vlc_inst,
-				      (const char *)file);
-	if (media == NULL)
-		return FALSE;
-	vlc_player_load_media(player, media);
-	libvlc_media_release(media);
+	if (_gtk_vlc_audio_meter_read(player->priv->audio_meter, &levels))
+		g_signal_emit(player, gtk_vlc_player_signals[AUDIO_LEVELS_SIGNAL], 0,
+			      &levels);
 
 	return TRUE;
 }
 
 /**
- * @brief Load media with specified URI into player widget
+ * @brief Set interval of audio level metering
  *
- * It is otherwise identical to \ref gtk_vlc_player_load_filename.
+ * While metering is enabled, the peak and RMS levels of every audio channel
+ * are measured on libVLC's input thread and reported by the "audio-levels"
+ * signal at most every \e interval milliseconds (and only while audio is
+ * decoded). Metering is disabled by default.
  *
- * @sa gtk_vlc_player_load_filename
+ * The audio is tapped by duplicating the media's streams into libVLC's
+ * memory stream output, so it is still played back. Media are tapped
+ * when they are loaded, or when playback of the current media is next
+ * started. Once tapped, only the first track of every kind is played and
+ * audio with more than \ref GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS channels is
+ * not metered.
+ * After disabling metering, media are no longer tapped when they are set.
+ * Media tapped before (the current media and playlist items) keep their
+ * tap until they are loaded anew.
+ * Metering requires libVLC 2.0 or later.
  *
- * @param player \e GtkVlcPlayer instance to load media into.
- * @param uri    \e URI to load
- * @return \c TRUE on success, else \c FALSE
+ * @param player   \e GtkVlcPlayer instance
+ * @param interval Reporting interval in milliseconds, 0 disables metering
  */
-gboolean
-gtk_vlc_player_load_uri(GtkVlcPlayer *player, const gchar *uri)
+void
+gtk_vlc_player_set_audio_levels_interval(GtkVlcPlayer *player, guint interval)
 {
+	GtkVlcPlayerPrivate *priv = player->priv;
+	gboolean metering = priv->audio_levels_id != 0;
 	libvlc_media_t *media;
 
-	media = libvlc_media_new_location(player->priv->vlc_inst,
-					  (const char *)uri);
-	if (media == NULL)
-		return FALSE;
-	vlc_player_load_media(player, media);
-	libvlc_media_release(media);
+	/* media are only tapped while the timeout is installed */
+	if (priv->audio_levels_id != 0) {
+		g_source_remove(priv->audio_levels_id);
+		priv->audio_levels_id = 0;
+	}
+	if (interval == 0)
+		return;
 
-	return TRUE;
+	/* kept afterwards, since tapped media still refer to them */
+	if (priv->audio_meter == NULL) {
+		priv->audio_meter = _gtk_vlc_audio_meter_new();
+		priv->standby_meter = _gtk_vlc_audio_meter_new();
+	}
+
+	/* other media are tapped when they are set */
+	media = !metering && priv->media_player != NULL
+		? libvlc_media_player_get_media(priv->media_player)
+		: NULL;
+	if (media != NULL) {
+		_gtk_vlc_audio_meter_tap(priv->audio_meter, media);
+		libvlc_media_release(media);
+	}
+
+	priv->audio_levels_id = gdk_threads_add_timeout(interval,
+							audio_levels_cb, player);
 }
 
 /**
- * @brief Play back media if playback is currently paused
- *
- * If it is already playing, do nothing.
- * In playback mode, there will be constant "time-changed" signal emissions
- * and the time-adjustment's value will be set accordingly.
+ * @brief Set audio volume of playback
  *
  * @param player \e GtkVlcPlayer instance
+ * @param volume New volume of playback. It must be between 0.0 (0%) and 2.0 (200%)
+ *               of the original audio volume.
  */
 void
-gtk_vlc_player_play(GtkVlcPlayer *player)
+gtk_vlc_player_set_volume(GtkVlcPlayer *player, gdouble volume)
 {
-	if (libvlc_media_player_play(player->priv->media_player) < 0)
-		return;
+	/* the volume-adjustment's value is applied on media player creation */
+	if (player->priv->media_player != NULL)
+		libvlc_audio_set_volume(player->priv->media_player, (int)(volume*100.));
+}
 
-	/*
-	 * Workaround to get mouse click events on the drawing area widget
-	 * that provides the low-level window for libVLC.
-	 * On Win32, libVLC creates an event window (in a different thread)
-	 * after playback start that "swallows" all click events.
-	 * So we have to poll for the availability of that window and disable
-	 * it.
-	 */
-#ifdef G_OS_WIN32
-	g_timeout_add(POLL_VLC_EVENT_WINDOW_INTERVAL,
-		      poll_vlc_event_window_cb, player);
-#endif
+/**
+ * @brief Get current playback time
+ *
+ * The time is interpolated between libVLC's (irregular and coarse) time
+ * reports using the monotonic clock and the playback rate, so it advances
+ * smoothly while playing and never goes backwards, except on seeks.
+ * It does not call into libVLC, so it is cheap enough to be queried for
+ * every frame drawn.
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return Playback time (in milliseconds)
+ */
+gint64
+gtk_vlc_player_get_time(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	return clock_now(priv, g_get_monotonic_time());
 }
 
 /**
- * @brief Pause media playback if it is currently playing
+ * @brief Set maximum rate of "time-changed" signals while playing
  *
- * If it is already paused, do nothing.
+ * While playing, "time-changed" signals (and time-adjustment updates)
+ * report the interpolated time (see \ref gtk_vlc_player_get_time) at
+ * most \e rate times per second. With the software renderer
+ * (\ref GTK_VLC_PLAYER_RENDER_SOFTWARE) they are emitted along with the
+ * painted frames.
+ * By default, 30 updates per second are emitted.
  *
  * @param player \e GtkVlcPlayer instance
+ * @param rate   Maximum number of updates per second, 0 to emit the raw
+ *               times reported by libVLC instead
  */
 void
-gtk_vlc_player_pause(GtkVlcPlayer *player)
+gtk_vlc_player_set_time_update_rate(GtkVlcPlayer *player, guint rate)
 {
-	libvlc_media_player_pause(player->priv->media_player);
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	priv->clock_update_rate = MIN(rate, 1000);
+	/* restart tick timeout */
+	clock_set_running(player, priv->clock_running);
 }
 
 /**
- * @brief Toggle media playback
- *
- * If it is currently playing, pause playback. If it is currently paused,
- * start playback.
+ * @brief Get maximum rate of "time-changed" signals while playing
  *
- * @sa gtk_vlc_player_play
- * @sa gtk_vlc_player_pause
+ * @param player \e GtkVlcPlayer instance
+ * @return Maximum number of updates per second, 0 if raw times are emitted
+ */
+guint
+gtk_vlc_player_get_time_update_rate(GtkVlcPlayer *player)
+{
+	return player->priv->clock_update_rate;
+}
+
+/**
+ * @brief Get media length
  *
  * @param player \e GtkVlcPlayer instance
- * @return \c TRUE if media is playing \b after the operation,
- *         \c FALSE if it is paused.
+ * @return Length of media (in milliseconds)
  */
-gboolean
-gtk_vlc_player_toggle(GtkVlcPlayer *player)
+gint64
+gtk_vlc_player_get_length(GtkVlcPlayer *player)
 {
-	if (libvlc_media_player_is_playing(player->priv->media_player))
-		gtk_vlc_player_pause(player);
-	else
-		gtk_vlc_player_play(player);
+	if (player->priv->suspended)
+		return player->priv->suspend_length;
+	if (player->priv->media_player == NULL)
+		return -1;
 
-	return (gboolean)libvlc_media_player_is_playing(player->priv->media_player);
+	return (gint64)libvlc_media_player_get_length(player->priv->media_player);
 }
 
 /**
- * @brief Stop media playback
+ * @brief Get frame rate of current media
  *
- * A "time-changed" signal will be emitted and the time-adjustment will be
- * reset appropriately.
+ * The frame rate is that of the media's first video track. It might only
+ * be known after playback was started.
  *
  * @param player \e GtkVlcPlayer instance
+ * @return Frame rate (frames per second) or 0.0 if unknown
  */
-void
-gtk_vlc_player_stop(GtkVlcPlayer *player)
+gdouble
+gtk_vlc_player_get_frame_rate(GtkVlcPlayer *player)
 {
-	gtk_vlc_player_pause(player);
-	libvlc_media_player_stop(player->priv->media_player);
+	GtkVlcPlayerPrivate *priv = player->priv;
+	libvlc_media_t *media;
 
-	update_time(player, 0);
+	if (priv->media_player == NULL)
+		return 0.;
+	media = libvlc_media_player_get_media(priv->media_player);
+	if (media == NULL)
+		return 0.;
+
+	/* determined once per media, as it is queried frequently */
+	if (media != priv->fps_media || priv->fps <= 0.) {
+		GtkVlcMediaInfo info;
+
+		_gtk_vlc_media_info_from_media(media, &info);
+		priv->fps = info.fps;
+#if LIBVLC_VERSION_INT < LIBVLC_VERSION(2,1,0,0)
+		/* track infos do not contain the frame rate */
+		priv->fps = libvlc_media_player_get_fps(priv->media_player);
+#endif
+
+		if (priv->fps_media != NULL)
+			libvlc_media_release(priv->fps_media);
+		libvlc_media_retain(media);
+		priv->fps_media = media;
+	}
+
+	libvlc_media_release(media);
+	return priv->fps;
 }
 
 /**
- * @brief Set point of time in playback
+ * @brief Convert playback time to frame number
+ *
+ * The frame displayed at \e time is determined from the media's
+ * frame rate. Frames are numbered from 0.
  *
  * @param player \e GtkVlcPlayer instance
- * @param time   New position in media (milliseconds)
+ * @param time   Playback time (milliseconds)
+ * @return Frame number or -1 if the frame rate is unknown
  */
-void
-gtk_vlc_player_seek(GtkVlcPlayer *player, gint64 time)
+gint64
+gtk_vlc_player_time_to_frame(GtkVlcPlayer *player, gint64 time)
 {
-	libvlc_media_player_set_time(player->priv->media_player,
-				     (libvlc_time_t)time);
+	gdouble fps = gtk_vlc_player_get_frame_rate(player);
+
+	if (fps <= 0.)
+		return -1;
+
+	/* frame times are rounded up to milliseconds */
+	return (gint64)floor(time*fps/1000. + 1e-6);
 }
 
 /**
- * @brief Set audio volume of playback
+ * @brief Convert frame number to playback time
+ *
+ * The time is rounded up to milliseconds, so that converting it back
+ * with \ref gtk_vlc_player_time_to_frame yields the same frame.
  *
  * @param player \e GtkVlcPlayer instance
- * @param volume New volume of playback. It must be between 0.0 (0%) and 2.0 (200%)
- *               of the original audio volume.
+ * @param frame  Frame number (counted from 0)
+ * @return Start time of frame (milliseconds) or -1 if the frame rate
+ *         is unknown
  */
-void
-gtk_vlc_player_set_volume(GtkVlcPlayer *player, gdouble volume)
+gint64
+gtk_vlc_player_frame_to_time(GtkVlcPlayer *player, gint64 frame)
 {
-	libvlc_audio_set_volume(player->priv->media_player, (int)(volume*100.));
+	gdouble fps = gtk_vlc_player_get_frame_rate(player);
+
+	if (fps <= 0.)
+		return -1;
+
+	return (gint64)ceil(frame*1000./fps - 1e-6);
 }
 
 /**
- * @brief Get media length
+ * @brief Seek to video frame
+ *
+ * Like \ref gtk_vlc_player_seek, but addressing the position by
+ * frame number.
  *
  * @param player \e GtkVlcPlayer instance
- * @return Length of media (in milliseconds)
+ * @param frame  Frame number (counted from 0)
+ * @return \c TRUE on success, \c FALSE if the frame rate is unknown
  */
-gint64
-gtk_vlc_player_get_length(GtkVlcPlayer *player)
+gboolean
+gtk_vlc_player_seek_frame(GtkVlcPlayer *player, gint64 frame)
 {
-	return (gint64)libvlc_media_player_get_length(player->priv->media_player);
+	gint64 time = gtk_vlc_player_frame_to_time(player, frame);
+
+	if (time < 0)
+		return FALSE;
+
+	gtk_vlc_player_seek(player, time);
+	return TRUE;
 }
 
 /**
@@ -863,3 +5293,228 @@ gtk_vlc_player_set_volume_adjustment(GtkVlcPlayer *player, GtkAdjustment *adj)
 				 "value-changed",
 				 G_CALLBACK(vol_adj_on_value_changed), player);
 }
+
+static gboolean
+playlist_insert(GtkVlcPlayer *player, gint position, libvlc_media_t *media)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	if (media == NULL)
+		return FALSE;
+	vlc_player_add_media_options(player, media);
+
+	if (position < 0 || position > (gint)g_queue_get_length(priv->playlist))
+		position = (gint)g_queue_get_length(priv->playlist);
+	g_queue_push_nth(priv->playlist, media, position);
+
+	if (position <= priv->playlist_pos)
+		priv->playlist_pos++;
+	playlist_prefetch(player);
+
+	return TRUE;
+}
+
+/**
+ * @brief Insert media with specified filename into the player's playlist
+ *
+ * The playlist is played back gapless: While an item is playing, the next one
+ * is parsed and pre-rolled in the background, so that it can be switched to
+ * within about one frame at the end of the current item.
+ * Playback of the playlist is started with \ref gtk_vlc_player_playlist_jump.
+ *
+ * @param player   \e GtkVlcPlayer instance
+ * @param position Position to insert item at (0 is the first item).
+ *                 Negative values or values beyond the end of the playlist
+ *                 append the item.
+ * @param file     \e Filename to insert
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_playlist_insert_filename(GtkVlcPlayer *player, gint position,
+					const gchar *file)
+{
+	return playlist_insert(player, position,
+			       libvlc_media_new_path(vlc_player_ensure_instance(player),
+						     (const char *)file));
+}
+
+/**
+ * @brief Insert media with specified URI into the player's playlist
+ *
+ * It is otherwise identical to \ref gtk_vlc_player_playlist_insert_filename.
+ *
+ * @param player   \e GtkVlcPlayer instance
+ * @param position Position to insert item at (negative to append)
+ * @param uri      \e URI to insert
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_playlist_insert_uri(GtkVlcPlayer *player, gint position,
+				   const gchar *uri)
+{
+	return playlist_insert(player, position,
+			       libvlc_media_new_location(vlc_player_ensure_instance(player),
+							 (const char *)uri));
+}
+
+/**
+ * @brief Append media with specified filename to the player's playlist
+ *
+ * @sa gtk_vlc_player_playlist_insert_filename
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param file   \e Filename to append
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_playlist_append_filename(GtkVlcPlayer *player, const gchar *file)
+{
+	return gtk_vlc_player_playlist_insert_filename(player, -1, file);
+}
+
+/**
+ * @brief Append media with specified URI to the player's playlist
+ *
+ * @sa gtk_vlc_player_playlist_insert_uri
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @param uri    \e URI to append
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_playlist_append_uri(GtkVlcPlayer *player, const gchar *uri)
+{
+	return gtk_vlc_player_playlist_insert_uri(player, -1, uri);
+}
+
+/**
+ * @brief Remove item from the player's playlist
+ *
+ * If the item is currently playing, playback is stopped.
+ *
+ * @param player   \e GtkVlcPlayer instance
+ * @param position Position of item to remove
+ */
+void
+gtk_vlc_player_playlist_remove(GtkVlcPlayer *player, guint position)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	libvlc_media_t *media;
+
+	if (position >= g_queue_get_length(priv->playlist))
+		return;
+
+	if ((gint)position == priv->playlist_pos) {
+		gtk_vlc_player_stop(player);
+		priv->playlist_pos = -1;
+	} else if ((gint)position < priv->playlist_pos) {
+		priv->playlist_pos--;
+	}
+
+	media = g_queue_pop_nth(priv->playlist, position);
+	/* the item following the current one might have changed */
+	playlist_prefetch(player);
+	libvlc_media_release(media);
+}
+
+/**
+ * @brief Remove all items from the player's playlist
+ *
+ * The current media keeps playing, but playback will not continue with
+ * another item.
+ *
+ * @param player \e GtkVlcPlayer instance
+ */
+void
+gtk_vlc_player_playlist_clear(GtkVlcPlayer *player)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+
+	priv->playlist_pos = -1;
+	playlist_prefetch(player);
+
+	g_queue_foreach(priv->playlist, (GFunc)libvlc_media_release, NULL);
+	g_queue_clear(priv->playlist);
+}
+
+/**
+ * @brief Start playback of a playlist item
+ *
+ * If the item is the pre-rolled next one, it is switched to immediately.
+ * Otherwise it is loaded without parsing it first, so the "length-changed"
+ * signal will be emitted as soon as libVLC has determined its length.
+ * A "playlist-item-changed" signal is emitted.
+ * If the player is suspended, the item replaces its saved media and
+ * starts playing when the player is resumed.
+ *
+ * @param player   \e GtkVlcPlayer instance
+ * @param position Position of item to play
+ * @return \c TRUE on success, else \c FALSE
+ */
+gboolean
+gtk_vlc_player_playlist_jump(GtkVlcPlayer *player, guint position)
+{
+	GtkVlcPlayerPrivate *priv = player->priv;
+	libvlc_media_t *media;
+
+	if (position >= g_queue_get_length(priv->playlist))
+		return FALSE;
+
+	if (priv->playlist_pos >= 0 && (gint)position == priv->playlist_pos + 1 &&
+	    playlist_swap_standby(player))
+		return TRUE;
+
+	/* supersede pending asynchronous loads */
+	g_atomic_int_inc(&priv->load_generation);
+
+	media = g_queue_peek_nth(priv->playlist, position);
+	if (priv->suspended) {
+		/* loaded when resuming */
+		libvlc_media_retain(media);
+		if (priv->suspend_media != NULL)
+			libvlc_media_release(priv->suspend_media);
+		priv->suspend_media = media;
+		priv->suspend_time = 0;
+		priv->suspend_length = -1;
+	} else {
+		vlc_player_ensure(player);
+		vlc_player_set_media(player, priv->media_player, media);
+		vlc_event_queue_discard(&priv->event_queue);
+	}
+	priv->playlist_pos = (gint)position;
+	vlc_player_set_frame_index(player, NULL);
+
+	update_time(player, 0);
+	g_signal_emit(player, gtk_vlc_player_signals[PLAYLIST_ITEM_CHANGED_SIGNAL], 0,
+		      priv->playlist_pos);
+
+	gtk_vlc_player_play(player);
+	playlist_prefetch(player);
+
+	return TRUE;
+}
+
+/**
+ * @brief Get number of items in the player's playlist
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return Number of playlist items
+ */
+guint
+gtk_vlc_player_playlist_get_length(GtkVlcPlayer *player)
+{
+	return g_queue_get_length(player->priv->playlist);
+}
+
+/**
+ * @brief Get position of the playlist item currently loaded
+ *
+ * @param player \e GtkVlcPlayer instance
+ * @return Position of current item or -1 if the current media
+ *         (if any) is not a playlist item
+ */
+gint
+gtk_vlc_player_playlist_get_position(GtkVlcPlayer *player)
+{
+	return player->priv->playlist_pos;
+}
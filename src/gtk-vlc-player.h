@@ -28,6 +28,9 @@
 #include <glib-object.h>
 #include <gtk/gtk.h>
 
+#include "gtk-vlc-media-index.h"
+#include "gtk-vlc-frame-index.h"
+
 G_BEGIN_DECLS
 
 #define GTK_TYPE_VLC_PLAYER \
@@ -52,6 +55,137 @@ G_BEGIN_DECLS
 /** @private */
 typedef struct _GtkVlcPlayerPrivate GtkVlcPlayerPrivate;
 
+/**
+ * Playback state reported by the "state-changed" signal
+ */
+typedef enum {
+	GTK_VLC_PLAYER_STATE_NOTHING_SPECIAL = 0,	/**< No media loaded yet */
+	GTK_VLC_PLAYER_STATE_OPENING,			/**< Media is being opened */
+	GTK_VLC_PLAYER_STATE_PLAYING,			/**< Media is playing */
+	GTK_VLC_PLAYER_STATE_PAUSED,			/**< Playback is paused */
+	GTK_VLC_PLAYER_STATE_STOPPED,			/**< Playback was stopped */
+	GTK_VLC_PLAYER_STATE_ENDED,			/**< End of media was reached */
+	GTK_VLC_PLAYER_STATE_ERROR			/**< Playback error */
+} GtkVlcPlayerState;
+
+/* avoid including libVLC headers in applications */
+struct libvlc_instance_t;
+
+/**
+ * Seek statistics, as returned by \ref gtk_vlc_player_get_seek_stats.
+ * Latencies are measured from issuing a seek to libVLC until it reports
+ * a new playback time.
+ */
+typedef struct {
+	guint	requested;	/**< Number of seeks requested */
+	guint	issued;		/**< Number of seeks passed on to libVLC */
+	guint	coalesced;	/**< Requests replaced by later ones before being issued */
+	guint	completed;	/**< Number of completed seeks */
+	guint	timed_out;	/**< Seeks considered completed after a timeout */
+
+	gint64	last_latency;	/**< Latency of last seek (microseconds) */
+	gint64	min_latency;	/**< Minimum latency (microseconds) */
+	gint64	max_latency;	/**< Maximum latency (microseconds) */
+	gint64	total_latency;	/**< Sum of all latencies (microseconds) */
+} GtkVlcPlayerSeekStats;
+
+/**
+ * How a \e GtkVlcPlayer renders video
+ */
+typedef enum {
+	/** libVLC renders directly into the widget's window (default) */
+	GTK_VLC_PLAYER_RENDER_WINDOW = 0,
+	/** Frames are copied into memory and painted by the widget */
+	GTK_VLC_PLAYER_RENDER_SOFTWARE
+} GtkVlcPlayerRenderMode;
+
+/**
+ * Sets of media options applied by a \e GtkVlcPlayer to all media it loads
+ */
+typedef enum {
+	/** libVLC's defaults */
+	GTK_VLC_PLAYER_PRESET_DEFAULT = 0,
+	/** Minimal network and capture buffering, no clock smoothing */
+	GTK_VLC_PLAYER_PRESET_LOW_LATENCY_LIVE,
+	/** Minimal file buffering, no subtitle file detection */
+	GTK_VLC_PLAYER_PRESET_FAST_START,
+	/** Hardware decoding if available, cheaper software decoding */
+	GTK_VLC_PLAYER_PRESET_LOW_CPU
+} GtkVlcPlayerPreset;
+
+/**
+ * Frame statistics of the software renderer, as returned by
+ * \ref gtk_vlc_player_get_frame_stats
+ */
+typedef struct {
+	guint	decoded;	/**< Frames delivered by libVLC */
+	guint	painted;	/**< Frames painted by the widget */
+	guint	dropped;	/**< Frames replaced before they could be painted */
+} GtkVlcPlayerFrameStats;
+
+/**
+ * Playback statistics sample, as returned by \ref gtk_vlc_player_get_stats.
+ * Counters are reported by libVLC and accumulate over the
+ * playback of the current media.
+ */
+typedef struct {
+	gint64	timestamp;		/**< Monotonic time of sample (microseconds) */
+
+	guint	decoded_video;		/**< Decoded video frames */
+	guint	displayed_pictures;	/**< Displayed video frames */
+	guint	lost_pictures;		/**< Lost video frames */
+
+	guint	decoded_audio;		/**< Decoded audio blocks */
+	guint	played_abuffers;	/**< Played audio buffers */
+	guint	lost_abuffers;		/**< Lost audio buffers */
+
+	gint64	read_bytes;		/**< Bytes read from input */
+	gdouble	input_bitrate;		/**< Input bitrate (kbit/s) */
+	gint64	demux_read_bytes;	/**< Bytes read by demuxer */
+	gdouble	demux_bitrate;		/**< Demuxer bitrate (kbit/s) */
+	guint	demux_corrupted;	/**< Corrupted demuxer packets */
+	guint	demux_discontinuity;	/**< Demuxer discontinuities */
+} GtkVlcPlayerStats;
+
+/**
+ * Statistics of fullscreen toggles, as returned by
+ * \ref gtk_vlc_player_get_fullscreen_stats.
+ * A toggle is measured for one second after it was requested,
+ * if statistics collection is enabled.
+ */
+typedef struct {
+	guint	toggles;		/**< Number of measured toggles */
+	gint64	last_latency;		/**< Time until video had its final size (microseconds) */
+	gint64	max_latency;		/**< Maximum latency (microseconds) */
+	guint	last_dropped_frames;	/**< Frames lost during last toggle */
+	guint	dropped_frames;		/**< Frames lost during all toggles */
+} GtkVlcPlayerFullscreenStats;
+
+/**
+ * Live mode statistics, as returned by \ref gtk_vlc_player_get_live_stats.
+ * Counters accumulate since live mode was enabled.
+ */
+typedef struct {
+	guint	caching;	/**< Current caching of live streams (milliseconds) */
+	guint	stalls;		/**< Times playback stalled to refill its buffers */
+	guint	late_frames;	/**< Frames dropped for being late */
+	guint	restarts;	/**< Stream restarts to change the caching */
+} GtkVlcPlayerLiveStats;
+
+/** Maximum number of audio channels metered */
+#define GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS 8
+
+/**
+ * Audio levels, as reported by the "audio-levels" signal.
+ * Levels are linear sample amplitudes (1.0 is full scale) measured since
+ * the previous report.
+ */
+typedef struct {
+	guint	channels;	/**< Number of valid channels */
+	gfloat	peak[GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS]; /**< Peak per channel */
+	gfloat	rms[GTK_VLC_PLAYER_AUDIO_MAX_CHANNELS];	/**< RMS per channel */
+} GtkVlcPlayerAudioLevels;
+
 /**
  * \e GtkVlcPlayer instance structure
  */
@@ -84,6 +218,100 @@ typedef struct _GtkVlcPlayerClass {
 	 * @param new_length New (current) length of media loaded into player (milliseconds)
 	 */
 	void (*length_changed)	(GtkVlcPlayer *self, gint64 new_length);
+
+	/**
+	 * Callback function to invoke when emitting the "media-loaded"
+	 * signal, i.e. after media was parsed and loaded into the player.
+	 *
+	 * @param self \e GtkVlcPlayer widget that emitted the signal
+	 */
+	void (*media_loaded)	(GtkVlcPlayer *self);
+
+	/**
+	 * Callback function to invoke when emitting the "state-changed"
+	 * signal.
+	 *
+	 * @param self  \e GtkVlcPlayer widget that emitted the signal
+	 * @param state New playback state (\ref GtkVlcPlayerState)
+	 */
+	void (*state_changed)	(GtkVlcPlayer *self, gint state);
+
+	/**
+	 * Callback function to invoke when emitting the "buffering"
+	 * signal.
+	 *
+	 * @param self    \e GtkVlcPlayer widget that emitted the signal
+	 * @param percent Fill level of the input cache (0 to 100)
+	 */
+	void (*buffering)	(GtkVlcPlayer *self, gfloat percent);
+
+	/**
+	 * Callback function to invoke when emitting the "end-reached"
+	 * signal, i.e. when playback reached the end of the media.
+	 *
+	 * @param self \e GtkVlcPlayer widget that emitted the signal
+	 */
+	void (*end_reached)	(GtkVlcPlayer *self);
+
+	/**
+	 * Callback function to invoke when emitting the "error"
+	 * signal, i.e. when libVLC encountered a playback error.
+	 *
+	 * @param self \e GtkVlcPlayer widget that emitted the signal
+	 */
+	void (*error)		(GtkVlcPlayer *self);
+
+	/**
+	 * Callback function to invoke when emitting the "playlist-item-changed"
+	 * signal, i.e. when another playlist item is loaded.
+	 *
+	 * @param self     \e GtkVlcPlayer widget that emitted the signal
+	 * @param position Position of the new current playlist item
+	 */
+	void (*playlist_item_changed) (GtkVlcPlayer *self, gint position);
+
+	/**
+	 * Callback function to invoke when emitting the "stats-updated"
+	 * signal, i.e. after playback statistics were sampled.
+	 *
+	 * @param self  \e GtkVlcPlayer widget that emitted the signal
+	 * @param stats Latest statistics sample
+	 */
+	void (*stats_updated)	(GtkVlcPlayer *self, const GtkVlcPlayerStats *stats);
+
+	/**
+	 * Callback function to invoke when emitting the "audio-levels"
+	 * signal, i.e. periodically while audio metering is enabled
+	 * and audio is played.
+	 *
+	 * @param self   \e GtkVlcPlayer widget that emitted the signal
+	 * @param levels Audio levels since the previous emission
+	 */
+	void (*audio_levels)	(GtkVlcPlayer *self,
+				 const GtkVlcPlayerAudioLevels *levels);
+
+	/**
+	 * Callback function to invoke when emitting the "export-progress"
+	 * signal, i.e. periodically while a segment is exported.
+	 *
+	 * @param self     \e GtkVlcPlayer widget that emitted the signal
+	 * @param job      Job number of the export
+	 * @param progress Fraction of the segment written (0 to 1)
+	 */
+	void (*export_progress)	(GtkVlcPlayer *self, guint job,
+				 gdouble progress);
+
+	/**
+	 * Callback function to invoke when emitting the "export-finished"
+	 * signal, i.e. when a segment export completed, failed or was
+	 * cancelled.
+	 *
+	 * @param self    \e GtkVlcPlayer widget that emitted the signal
+	 * @param job     Job number of the export
+	 * @param success Whether the segment was written completely
+	 */
+	void (*export_finished)	(GtkVlcPlayer *self, guint job,
+				 gboolean success);
 } GtkVlcPlayerClass;
 
 /** @private */
@@ -93,9 +321,53 @@ GType gtk_vlc_player_get_type(void);
  * API
  */
 GtkWidget *gtk_vlc_player_new(void);
+GtkWidget *gtk_vlc_player_new_with_instance(struct libvlc_instance_t *instance);
+GtkWidget *gtk_vlc_player_new_with_options(const gchar *const *options);
+
+void gtk_vlc_player_set_preset(GtkVlcPlayer *player, GtkVlcPlayerPreset preset);
+GtkVlcPlayerPreset gtk_vlc_player_get_preset(GtkVlcPlayer *player);
+void gtk_vlc_player_set_media_options(GtkVlcPlayer *player,
+				      const gchar *const *options);
+
+void gtk_vlc_player_set_live_mode(GtkVlcPlayer *player, gboolean live);
+gboolean gtk_vlc_player_get_live_mode(GtkVlcPlayer *player);
+void gtk_vlc_player_get_live_stats(GtkVlcPlayer *player,
+				   GtkVlcPlayerLiveStats *stats);
+
+void gtk_vlc_player_set_auto_suspend(GtkVlcPlayer *player,
+				     gboolean auto_suspend);
+gboolean gtk_vlc_player_get_auto_suspend(GtkVlcPlayer *player);
+void gtk_vlc_player_suspend(GtkVlcPlayer *player);
+void gtk_vlc_player_resume(GtkVlcPlayer *player);
+gboolean gtk_vlc_player_is_suspended(GtkVlcPlayer *player);
 
 gboolean gtk_vlc_player_load_filename(GtkVlcPlayer *player, const gchar *file);
 gboolean gtk_vlc_player_load_uri(GtkVlcPlayer *player, const gchar *uri);
+gboolean gtk_vlc_player_load_stream(GtkVlcPlayer *player, GInputStream *stream);
+gboolean gtk_vlc_player_load_bytes(GtkVlcPlayer *player,
+				   gconstpointer data, gsize size,
+				   GDestroyNotify destroy, gpointer user_data);
+
+void gtk_vlc_player_load_filename_async(GtkVlcPlayer *player, const gchar *file,
+					GCancellable *cancellable,
+					GAsyncReadyCallback callback,
+					gpointer user_data);
+gboolean gtk_vlc_player_load_filename_finish(GtkVlcPlayer *player,
+					     GAsyncResult *result,
+					     GError **error);
+void gtk_vlc_player_load_uri_async(GtkVlcPlayer *player, const gchar *uri,
+				   GCancellable *cancellable,
+				   GAsyncReadyCallback callback,
+				   gpointer user_data);
+gboolean gtk_vlc_player_load_uri_finish(GtkVlcPlayer *player,
+					GAsyncResult *result, GError **error);
+
+void gtk_vlc_player_set_media_index(GtkVlcPlayer *player,
+				    GtkVlcMediaIndex *index);
+void gtk_vlc_player_set_frame_accurate(GtkVlcPlayer *player,
+				       gboolean accurate);
+gboolean gtk_vlc_player_get_frame_accurate(GtkVlcPlayer *player);
+GtkVlcFrameIndex *gtk_vlc_player_get_frame_index(GtkVlcPlayer *player);
 
 void gtk_vlc_player_play(GtkVlcPlayer *player);
 void gtk_vlc_player_pause(GtkVlcPlayer *player);
@@ -103,10 +375,75 @@ gboolean gtk_vlc_player_toggle(GtkVlcPlayer *player);
 void gtk_vlc_player_stop(GtkVlcPlayer *player);
 
 void gtk_vlc_player_seek(GtkVlcPlayer *player, gint64 time);
+gboolean gtk_vlc_player_seek_frame(GtkVlcPlayer *player, gint64 frame);
+void gtk_vlc_player_next_frame(GtkVlcPlayer *player);
+void gtk_vlc_player_set_rate(GtkVlcPlayer *player, gfloat rate);
+gfloat gtk_vlc_player_get_rate(GtkVlcPlayer *player);
+void gtk_vlc_player_get_seek_stats(GtkVlcPlayer *player,
+				   GtkVlcPlayerSeekStats *stats);
+void gtk_vlc_player_reset_seek_stats(GtkVlcPlayer *player);
 void gtk_vlc_player_set_volume(GtkVlcPlayer *player, gdouble volume);
 
+void gtk_vlc_player_set_render_mode(GtkVlcPlayer *player,
+				    GtkVlcPlayerRenderMode mode);
+GtkVlcPlayerRenderMode gtk_vlc_player_get_render_mode(GtkVlcPlayer *player);
+void gtk_vlc_player_get_frame_stats(GtkVlcPlayer *player,
+				    GtkVlcPlayerFrameStats *stats);
+
+GdkPixbuf *gtk_vlc_player_snapshot(GtkVlcPlayer *player,
+				   guint width, guint height);
+void gtk_vlc_player_snapshot_async(GtkVlcPlayer *player,
+				   guint width, guint height,
+				   GCancellable *cancellable,
+				   GAsyncReadyCallback callback,
+				   gpointer user_data);
+GdkPixbuf *gtk_vlc_player_snapshot_finish(GtkVlcPlayer *player,
+					  GAsyncResult *result,
+					  GError **error);
+
+guint gtk_vlc_player_export_segment(GtkVlcPlayer *player, const gchar *filename,
+				    gint64 in, gint64 out);
+void gtk_vlc_player_export_cancel(GtkVlcPlayer *player, guint job);
+
+void gtk_vlc_player_set_fullscreen(GtkVlcPlayer *player, gboolean fullscreen);
+gboolean gtk_vlc_player_get_fullscreen(GtkVlcPlayer *player);
+void gtk_vlc_player_get_fullscreen_stats(GtkVlcPlayer *player,
+					 GtkVlcPlayerFullscreenStats *stats);
+
+void gtk_vlc_player_set_stats_interval(GtkVlcPlayer *player, guint interval);
+gboolean gtk_vlc_player_get_stats(GtkVlcPlayer *player,
+				  GtkVlcPlayerStats *stats);
+guint gtk_vlc_player_get_stats_history(GtkVlcPlayer *player,
+				       GtkVlcPlayerStats *samples,
+				       guint n_samples);
+
+void gtk_vlc_player_set_audio_levels_interval(GtkVlcPlayer *player,
+					      guint interval);
+
+gint64 gtk_vlc_player_get_time(GtkVlcPlayer *player);
+void gtk_vlc_player_set_time_update_rate(GtkVlcPlayer *player, guint rate);
+guint gtk_vlc_player_get_time_update_rate(GtkVlcPlayer *player);
 gint64 gtk_vlc_player_get_length(GtkVlcPlayer *player);
 
+gdouble gtk_vlc_player_get_frame_rate(GtkVlcPlayer *player);
+gint64 gtk_vlc_player_time_to_frame(GtkVlcPlayer *player, gint64 time);
+gint64 gtk_vlc_player_frame_to_time(GtkVlcPlayer *player, gint64 frame);
+
+gboolean gtk_vlc_player_playlist_insert_filename(GtkVlcPlayer *player,
+						 gint position,
+						 const gchar *file);
+gboolean gtk_vlc_player_playlist_insert_uri(GtkVlcPlayer *player,
+					    gint position, const gchar *uri);
+gboolean gtk_vlc_player_playlist_append_filename(GtkVlcPlayer *player,
+						 const gchar *file);
+gboolean gtk_vlc_player_playlist_append_uri(GtkVlcPlayer *player,
+					    const gchar *uri);
+void gtk_vlc_player_playlist_remove(GtkVlcPlayer *player, guint position);
+void gtk_vlc_player_playlist_clear(GtkVlcPlayer *player);
+gboolean gtk_vlc_player_playlist_jump(GtkVlcPlayer *player, guint position);
+guint gtk_vlc_player_playlist_get_length(GtkVlcPlayer *player);
+gint gtk_vlc_player_playlist_get_position(GtkVlcPlayer *player);
+
 GtkAdjustment *gtk_vlc_player_get_time_adjustment(GtkVlcPlayer *player);
 void gtk_vlc_player_set_time_adjustment(GtkVlcPlayer *player, GtkAdjustment *adj);
 
@@ -0,0 +1,753 @@
+/**
+ * @file
+ * Software renderer for \e GtkVlcPlayer widgets.
+ * Decoded frames are delivered by libVLC's video callbacks into a fixed
+ * ring of aligned, reusable buffers and painted with cairo.
+ * No memory is allocated per frame.
+ * Planar YUV video is requested as-is (sparing libVLC a conversion) and
+ * converted to RGB when painting, so frames that are dropped are never
+ * converted.
+ * Snapshots are taken from the same buffers, without encoding them.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include <vlc/vlc.h>
+#include <vlc/libvlc_version.h>
+
+#include "gtk-vlc-player-private.h"
+
+/**
+ * @private
+ * Number of pictures libVLC may hold at a time (written or waiting to be
+ * displayed)
+ */
+#define VLC_PICTURES 2
+/**
+ * @private
+ * Number of frame buffers.
+ * Besides libVLC's pictures, one holds the latest frame and up to two are
+ * pinned by painting and a concurrent snapshot.
+ */
+#define RING_SIZE (VLC_PICTURES + 3)
+
+/** @private */
+#define BUFFER_ALIGNMENT 32
+/** @private */
+#define ALIGN(X) (((X) + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1))
+
+/**
+ * @private
+ * Frame size to request from libVLC versions that cannot report the
+ * native video size
+ */
+#define FALLBACK_WIDTH	640
+/** @private */
+#define FALLBACK_HEIGHT	360
+
+/** @private */
+typedef enum {
+	BUFFER_FREE = 0,
+	BUFFER_LOCKED,		/**< being written by libVLC */
+	BUFFER_DECODED,		/**< written, held by libVLC until displayed */
+	BUFFER_READY,		/**< latest displayed frame */
+	BUFFER_PAINTING		/**< being painted or snapshot */
+} BufferState;
+
+/** @private */
+typedef enum {
+	FORMAT_RV32 = 0,	/**< RGB, converted by libVLC if necessary */
+	FORMAT_I420,
+	FORMAT_NV12
+} FrameFormat;
+
+/** @private */
+struct _GtkVlcRenderer {
+	GtkVlcRendererFrameFunc	frame_ready;
+	gpointer		user_data;
+
+	/** protects all of the following */
+	GMutex			*mutex;
+	/** signalled when a buffer is no longer being painted */
+	GCond			*paint_cond;
+
+	gpointer		allocs[RING_SIZE];
+	guint8			*buffers[RING_SIZE];
+	BufferState		state[RING_SIZE];
+	/** number of readers of buffers in BUFFER_PAINTING state */
+	guint			readers[RING_SIZE];
+	gboolean		painted[RING_SIZE];
+	/** order in which buffers were handed to libVLC */
+	guint			sequence[RING_SIZE];
+	guint			next_sequence;
+	gint			latest;		/**< latest frame or -1 */
+
+	FrameFormat		format;
+	guint			width;
+	guint			height;
+	guint			n_planes;
+	guint			pitches[3];
+	guint			lines[3];
+	gsize			offsets[3];
+
+	GtkVlcPlayerFrameStats	stats;
+
+	/*
+	 * RGB buffer for converted YUV frames,
+	 * used on the main loop only
+	 */
+	const GtkVlcConvertKernel *kernel;
+	gpointer		paint_alloc;
+	guint8			*paint_buffer;
+	gsize			paint_size;
+};
+
+static guint8 *buffer_alloc_aligned(gsize size, gpointer *alloc);
+static void renderer_alloc_buffers(GtkVlcRenderer *renderer,
+				   FrameFormat format,
+				   guint width, guint height);
+static void renderer_free_buffers(GtkVlcRenderer *renderer);
+static void renderer_reclaim_decoded(GtkVlcRenderer *renderer);
+static gint renderer_acquire_latest(GtkVlcRenderer *renderer);
+static void renderer_release(GtkVlcRenderer *renderer, gint i);
+static cairo_surface_t *renderer_get_surface(GtkVlcRenderer *renderer, gint i,
+					     guint rows, guint8 *buffer,
+					     guint stride);
+
+static void *renderer_lock_cb(void *opaque, void **planes);
+static void renderer_unlock_cb(void *opaque, void *picture,
+			       void *const *planes);
+static void renderer_display_cb(void *opaque, void *picture);
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2,0,0,0)
+static unsigned renderer_format_cb(void **opaque, char *chroma,
+				   unsigned *width, unsigned *height,
+				   unsigned *pitches, unsigned *lines);
+static void renderer_cleanup_cb(void *opaque);
+#endif
+
+static guint8 *
+buffer_alloc_aligned(gsize size, gpointer *alloc)
+{
+	*alloc = g_malloc(size + BUFFER_ALIGNMENT - 1);
+	return (guint8 *)ALIGN((guintptr)*alloc);
+}
+
+/*
+ * NOTE: must be called with the mutex held and no buffers allocated
+ */
+static void
+renderer_alloc_buffers(GtkVlcRenderer *renderer, FrameFormat format,
+		       guint width, guint height)
+{
+	gsize frame_size = 0;
+
+	renderer->format = format;
+	renderer->width = width;
+	renderer->height = height;
+
+	/* all pitches are aligned, so every plane is */
+	switch (format) {
+	case FORMAT_RV32:
+		renderer->n_planes = 1;
+		/* also ensures the pitch alignment required by cairo */
+		renderer->pitches[0] = ALIGN((guint)cairo_format_stride_for_width(CAIRO_FORMAT_RGB24,
+										   (int)width));
+		renderer->lines[0] = height;
+		break;
+	case FORMAT_I420:
+		renderer->n_planes = 3;
+		renderer->pitches[0] = ALIGN(width);
+		renderer->lines[0] = height;
+		renderer->pitches[1] = renderer->pitches[2] = ALIGN((width + 1)/2);
+		renderer->lines[1] = renderer->lines[2] = (height + 1)/2;
+		break;
+	case FORMAT_NV12:
+		renderer->n_planes = 2;
+		renderer->pitches[0] = ALIGN(width);
+		renderer->lines[0] = height;
+		renderer->pitches[1] = ALIGN((width + 1) & ~1U);
+		renderer->lines[1] = (height + 1)/2;
+		break;
+	}
+
+	for (guint p = 0; p < renderer->n_planes; p++) {
+		renderer->offsets[p] = frame_size;
+		frame_size += (gsize)renderer->pitches[p]*renderer->lines[p];
+	}
+
+	for (gint i = 0; i < RING_SIZE; i++) {
+		renderer->buffers[i] = buffer_alloc_aligned(frame_size,
+						     renderer->allocs + i);
+		renderer->state[i] = BUFFER_FREE;
+		renderer->readers[i] = 0;
+		renderer->painted[i] = FALSE;
+	}
+	renderer->latest = -1;
+}
+
+/*
+ * NOTE: must be called with the mutex held
+ */
+static void
+renderer_free_buffers(GtkVlcRenderer *renderer)
+{
+	for (;;) {
+		gboolean painting = FALSE;
+
+		for (gint i = 0; i < RING_SIZE; i++)
+			painting |= renderer->state[i] == BUFFER_PAINTING;
+		if (!painting)
+			break;
+
+		g_cond_wait(renderer->paint_cond, renderer->mutex);
+	}
+
+	for (gint i = 0; i < RING_SIZE; i++) {
+		g_free(renderer->allocs[i]);
+		renderer->allocs[i] = NULL;
+		renderer->buffers[i] = NULL;
+		renderer->state[i] = BUFFER_FREE;
+	}
+	renderer->latest = -1;
+	renderer->width = renderer->height = 0;
+	renderer->n_planes = 0;
+}
+
+/*
+ * libVLC does not report pictures it drops instead of displaying them
+ * (e.g. late ones or when flushing after a seek).
+ * Since it cannot hold more than VLC_PICTURES pictures, any further
+ * decoded buffers are no longer in use and the oldest ones are freed.
+ * NOTE: must be called with the mutex held
+ */
+static void
+renderer_reclaim_decoded(GtkVlcRenderer *renderer)
+{
+	for (;;) {
+		guint held = 0;
+		gint oldest = -1;
+
+		for (gint i = 0; i < RING_SIZE; i++) {
+			if (renderer->state[i] == BUFFER_LOCKED) {
+				held++;
+			} else if (renderer->state[i] == BUFFER_DECODED) {
+				held++;
+				if (oldest < 0 ||
+				    (gint)(renderer->sequence[i] -
+					   renderer->sequence[oldest]) < 0)
+					oldest = i;
+			}
+		}
+		/* one picture is about to be locked */
+		if (held < VLC_PICTURES || oldest < 0)
+			break;
+
+		renderer->state[oldest] = BUFFER_FREE;
+		renderer->stats.dropped++;
+	}
+}
+
+/*
+ * Pin the latest frame, so libVLC does not overwrite it.
+ * Any number of readers (painting or taking snapshots) may pin a buffer.
+ * Returns -1 if there is no frame.
+ */
+static gint
+renderer_acquire_latest(GtkVlcRenderer *renderer)
+{
+	gint i;
+
+	g_mutex_lock(renderer->mutex);
+	i = renderer->latest;
+	if (i >= 0) {
+		renderer->state[i] = BUFFER_PAINTING;
+		renderer->readers[i]++;
+	}
+	g_mutex_unlock(renderer->mutex);
+
+	return i;
+}
+
+/*
+ * NOTE: must be called with the mutex held
+ */
+static void
+renderer_release(GtkVlcRenderer *renderer, gint i)
+{
+	if (--renderer->readers[i] > 0)
+		return;
+
+	renderer->state[i] = renderer->latest == i ? BUFFER_READY : BUFFER_FREE;
+	g_cond_broadcast(renderer->paint_cond);
+}
+
+/*
+ * Get an RGB24 surface of a pinned frame.
+ * YUV frames are converted into buffer, reducing them to the given
+ * number of rows.
+ */
+static cairo_surface_t *
+renderer_get_surface(GtkVlcRenderer *renderer, gint i, guint rows,
+		     guint8 *buffer, guint stride)
+{
+	guint8 *planes[3];
+
+	if (renderer->format == FORMAT_RV32)
+		return cairo_image_surface_create_for_data(renderer->buffers[i],
+							   CAIRO_FORMAT_RGB24,
+							   (int)renderer->width,
+							   (int)renderer->height,
+							   (int)renderer->pitches[0]);
+
+	for (guint p = 0; p < renderer->n_planes; p++)
+		planes[p] = renderer->buffers[i] + renderer->offsets[p];
+
+	_gtk_vlc_convert_frame(renderer->kernel,
+			       renderer->format == FORMAT_I420
+					? GTK_VLC_CONVERT_I420
+					: GTK_VLC_CONVERT_NV12,
+			       planes, renderer->pitches,
+			       renderer->width, renderer->height,
+			       buffer, stride, rows);
+
+	return cairo_image_surface_create_for_data(buffer, CAIRO_FORMAT_RGB24,
+						   (int)renderer->width,
+						   (int)rows, (int)stride);
+}
+
+static void *
+renderer_lock_cb(void *opaque, void **planes)
+{
+	GtkVlcRenderer *renderer = opaque;
+	gint i;
+
+	g_mutex_lock(renderer->mutex);
+
+	renderer_reclaim_decoded(renderer);
+
+	for (;;) {
+		for (i = 0; i < RING_SIZE; i++)
+			if (renderer->state[i] == BUFFER_FREE)
+				break;
+		if (i < RING_SIZE)
+			break;
+
+		/*
+		 * Only while several snapshots are taken concurrently to
+		 * painting: replace the latest frame unless it is pinned too
+		 */
+		i = renderer->latest;
+		if (i >= 0 && renderer->state[i] == BUFFER_READY) {
+			if (!renderer->painted[i])
+				renderer->stats.dropped++;
+			renderer->latest = -1;
+			break;
+		}
+
+		g_cond_wait(renderer->paint_cond, renderer->mutex);
+	}
+
+	renderer->state[i] = BUFFER_LOCKED;
+	renderer->sequence[i] = renderer->next_sequence++;
+	for (guint p = 0; p < renderer->n_planes; p++)
+		planes[p] = renderer->buffers[i] + renderer->offsets[p];
+
+	g_mutex_unlock(renderer->mutex);
+
+	return GINT_TO_POINTER(i);
+}
+
+static void
+renderer_unlock_cb(void *opaque, void *picture, void *const *planes)
+{
+	GtkVlcRenderer *renderer = opaque;
+	gint i = GPOINTER_TO_INT(picture);
+
+	g_mutex_lock(renderer->mutex);
+	/* some libVLC versions unlock pictures only after displaying them */
+	if (renderer->state[i] == BUFFER_LOCKED)
+		renderer->state[i] = BUFFER_DECODED;
+	renderer->stats.decoded++;
+	g_mutex_unlock(renderer->mutex);
+}
+
+static void
+renderer_display_cb(void *opaque, void *picture)
+{
+	GtkVlcRenderer *renderer = opaque;
+	gint i = GPOINTER_TO_INT(picture);
+
+	g_mutex_lock(renderer->mutex);
+
+	/* pictures are displayed in order, so older ones were dropped */
+	for (gint j = 0; j < RING_SIZE; j++) {
+		if (renderer->state[j] == BUFFER_DECODED &&
+		    (gint)(renderer->sequence[j] - renderer->sequence[i]) < 0) {
+			renderer->state[j] = BUFFER_FREE;
+			renderer->stats.dropped++;
+		}
+	}
+
+	if (renderer->latest >= 0 && renderer->latest != i &&
+	    renderer->state[renderer->latest] == BUFFER_READY) {
+		/* main loop did not manage to paint the previous frame */
+		if (!renderer->painted[renderer->latest])
+			renderer->stats.dropped++;
+		renderer->state[renderer->latest] = BUFFER_FREE;
+	}
+	/* a buffer being painted is freed after painting */
+
+	/* when displayed again while pinned, it is ready after painting */
+	if (renderer->state[i] != BUFFER_PAINTING)
+		renderer->state[i] = BUFFER_READY;
+	renderer->painted[i] = FALSE;
+	renderer->latest = i;
+
+	g_mutex_unlock(renderer->mutex);
+
+	renderer->frame_ready(renderer->user_data);
+}
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2,0,0,0)
+
+static unsigned
+renderer_format_cb(void **opaque, char *chroma,
+		   unsigned *width, unsigned *height,
+		   unsigned *pitches, unsigned *lines)
+{
+	GtkVlcRenderer *renderer = *opaque;
+	FrameFormat format;
+
+	/*
+	 * chroma is initialized with the video's native chroma.
+	 * 32-bit RGB is cairo's RGB24 format in host byte order.
+	 */
+	if (!memcmp(chroma, "I420", 4) || !memcmp(chroma, "YV12", 4)) {
+		format = FORMAT_I420;
+		memcpy(chroma, "I420", 4);
+	} else if (!memcmp(chroma, "NV12", 4)) {
+		format = FORMAT_NV12;
+	} else {
+		format = FORMAT_RV32;
+		memcpy(chroma, "RV32", 4);
+	}
+
+	g_mutex_lock(renderer->mutex);
+	renderer_free_buffers(renderer);
+	renderer_alloc_buffers(renderer, format, *width, *height);
+	for (guint p = 0; p < renderer->n_planes; p++) {
+		pitches[p] = renderer->pitches[p];
+		lines[p] = renderer->lines[p];
+	}
+	g_mutex_unlock(renderer->mutex);
+
+	/* the remaining buffers are never written while in use */
+	return VLC_PICTURES;
+}
+
+static void
+renderer_cleanup_cb(void *opaque)
+{
+	GtkVlcRenderer *renderer = opaque;
+
+	g_mutex_lock(renderer->mutex);
+	renderer_free_buffers(renderer);
+	g_mutex_unlock(renderer->mutex);
+}
+
+#endif
+
+/**
+ * @private
+ * @brief Create software renderer.
+ *
+ * @param frame_ready Function invoked (from a libVLC thread) whenever a new
+ *                    frame is ready for painting
+ * @param user_data   Data to pass to \e frame_ready
+ * @return New renderer
+ */
+GtkVlcRenderer *
+_gtk_vlc_renderer_new(GtkVlcRendererFrameFunc frame_ready, gpointer user_data)
+{
+	GtkVlcRenderer *renderer = g_new0(GtkVlcRenderer, 1);
+
+	renderer->frame_ready = frame_ready;
+	renderer->user_data = user_data;
+	renderer->mutex = g_mutex_new();
+	renderer->paint_cond = g_cond_new();
+	renderer->latest = -1;
+	renderer->kernel = _gtk_vlc_convert_get_kernel();
+
+	return renderer;
+}
+
+/**
+ * @private
+ * @brief Free software renderer.
+ *
+ * It must no longer be attached to a media player, i.e. the media player
+ * must have been released before.
+ *
+ * @param renderer Software renderer
+ */
+void
+_gtk_vlc_renderer_free(GtkVlcRenderer *renderer)
+{
+	g_mutex_lock(renderer->mutex);
+	renderer_free_buffers(renderer);
+	g_mutex_unlock(renderer->mutex);
+
+	g_free(renderer->paint_alloc);
+	g_cond_free(renderer->paint_cond);
+	g_mutex_free(renderer->mutex);
+	g_free(renderer);
+}
+
+/**
+ * @private
+ * @brief Render video of media player with software renderer.
+ *
+ * Takes effect when the media player's video output is (re)created.
+ *
+ * @param renderer     Software renderer
+ * @param media_player libVLC media player
+ */
+void
+_gtk_vlc_renderer_attach(GtkVlcRenderer *renderer,
+			 libvlc_media_player_t *media_player)
+{
+	libvlc_video_set_callbacks(media_player,
+				   renderer_lock_cb, renderer_unlock_cb,
+				   renderer_display_cb, renderer);
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2,0,0,0)
+	libvlc_video_set_format_callbacks(media_player,
+					  renderer_format_cb,
+					  renderer_cleanup_cb);
+#else
+	g_mutex_lock(renderer->mutex);
+	if (renderer->width == 0)
+		renderer_alloc_buffers(renderer, FORMAT_RV32,
+				       FALLBACK_WIDTH, FALLBACK_HEIGHT);
+	g_mutex_unlock(renderer->mutex);
+
+	libvlc_video_set_format(media_player, "RV32",
+				renderer->width, renderer->height,
+				renderer->pitches[0]);
+#endif
+}
+
+/**
+ * @private
+ * @brief Paint latest frame.
+ *
+ * The frame is scaled to fit into the given area, preserving its aspect
+ * ratio. YUV frames are converted, skipping rows that would be scaled away.
+ * Must be called on the main loop.
+ *
+ * @param renderer Software renderer
+ * @param cr       cairo context to paint on
+ * @param width    Width of area to paint
+ * @param height   Height of area to paint
+ * @return \c FALSE if there is no frame to paint
+ */
+gboolean
+_gtk_vlc_renderer_paint(GtkVlcRenderer *renderer, cairo_t *cr,
+			gint width, gint height)
+{
+	cairo_surface_t *surface;
+	gdouble scale, scale_y;
+	guint stride, rows;
+	gint i;
+
+	i = renderer_acquire_latest(renderer);
+	if (i < 0)
+		return FALSE;
+
+	/* painting does not block libVLC, which uses the other buffers */
+	scale = MIN((gdouble)width / renderer->width,
+		    (gdouble)height / renderer->height);
+	scale_y = scale;
+
+	/* horizontal scaling is left to cairo */
+	rows = renderer->height;
+	if (renderer->format != FORMAT_RV32 && scale < 1.) {
+		rows = MAX((guint)(renderer->height*scale + .5), 1);
+		scale_y = scale*renderer->height/rows;
+	}
+
+	stride = ALIGN((guint)cairo_format_stride_for_width(CAIRO_FORMAT_RGB24,
+							     (int)renderer->width));
+	if (renderer->format != FORMAT_RV32 &&
+	    (gsize)stride*rows > renderer->paint_size) {
+		g_free(renderer->paint_alloc);
+		renderer->paint_size = (gsize)stride*rows;
+		renderer->paint_buffer =
+			buffer_alloc_aligned(renderer->paint_size,
+					     &renderer->paint_alloc);
+	}
+
+	surface = renderer_get_surface(renderer, i, rows,
+				       renderer->paint_buffer, stride);
+
+	cairo_save(cr);
+	cairo_translate(cr, (width - renderer->width*scale)/2.,
+			(height - renderer->height*scale)/2.);
+	cairo_scale(cr, scale, scale_y);
+	cairo_set_source_surface(cr, surface, 0., 0.);
+	cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_BILINEAR);
+	cairo_paint(cr);
+	cairo_restore(cr);
+
+	cairo_surface_destroy(surface);
+
+	g_mutex_lock(renderer->mutex);
+	renderer->painted[i] = TRUE;
+	renderer->stats.painted++;
+	renderer_release(renderer, i);
+	g_mutex_unlock(renderer->mutex);
+
+	return TRUE;
+}
+
+/**
+ * @private
+ * @brief Take a snapshot of the latest frame.
+ *
+ * The frame is converted and scaled straight from the decoded buffer.
+ * If only one of \e width and \e height is 0, it is derived from the other
+ * one, preserving the aspect ratio. If both are 0, the frame is not scaled.
+ * May be called from any thread.
+ *
+ * @param renderer Software renderer
+ * @param width    Width of snapshot
+ * @param height   Height of snapshot
+ * @return New pixbuf (without alpha channel) or \c NULL if there is no frame
+ */
+GdkPixbuf *
+_gtk_vlc_renderer_snapshot(GtkVlcRenderer *renderer, guint width, guint height)
+{
+	GdkPixbuf *pixbuf;
+	cairo_surface_t *surface;
+	gpointer alloc = NULL;
+	guint8 *buffer = NULL, *src, *dst;
+	guint stride, rows;
+	gint src_stride, dst_stride;
+	gint i;
+
+	i = renderer_acquire_latest(renderer);
+	if (i < 0)
+		return NULL;
+
+	if (width == 0 && height == 0) {
+		width = renderer->width;
+		height = renderer->height;
+	} else if (width == 0) {
+		width = MAX((guint)((guint64)renderer->width*height/renderer->height), 1);
+	} else if (height == 0) {
+		height = MAX((guint)((guint64)renderer->height*width/renderer->width), 1);
+	}
+
+	/* like painting, but with a private buffer (any thread) */
+	rows = MIN(height, renderer->height);
+	stride = ALIGN((guint)cairo_format_stride_for_width(CAIRO_FORMAT_RGB24,
+							     (int)renderer->width));
+	if (renderer->format != FORMAT_RV32)
+		buffer = buffer_alloc_aligned((gsize)stride*rows, &alloc);
+	else
+		rows = renderer->height;
+	surface = renderer_get_surface(renderer, i, rows, buffer, stride);
+
+	if (width != renderer->width || height != rows) {
+		cairo_surface_t *scaled;
+		cairo_t *cr;
+
+		scaled = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+						    (int)width, (int)height);
+		cr = cairo_create(scaled);
+		cairo_scale(cr, (gdouble)width/renderer->width,
+			    (gdouble)height/rows);
+		cairo_set_source_surface(cr, surface, 0., 0.);
+		/* unlike painting, snapshots are usually scaled down a lot */
+		cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+		cairo_pattern_set_extend(cairo_get_source(cr), CAIRO_EXTEND_PAD);
+		cairo_paint(cr);
+		cairo_destroy(cr);
+
+		cairo_surface_destroy(surface);
+		surface = scaled;
+	}
+	cairo_surface_flush(surface);
+
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8,
+				(int)width, (int)height);
+	src = cairo_image_surface_get_data(surface);
+	src_stride = cairo_image_surface_get_stride(surface);
+	dst = gdk_pixbuf_get_pixels(pixbuf);
+	dst_stride = gdk_pixbuf_get_rowstride(pixbuf);
+
+	/* RGB24 pixels are host-endian 0x00RRGGBB words */
+	for (guint y = 0; y < height; y++) {
+		const guint32 *s = (const guint32 *)(src + y*src_stride);
+		guint8 *d = dst + y*dst_stride;
+
+		for (guint x = 0; x < width; x++) {
+			d[3*x + 0] = (guint8)(s[x] >> 16);
+			d[3*x + 1] = (guint8)(s[x] >> 8);
+			d[3*x + 2] = (guint8)s[x];
+		}
+	}
+
+	cairo_surface_destroy(surface);
+
+	g_mutex_lock(renderer->mutex);
+	renderer_release(renderer, i);
+	g_mutex_unlock(renderer->mutex);
+	g_free(alloc);
+
+	return pixbuf;
+}
+
+/**
+ * @private
+ * @brief Get frame statistics of software renderer.
+ *
+ * @param renderer Software renderer
+ * @param stats    Statistics to add the renderer's statistics to
+ */
+void
+_gtk_vlc_renderer_add_stats(GtkVlcRenderer *renderer,
+			    GtkVlcPlayerFrameStats *stats)
+{
+	g_mutex_lock(renderer->mutex);
+	stats->decoded += renderer->stats.decoded;
+	stats->painted += renderer->stats.painted;
+	stats->dropped += renderer->stats.dropped;
+	g_mutex_unlock(renderer->mutex);
+}
@@ -0,0 +1,623 @@
+/**
+ * @file
+ * Background thumbnail extraction.
+ * Thumbnails are extracted by a bounded pool of headless libVLC media
+ * players, each driving its own software renderer. Every thumbnail
+ * starts playback at the requested position using a fast (keyframe)
+ * seek, and the first frame rendered is scaled down straight from the
+ * renderer's buffers.
+ * Queued work is picked by priority, so items scrolled into view can be
+ * served first.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#ifdef HAVE_WINDOWS_H
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include <gdk/gdk.h>
+
+#include <vlc/vlc.h>
+#include <vlc/libvlc_version.h>
+
+#include "gtk-vlc-thumbnailer.h"
+#include "gtk-vlc-player-private.h"
+
+/**
+ * @private
+ * Time to wait for the first frame of a thumbnail
+ */
+#define THUMBNAIL_TIMEOUT	5000 /* milliseconds */
+/**
+ * @private
+ * Interval of checking for cancellation while waiting for a frame
+ */
+#define CANCEL_POLL_INTERVAL	100 /* milliseconds */
+
+/**
+ * @private
+ * Requests submitted together, completed when all of their jobs are done
+ */
+typedef struct {
+	GSimpleAsyncResult	*result;
+	GCancellable		*cancellable;
+	/** set when the thumbnailer is freed with the batch still queued */
+	volatile gint		aborted;
+
+	GtkVlcThumbnailFunc	thumbnail_cb;
+	gpointer		thumbnail_data;
+
+	/** number of jobs not yet done */
+	volatile gint		pending;
+} ThumbnailBatch;
+
+/**
+ * @private
+ * Thumbnails of one media file, extracted by one worker
+ */
+typedef struct {
+	ThumbnailBatch	*batch;
+
+	gchar		*file;
+	gint64		*times;
+	guint		n_times;
+	guint		width;
+	guint		height;
+
+	gint		priority;
+} ThumbnailJob;
+
+/**
+ * @private
+ * Thumbnail passed from a worker to the main loop
+ */
+typedef struct {
+	ThumbnailBatch	*batch;
+	gchar		*file;
+	gint64		time;
+	GdkPixbuf	*thumbnail;
+} ThumbnailDelivery;
+
+/**
+ * @private
+ * Headless media player, reused for many thumbnails
+ */
+typedef struct {
+	libvlc_media_player_t	*media_player;
+	GtkVlcRenderer		*renderer;
+
+	/** protects \e frames and \e failed */
+	GMutex			*mutex;
+	GCond			*cond;
+	guint			frames;
+	gboolean		failed;
+} ThumbnailWorker;
+
+struct _GtkVlcThumbnailer {
+	libvlc_instance_t	*vlc_inst;
+	/** runs one pool function per queued job */
+	GThreadPool		*pool;
+
+	/** protects all of the following */
+	GMutex			*mutex;
+	GQueue			*queue;		/**< ThumbnailJobs in submission order */
+	GSList			*idle_workers;	/**< ThumbnailWorkers */
+};
+
+static guint get_n_processors(void);
+
+static inline gboolean batch_is_cancelled(ThumbnailBatch *batch);
+static void batch_job_done(ThumbnailBatch *batch);
+static gboolean batch_deliver_cb(gpointer user_data);
+static gboolean batch_finish_cb(gpointer user_data);
+static void job_free(ThumbnailJob *job);
+
+static ThumbnailWorker *worker_new(libvlc_instance_t *vlc_inst);
+static void worker_free(ThumbnailWorker *worker);
+static void worker_frame_ready_cb(gpointer user_data);
+static void worker_event_cb(const struct libvlc_event_t *event,
+			    void *user_data);
+static GdkPixbuf *worker_extract(ThumbnailWorker *worker,
+				 libvlc_instance_t *vlc_inst,
+				 ThumbnailJob *job, gint64 time);
+
+static void thumbnailer_pool_worker(gpointer data, gpointer user_data);
+
+/**
+ * @private
+ * libVLC events ending a thumbnail without a frame
+ */
+static const libvlc_event_type_t worker_events[] = {
+	libvlc_MediaPlayerEndReached,
+	libvlc_MediaPlayerEncounteredError
+};
+
+static guint
+get_n_processors(void)
+{
+#ifdef HAVE_WINDOWS_H
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return MAX((guint)info.dwNumberOfProcessors, 1);
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (guint)n : 1;
+#else
+	return 1;
+#endif
+}
+
+static inline gboolean
+batch_is_cancelled(ThumbnailBatch *batch)
+{
+	return g_atomic_int_get(&batch->aborted) ||
+	       g_cancellable_is_cancelled(batch->cancellable);
+}
+
+/*
+ * NOTE: Deliveries of a job are queued before it is done, so the batch
+ * is finished after all of its thumbnails have been delivered.
+ */
+static void
+batch_job_done(ThumbnailBatch *batch)
+{
+	if (g_atomic_int_dec_and_test(&batch->pending))
+		gdk_threads_add_idle(batch_finish_cb, batch);
+}
+
+static gboolean
+batch_deliver_cb(gpointer user_data)
+{
+	ThumbnailDelivery *delivery = user_data;
+	ThumbnailBatch *batch = delivery->batch;
+
+	if (!batch_is_cancelled(batch) && batch->thumbnail_cb != NULL)
+		batch->thumbnail_cb(delivery->file, delivery->time,
+				    delivery->thumbnail, batch->thumbnail_data);
+
+	if (delivery->thumbnail != NULL)
+		g_object_unref(delivery->thumbnail);
+	g_free(delivery->file);
+	g_free(delivery);
+
+	return FALSE;
+}
+
+static gboolean
+batch_finish_cb(gpointer user_data)
+{
+	ThumbnailBatch *batch = user_data;
+
+	if (batch_is_cancelled(batch))
+		g_simple_async_result_set_error(batch->result,
+						G_IO_ERROR, G_IO_ERROR_CANCELLED,
+						"Thumbnail extraction was cancelled");
+	else
+		g_simple_async_result_set_op_res_gboolean(batch->result, TRUE);
+	g_simple_async_result_complete(batch->result);
+
+	g_object_unref(batch->result);
+	if (batch->cancellable != NULL)
+		g_object_unref(batch->cancellable);
+	g_free(batch);
+
+	return FALSE;
+}
+
+static void
+job_free(ThumbnailJob *job)
+{
+	g_free(job->times);
+	g_free(job->file);
+	g_free(job);
+}
+
+static ThumbnailWorker *
+worker_new(libvlc_instance_t *vlc_inst)
+{
+	ThumbnailWorker *worker = g_new0(ThumbnailWorker, 1);
+	libvlc_event_manager_t *evman;
+
+	worker->mutex = g_mutex_new();
+	worker->cond = g_cond_new();
+
+	worker->media_player = libvlc_media_player_new(vlc_inst);
+	worker->renderer = _gtk_vlc_renderer_new(worker_frame_ready_cb, worker);
+	_gtk_vlc_renderer_attach(worker->renderer, worker->media_player);
+
+	evman = libvlc_media_player_event_manager(worker->media_player);
+	for (guint i = 0; i < G_N_ELEMENTS(worker_events); i++)
+		libvlc_event_attach(evman, worker_events[i],
+				    worker_event_cb, worker);
+
+	return worker;
+}
+
+static void
+worker_free(ThumbnailWorker *worker)
+{
+	/* the renderer must outlive its media player */
+	libvlc_media_player_release(worker->media_player);
+	_gtk_vlc_renderer_free(worker->renderer);
+
+	g_cond_free(worker->cond);
+	g_mutex_free(worker->mutex);
+	g_free(worker);
+}
+
+static void
+worker_frame_ready_cb(gpointer user_data)
+{
+	ThumbnailWorker *worker = user_data;
+
+	g_mutex_lock(worker->mutex);
+	worker->frames++;
+	g_cond_signal(worker->cond);
+	g_mutex_unlock(worker->mutex);
+}
+
+static void
+worker_event_cb(const struct libvlc_event_t *event, void *user_data)
+{
+	ThumbnailWorker *worker = user_data;
+
+	g_mutex_lock(worker->mutex);
+	worker->failed = TRUE;
+	g_cond_signal(worker->cond);
+	g_mutex_unlock(worker->mutex);
+}
+
+/*
+ * Extract one thumbnail. Every thumbnail opens the media anew with a
+ * start time: unlike seeking a playing media, this makes the first frame
+ * rendered the requested one.
+ */
+static GdkPixbuf *
+worker_extract(ThumbnailWorker *worker, libvlc_instance_t *vlc_inst,
+	       ThumbnailJob *job, gint64 time)
+{
+	gchar start_time[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar *option;
+	libvlc_media_t *media;
+	GdkPixbuf *thumbnail = NULL;
+	gint64 deadline;
+	gboolean have_frame;
+
+	media = libvlc_media_new_path(vlc_inst, (const char *)job->file);
+	if (media == NULL)
+		return NULL;
+
+	/* libVLC parses option values independent of the locale */
+	g_ascii_formatd(start_time, sizeof(start_time), "%.3f", time/1000.);
+	option = g_strconcat(":start-time=", start_time, NULL);
+	libvlc_media_add_option(media, option);
+	g_free(option);
+	/* land on the preceding keyframe instead of decoding up to time */
+	libvlc_media_add_option(media, ":input-fast-seek");
+	libvlc_media_add_option(media, ":no-audio");
+
+	libvlc_media_player_set_media(worker->media_player, media);
+	libvlc_media_release(media);
+
+	g_mutex_lock(worker->mutex);
+	worker->frames = 0;
+	worker->failed = FALSE;
+	g_mutex_unlock(worker->mutex);
+
+	libvlc_media_player_play(worker->media_player);
+
+	deadline = g_get_monotonic_time() + THUMBNAIL_TIMEOUT*1000;
+
+	g_mutex_lock(worker->mutex);
+	while (worker->frames == 0 && !worker->failed &&
+	       !batch_is_cancelled(job->batch) &&
+	       g_get_monotonic_time() < deadline) {
+		GTimeVal until;
+
+		g_get_current_time(&until);
+		g_time_val_add(&until, CANCEL_POLL_INTERVAL*1000);
+		g_cond_timed_wait(worker->cond, worker->mutex, &until);
+	}
+	have_frame = worker->frames > 0;
+	g_mutex_unlock(worker->mutex);
+
+	if (have_frame)
+		thumbnail = _gtk_vlc_renderer_snapshot(worker->renderer,
+						       job->width, job->height);
+
+	/* also frees the renderer's buffers */
+	libvlc_media_player_stop(worker->media_player);
+
+	return thumbnail;
+}
+
+static void
+thumbnailer_pool_worker(gpointer data, gpointer user_data)
+{
+	GtkVlcThumbnailer *thumbnailer = user_data;
+	ThumbnailWorker *worker = NULL;
+	ThumbnailJob *job;
+	GList *best = NULL;
+
+	g_mutex_lock(thumbnailer->mutex);
+
+	/* the earliest job of the highest priority */
+	for (GList *cur = thumbnailer->queue->head; cur != NULL; cur = cur->next)
+		if (best == NULL ||
+		    ((ThumbnailJob *)cur->data)->priority <
+		    ((ThumbnailJob *)best->data)->priority)
+			best = cur;
+
+	if (best == NULL) {
+		/* dropped by gtk_vlc_thumbnailer_free() */
+		g_mutex_unlock(thumbnailer->mutex);
+		return;
+	}
+	job = best->data;
+	g_queue_delete_link(thumbnailer->queue, best);
+
+	if (thumbnailer->idle_workers != NULL) {
+		worker = thumbnailer->idle_workers->data;
+		thumbnailer->idle_workers =
+			g_slist_delete_link(thumbnailer->idle_workers,
+					    thumbnailer->idle_workers);
+	}
+
+	g_mutex_unlock(thumbnailer->mutex);
+
+	/* there are never more workers than pool threads */
+	if (worker == NULL)
+		worker = worker_new(thumbnailer->vlc_inst);
+
+	for (guint i = 0; i < job->n_times; i++) {
+		ThumbnailDelivery *delivery;
+
+		if (batch_is_cancelled(job->batch))
+			break;
+
+		delivery = g_new(ThumbnailDelivery, 1);
+		delivery->batch = job->batch;
+		delivery->file = g_strdup(job->file);
+		delivery->time = job->times[i];
+		delivery->thumbnail = worker_extract(worker,
+						     thumbnailer->vlc_inst,
+						     job, job->times[i]);
+
+		gdk_threads_add_idle(batch_deliver_cb, delivery);
+	}
+
+	g_mutex_lock(thumbnailer->mutex);
+	thumbnailer->idle_workers = g_slist_prepend(thumbnailer->idle_workers,
+						    worker);
+	g_mutex_unlock(thumbnailer->mutex);
+
+	batch_job_done(job->batch);
+	job_free(job);
+}
+
+/*
+ * API
+ */
+
+/**
+ * @brief Create a new thumbnailer
+ *
+ * Each worker owns a headless libVLC media player, which is created when
+ * the worker is first needed.
+ *
+ * @param max_workers Maximum number of thumbnails extracted in parallel,
+ *                    0 for the number of processors
+ * @return New thumbnailer, to be freed with \ref gtk_vlc_thumbnailer_free,
+ *         or \c NULL if no libVLC instance could be created
+ */
+GtkVlcThumbnailer *
+gtk_vlc_thumbnailer_new(guint max_workers)
+{
+	GtkVlcThumbnailer *thumbnailer;
+	libvlc_instance_t *vlc_inst;
+
+	vlc_inst = _gtk_vlc_instance_pool_acquire(NULL);
+	if (vlc_inst == NULL)
+		return NULL;
+
+	if (max_workers == 0)
+		max_workers = get_n_processors();
+
+	thumbnailer = g_new0(GtkVlcThumbnailer, 1);
+	thumbnailer->vlc_inst = vlc_inst;
+	thumbnailer->mutex = g_mutex_new();
+	thumbnailer->queue = g_queue_new();
+	thumbnailer->pool = g_thread_pool_new(thumbnailer_pool_worker,
+					      thumbnailer, (gint)max_workers,
+					      FALSE, NULL);
+
+	return thumbnailer;
+}
+
+/**
+ * @brief Free a thumbnailer
+ *
+ * Thumbnails being extracted are finished first. Batches that still have
+ * queued requests complete with a \c G_IO_ERROR_CANCELLED error.
+ *
+ * @param thumbnailer Thumbnailer
+ */
+void
+gtk_vlc_thumbnailer_free(GtkVlcThumbnailer *thumbnailer)
+{
+	ThumbnailJob *job;
+
+	g_mutex_lock(thumbnailer->mutex);
+	while ((job = g_queue_pop_head(thumbnailer->queue)) != NULL) {
+		g_atomic_int_set(&job->batch->aborted, TRUE);
+		batch_job_done(job->batch);
+		job_free(job);
+	}
+	g_mutex_unlock(thumbnailer->mutex);
+
+	/* remaining pool functions find the queue empty */
+	g_thread_pool_free(thumbnailer->pool, FALSE, TRUE);
+
+	g_slist_free_full(thumbnailer->idle_workers,
+			  (GDestroyNotify)worker_free);
+	g_queue_free(thumbnailer->queue);
+	g_mutex_free(thumbnailer->mutex);
+	_gtk_vlc_instance_pool_release(thumbnailer->vlc_inst);
+
+	g_free(thumbnailer);
+}
+
+/**
+ * @brief Extract thumbnails asynchronously
+ *
+ * Requests are queued and picked up by the thumbnailer's workers in order
+ * of \e priority (lower values first, like \c G_PRIORITY_DEFAULT),
+ * and in submission order among requests of the same priority.
+ * All thumbnails of one request are extracted by the same worker.
+ *
+ * Positions are approached with fast seeks, so thumbnails show the
+ * keyframe at or before the requested position.
+ * Thumbnails are delivered on the main loop as soon as they are ready.
+ * Once \e cancellable is cancelled, no more thumbnails are delivered and
+ * the operation completes with a \c G_IO_ERROR_CANCELLED error.
+ *
+ * @param thumbnailer    Thumbnailer
+ * @param requests       Array of requests (copied)
+ * @param n_requests     Number of requests
+ * @param priority       Priority of all requests
+ * @param cancellable    Optional \e GCancellable object, \c NULL to ignore
+ * @param thumbnail_cb   Callback to deliver every thumbnail to, or \c NULL
+ * @param thumbnail_data Data to pass to \e thumbnail_cb
+ * @param callback       Callback to invoke when all requests are done
+ * @param user_data      The data to pass to \e callback
+ */
+void
+gtk_vlc_thumbnailer_submit_async(GtkVlcThumbnailer *thumbnailer,
+				 const GtkVlcThumbnailRequest *requests,
+				 guint n_requests, gint priority,
+				 GCancellable *cancellable,
+				 GtkVlcThumbnailFunc thumbnail_cb,
+				 gpointer thumbnail_data,
+				 GAsyncReadyCallback callback,
+				 gpointer user_data)
+{
+	GSimpleAsyncResult *result;
+	ThumbnailBatch *batch;
+
+	result = g_simple_async_result_new(NULL, callback, user_data,
+					   gtk_vlc_thumbnailer_submit_async);
+
+	if (n_requests == 0) {
+		g_simple_async_result_set_op_res_gboolean(result, TRUE);
+		g_simple_async_result_complete_in_idle(result);
+		g_object_unref(result);
+		return;
+	}
+
+	batch = g_new0(ThumbnailBatch, 1);
+	batch->result = result;
+	batch->cancellable = cancellable != NULL ? g_object_ref(cancellable)
+						 : NULL;
+	batch->thumbnail_cb = thumbnail_cb;
+	batch->thumbnail_data = thumbnail_data;
+	batch->pending = (gint)n_requests;
+
+	for (guint i = 0; i < n_requests; i++) {
+		ThumbnailJob *job = g_new(ThumbnailJob, 1);
+
+		job->batch = batch;
+		job->file = g_strdup(requests[i].file);
+		job->times = g_memdup(requests[i].times,
+				      requests[i].n_times*sizeof(gint64));
+		job->n_times = requests[i].n_times;
+		job->width = requests[i].width;
+		job->height = requests[i].height;
+		job->priority = priority;
+
+		g_mutex_lock(thumbnailer->mutex);
+		g_queue_push_tail(thumbnailer->queue, job);
+		g_mutex_unlock(thumbnailer->mutex);
+
+		/* the pool function picks the most urgent job, not this one */
+		g_thread_pool_push(thumbnailer->pool, thumbnailer, NULL);
+	}
+}
+
+/**
+ * @brief Finish extraction started with \ref gtk_vlc_thumbnailer_submit_async
+ *
+ * @param thumbnailer Thumbnailer
+ * @param result      \e GAsyncResult passed to the callback
+ * @param error       Return location for a \e GError, or \c NULL
+ * @return \c TRUE if all requests were processed (individual thumbnails
+ *         may still have failed), \c FALSE on cancellation
+ */
+gboolean
+gtk_vlc_thumbnailer_submit_finish(GtkVlcThumbnailer *thumbnailer,
+				  GAsyncResult *result, GError **error)
+{
+	GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT(result);
+
+	if (g_simple_async_result_propagate_error(simple, error))
+		return FALSE;
+
+	return g_simple_async_result_get_op_res_gboolean(simple);
+}
+
+/**
+ * @brief Change the priority of queued requests for a media file
+ *
+ * This is typically used to extract thumbnails of items that have been
+ * scrolled into view first. Requests already being processed are not
+ * affected.
+ *
+ * @param thumbnailer Thumbnailer
+ * @param file        Filename of media
+ * @param priority    New priority
+ */
+void
+gtk_vlc_thumbnailer_set_priority(GtkVlcThumbnailer *thumbnailer,
+				 const gchar *file, gint priority)
+{
+	g_mutex_lock(thumbnailer->mutex);
+
+	for (GList *cur = thumbnailer->queue->head; cur != NULL; cur = cur->next) {
+		ThumbnailJob *job = cur->data;
+
+		if (!strcmp(job->file, file))
+			job->priority = priority;
+	}
+
+	g_mutex_unlock(thumbnailer->mutex);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file
+ * Header file for GtkVlcThumbnailer, a service extracting thumbnails of
+ * media files in the background.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_VLC_THUMBNAILER_H
+#define __GTK_VLC_THUMBNAILER_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Thumbnails to extract from one media file
+ */
+typedef struct {
+	const gchar	*file;		/**< Filename of media */
+	const gint64	*times;		/**< Positions (milliseconds) */
+	guint		n_times;	/**< Number of positions */
+
+	guint		width;		/**< Width (0 to derive from height) */
+	guint		height;		/**< Height (0 to derive from width) */
+} GtkVlcThumbnailRequest;
+
+/**
+ * Callback delivering a thumbnail
+ *
+ * @param file      Filename of media
+ * @param time      Requested position (milliseconds)
+ * @param thumbnail Thumbnail or \c NULL if it could not be extracted.
+ *                  It is unreferenced after the callback returns.
+ * @param user_data User data passed when submitting the request
+ */
+typedef void (*GtkVlcThumbnailFunc)(const gchar *file, gint64 time,
+				    GdkPixbuf *thumbnail, gpointer user_data);
+
+/**
+ * Opaque thumbnailer structure
+ */
+typedef struct _GtkVlcThumbnailer GtkVlcThumbnailer;
+
+GtkVlcThumbnailer *gtk_vlc_thumbnailer_new(guint max_workers);
+void gtk_vlc_thumbnailer_free(GtkVlcThumbnailer *thumbnailer);
+
+void gtk_vlc_thumbnailer_submit_async(GtkVlcThumbnailer *thumbnailer,
+				      const GtkVlcThumbnailRequest *requests,
+				      guint n_requests, gint priority,
+				      GCancellable *cancellable,
+				      GtkVlcThumbnailFunc thumbnail_cb,
+				      gpointer thumbnail_data,
+				      GAsyncReadyCallback callback,
+				      gpointer user_data);
+gboolean gtk_vlc_thumbnailer_submit_finish(GtkVlcThumbnailer *thumbnailer,
+					   GAsyncResult *result,
+					   GError **error);
+
+void gtk_vlc_thumbnailer_set_priority(GtkVlcThumbnailer *thumbnailer,
+				      const gchar *file, gint priority);
+
+G_END_DECLS
+
+#endif
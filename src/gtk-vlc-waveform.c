@@ -0,0 +1,765 @@
+/**
+ * @file
+ * Audio waveform overviews of media files.
+ * The audio track is decoded faster than real time by a headless libVLC
+ * media player on a background worker pool and reduced to min/max buckets.
+ * Coarser levels (each halving the resolution, like a mipmap) are derived
+ * from the finest one, so drawing at any zoom level only touches about as
+ * many buckets as pixels. Finished waveforms are stored in compact cache
+ * files keyed by path, size and modification time.
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <gdk/gdk.h>
+
+#include <vlc/vlc.h>
+#include <vlc/libvlc_version.h>
+
+#include "gtk-vlc-waveform.h"
+#include "gtk-vlc-player-private.h"
+
+/** @private */
+#define WAVEFORM_MAGIC		"GVLCWAV"
+/** @private */
+#define WAVEFORM_VERSION	1
+/** @private */
+#define WAVEFORM_BYTE_ORDER	0x01020304
+
+/**
+ * @private
+ * Audio is down-mixed to mono and resampled to this rate for analysis
+ */
+#define WAVEFORM_SAMPLE_RATE	8000 /* Hz */
+/** @private */
+#define WAVEFORM_BUCKET_SAMPLES	80 /* 10 ms at WAVEFORM_SAMPLE_RATE */
+
+/** @private */
+#define BUILD_MAX_WORKERS	2
+/** @private */
+#define PROGRESS_INTERVAL	100 /* milliseconds */
+
+/**
+ * @private
+ * Header of a waveform cache file.
+ * It is followed by \e n_buckets (min, max) pairs of the finest level.
+ * All values are in host byte order, which is verified by \e byte_order.
+ */
+typedef struct {
+	gchar	magic[8];
+	guint32	version;
+	guint32	byte_order;
+
+	gint64	size;		/**< Size of media file */
+	gint64	mtime;		/**< Modification time of media file */
+
+	gint64	duration;	/**< Media duration (milliseconds) */
+	guint32	sample_rate;
+	guint32	bucket_samples;
+	guint32	n_buckets;
+	guint32	reserved;
+} WaveformHeader;
+
+struct _GtkVlcWaveform {
+	gint64	duration;
+	/** Duration of a bucket in the finest level (milliseconds) */
+	gdouble	bucket_duration;
+
+	guint	n_levels;
+	guint	*n_buckets;	/**< per level */
+	gint8	**levels;	/**< interleaved (min, max) pairs per level */
+};
+
+/**
+ * @private
+ * Background build of a waveform.
+ * It is freed on the main loop after the result has been delivered.
+ */
+typedef struct {
+	gchar				*file;
+	gchar				*cache_dir;
+	GSimpleAsyncResult		*result;
+	GCancellable			*cancellable;
+
+	GtkVlcWaveformProgressFunc	progress;
+	gpointer			progress_data;
+	guint				progress_id;
+	gint				progress_reported;
+	/** Written by the decoder, read by the progress timeout */
+	volatile gint			progress_permille;
+
+	/*
+	 * Decoder state, only accessed by libVLC's stream output thread
+	 * while decoding
+	 */
+	gint64		duration;
+	guint		sample_rate;
+	guint8		*pcm;
+	gsize		pcm_size;
+	GByteArray	*buckets;
+	gint		bucket_min, bucket_max;
+	guint		bucket_fill;
+
+	/** protects \e done and \e failed */
+	GMutex		*mutex;
+	GCond		*cond;
+	gboolean	done;
+	gboolean	failed;
+
+	GtkVlcWaveform	*waveform;
+	GError		*error;
+} BuildJob;
+
+static gboolean stat_file(const gchar *file, gint64 *size, gint64 *mtime);
+static gchar *cache_filename(const gchar *file, const gchar *cache_dir);
+static void cache_save(BuildJob *job, gint64 size, gint64 mtime);
+static GtkVlcWaveform *waveform_new(const gint8 *buckets, guint n_buckets,
+				    gint64 duration, gdouble bucket_duration);
+
+static void smem_prerender_cb(void *data, uint8_t **buffer, size_t size);
+static void smem_postrender_cb(void *data, uint8_t *buffer,
+			       unsigned int channels, unsigned int rate,
+			       unsigned int nb_samples,
+			       unsigned int bits_per_sample,
+			       size_t size, int64_t pts);
+static void build_event_cb(const struct libvlc_event_t *event,
+			   void *user_data);
+static void build_decode(BuildJob *job);
+static void build_pool_worker(gpointer data, gpointer user_data);
+static gboolean build_progress_cb(gpointer user_data);
+static gboolean build_finish_cb(gpointer user_data);
+
+/** @private */
+static GThreadPool *build_pool = NULL;
+/** @private */
+static gsize build_pool_initialized = 0;
+
+static gboolean
+stat_file(const gchar *file, gint64 *size, gint64 *mtime)
+{
+	GStatBuf st;
+
+	if (g_stat(file, &st))
+		return FALSE;
+
+	*size = (gint64)st.st_size;
+	*mtime = (gint64)st.st_mtime;
+	return TRUE;
+}
+
+static gchar *
+cache_filename(const gchar *file, const gchar *cache_dir)
+{
+	gchar *checksum, *basename, *ret;
+
+	checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, file, -1);
+	basename = g_strconcat(checksum, ".waveform", NULL);
+	ret = g_build_filename(cache_dir, basename, NULL);
+
+	g_free(basename);
+	g_free(checksum);
+	return ret;
+}
+
+static void
+cache_save(BuildJob *job, gint64 size, gint64 mtime)
+{
+	WaveformHeader header;
+	GByteArray *contents;
+	gchar *filename;
+	GError *error = NULL;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, WAVEFORM_MAGIC, sizeof(header.magic));
+	header.version = WAVEFORM_VERSION;
+	header.byte_order = WAVEFORM_BYTE_ORDER;
+	header.size = size;
+	header.mtime = mtime;
+	header.duration = job->duration;
+	header.sample_rate = job->sample_rate;
+	header.bucket_samples = WAVEFORM_BUCKET_SAMPLES;
+	header.n_buckets = job->buckets->len/2;
+
+	contents = g_byte_array_sized_new(sizeof(header) + job->buckets->len);
+	g_byte_array_append(contents, (const guint8 *)&header, sizeof(header));
+	g_byte_array_append(contents, job->buckets->data, job->buckets->len);
+
+	filename = cache_filename(job->file, job->cache_dir);
+	g_mkdir_with_parents(job->cache_dir, 0755);
+	if (!g_file_set_contents(filename, (const gchar *)contents->data,
+				 (gssize)contents->len, &error)) {
+		g_warning("Cannot save waveform cache \"%s\": %s",
+			  filename, error->message);
+		g_error_free(error);
+	}
+
+	g_free(filename);
+	g_byte_array_free(contents, TRUE);
+}
+
+static GtkVlcWaveform *
+waveform_new(const gint8 *buckets, guint n_buckets, gint64 duration,
+	     gdouble bucket_duration)
+{
+	GtkVlcWaveform *waveform = g_new(GtkVlcWaveform, 1);
+
+	waveform->duration = duration;
+	waveform->bucket_duration = bucket_duration;
+
+	waveform->n_levels = 1;
+	for (guint n = n_buckets; n > 1; n = (n + 1)/2)
+		waveform->n_levels++;
+	waveform->n_buckets = g_new(guint, waveform->n_levels);
+	waveform->levels = g_new(gint8 *, waveform->n_levels);
+
+	waveform->n_buckets[0] = n_buckets;
+	waveform->levels[0] = g_memdup(buckets, n_buckets*2);
+
+	for (guint l = 1; l < waveform->n_levels; l++) {
+		const gint8 *prev = waveform->levels[l-1];
+		guint n_prev = waveform->n_buckets[l-1];
+		guint n = (n_prev + 1)/2;
+		gint8 *level = g_new(gint8, n*2);
+
+		for (guint i = 0; i < n; i++) {
+			const gint8 *a = prev + 4*i;
+			const gint8 *b = 2*i + 1 < n_prev ? a + 2 : a;
+
+			level[2*i] = MIN(a[0], b[0]);
+			level[2*i + 1] = MAX(a[1], b[1]);
+		}
+
+		waveform->n_buckets[l] = n;
+		waveform->levels[l] = level;
+	}
+
+	return waveform;
+}
+
+/*
+ * libVLC stream output callbacks, invoked by the smem module.
+ * Since the stream output is not synchronized to the clock,
+ * media is decoded as fast as possible.
+ */
+static void
+smem_prerender_cb(void *data, uint8_t **buffer, size_t size)
+{
+	BuildJob *job = data;
+
+	if (size > job->pcm_size) {
+		job->pcm = g_realloc(job->pcm, size);
+		job->pcm_size = size;
+	}
+	*buffer = job->pcm;
+}
+
+static void
+smem_postrender_cb(void *data, uint8_t *buffer, unsigned int channels,
+		   unsigned int rate, unsigned int nb_samples,
+		   unsigned int bits_per_sample, size_t size, int64_t pts)
+{
+	BuildJob *job = data;
+	const gint16 *samples = (const gint16 *)buffer;
+
+	if (bits_per_sample != 16 || channels == 0)
+		return;
+	job->sample_rate = rate;
+
+	for (guint i = 0; i < nb_samples; i++) {
+		for (guint c = 0; c < channels; c++) {
+			gint v = GINT16_FROM_LE(samples[i*channels + c]);
+
+			job->bucket_min = MIN(job->bucket_min, v);
+			job->bucket_max = MAX(job->bucket_max, v);
+		}
+
+		if (++job->bucket_fill == WAVEFORM_BUCKET_SAMPLES) {
+			gint8 bucket[2] = {job->bucket_min >> 8,
+					   job->bucket_max >> 8};
+
+			g_byte_array_append(job->buckets, (const guint8 *)bucket, 2);
+			job->bucket_min = G_MAXINT16;
+			job->bucket_max = G_MININT16;
+			job->bucket_fill = 0;
+		}
+	}
+
+	if (job->duration > 0)
+		g_atomic_int_set(&job->progress_permille,
+				 (gint)CLAMP(pts/job->duration, 0, 1000));
+}
+
+static void
+build_event_cb(const struct libvlc_event_t *event, void *user_data)
+{
+	BuildJob *job = user_data;
+
+	g_mutex_lock(job->mutex);
+	job->done = TRUE;
+	job->failed = event->type == libvlc_MediaPlayerEncounteredError;
+	g_cond_signal(job->cond);
+	g_mutex_unlock(job->mutex);
+}
+
+static void
+build_decode(BuildJob *job)
+{
+	static const libvlc_event_type_t events[] = {
+		libvlc_MediaPlayerEndReached,
+		libvlc_MediaPlayerEncounteredError
+	};
+
+	libvlc_instance_t *vlc_inst;
+	libvlc_media_t *media;
+	libvlc_media_player_t *media_player;
+	libvlc_event_manager_t *evman;
+	gint64 size, mtime;
+	gchar *sout;
+	gboolean cancelled;
+
+	if (!stat_file(job->file, &size, &mtime)) {
+		job->error = g_error_new(G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+					 "Cannot access \"%s\"", job->file);
+		return;
+	}
+
+	vlc_inst = _gtk_vlc_instance_pool_acquire(NULL);
+	if (vlc_inst == NULL) {
+		job->error = g_error_new(G_IO_ERROR, G_IO_ERROR_FAILED,
+					 "Cannot create libVLC instance");
+		return;
+	}
+
+	media = libvlc_media_new_path(vlc_inst, (const char *)job->file);
+	if (media == NULL) {
+		_gtk_vlc_instance_pool_release(vlc_inst);
+		job->error = g_error_new(G_IO_ERROR, G_IO_ERROR_FAILED,
+					 "Cannot create media for \"%s\"",
+					 job->file);
+		return;
+	}
+	libvlc_media_parse(media);
+	job->duration = (gint64)libvlc_media_get_duration(media);
+
+	sout = g_strdup_printf(":sout=#transcode{acodec=s16l,channels=1,"
+			       "samplerate=%d}:smem{"
+			       "audio-prerender-callback=%" G_GINT64_FORMAT ","
+			       "audio-postrender-callback=%" G_GINT64_FORMAT ","
+			       "audio-data=%" G_GINT64_FORMAT ",time-sync=false}",
+			       WAVEFORM_SAMPLE_RATE,
+			       (gint64)(gintptr)smem_prerender_cb,
+			       (gint64)(gintptr)smem_postrender_cb,
+			       (gint64)(gintptr)job);
+	libvlc_media_add_option(media, sout);
+	g_free(sout);
+	libvlc_media_add_option(media, ":no-sout-video");
+	libvlc_media_add_option(media, ":no-sout-spu");
+
+	media_player = libvlc_media_player_new_from_media(media);
+	evman = libvlc_media_player_event_manager(media_player);
+	for (guint i = 0; i < G_N_ELEMENTS(events); i++)
+		libvlc_event_attach(evman, events[i], build_event_cb, job);
+
+	libvlc_media_player_play(media_player);
+
+	g_mutex_lock(job->mutex);
+	while (!job->done && !g_cancellable_is_cancelled(job->cancellable)) {
+		GTimeVal until;
+
+		g_get_current_time(&until);
+		g_time_val_add(&until, PROGRESS_INTERVAL*1000);
+		g_cond_timed_wait(job->cond, job->mutex, &until);
+	}
+	cancelled = !job->done;
+	g_mutex_unlock(job->mutex);
+
+	/* no callbacks are invoked after stopping */
+	libvlc_media_player_stop(media_player);
+	for (guint i = 0; i < G_N_ELEMENTS(events); i++)
+		libvlc_event_detach(evman, events[i], build_event_cb, job);
+	libvlc_media_player_release(media_player);
+	libvlc_media_release(media);
+	_gtk_vlc_instance_pool_release(vlc_inst);
+
+	if (cancelled) {
+		job->error = g_error_new(G_IO_ERROR, G_IO_ERROR_CANCELLED,
+					 "Building waveform was cancelled");
+		return;
+	}
+	if (job->failed || job->sample_rate == 0) {
+		job->error = g_error_new(G_IO_ERROR, G_IO_ERROR_FAILED,
+					 "Cannot decode audio of \"%s\"",
+					 job->file);
+		return;
+	}
+
+	/* partial last bucket */
+	if (job->bucket_fill > 0) {
+		gint8 bucket[2] = {job->bucket_min >> 8, job->bucket_max >> 8};
+
+		g_byte_array_append(job->buckets, (const guint8 *)bucket, 2);
+	}
+
+	job->waveform = waveform_new((const gint8 *)job->buckets->data,
+				     job->buckets->len/2, job->duration,
+				     WAVEFORM_BUCKET_SAMPLES*1000./job->sample_rate);
+	if (job->cache_dir != NULL)
+		cache_save(job, size, mtime);
+}
+
+static void
+build_pool_worker(gpointer data, gpointer user_data)
+{
+	BuildJob *job = data;
+
+	build_decode(job);
+	gdk_threads_add_idle(build_finish_cb, job);
+}
+
+static gboolean
+build_progress_cb(gpointer user_data)
+{
+	BuildJob *job = user_data;
+	gint permille = g_atomic_int_get(&job->progress_permille);
+
+	if (permille != job->progress_reported) {
+		job->progress_reported = permille;
+		job->progress(permille/1000., job->progress_data);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+build_finish_cb(gpointer user_data)
+{
+	BuildJob *job = user_data;
+
+	if (job->progress_id != 0) {
+		g_source_remove(job->progress_id);
+		if (job->waveform != NULL && job->progress_reported != 1000)
+			job->progress(1., job->progress_data);
+	}
+
+	if (job->waveform != NULL) {
+		g_simple_async_result_set_op_res_gpointer(job->result,
+							  job->waveform, NULL);
+	} else {
+		g_simple_async_result_set_from_error(job->result, job->error);
+		g_error_free(job->error);
+	}
+	g_simple_async_result_complete(job->result);
+
+	g_object_unref(job->result);
+	if (job->cancellable != NULL)
+		g_object_unref(job->cancellable);
+	g_byte_array_free(job->buckets, TRUE);
+	g_free(job->pcm);
+	g_mutex_free(job->mutex);
+	g_cond_free(job->cond);
+	g_free(job->cache_dir);
+	g_free(job->file);
+	g_free(job);
+
+	return FALSE;
+}
+
+/*
+ * API
+ */
+
+/**
+ * @brief Look up a cached waveform
+ *
+ * The cache entry is only used when it is fresh, i.e. when size and
+ * modification time of \e file have not changed since it was analysed.
+ * This function is thread-safe.
+ *
+ * @param file      Filename of media
+ * @param cache_dir Directory of waveform cache files
+ * @return Waveform, to be freed with \ref gtk_vlc_waveform_free,
+ *         or \c NULL if there is no fresh cache entry
+ */
+GtkVlcWaveform *
+gtk_vlc_waveform_lookup(const gchar *file, const gchar *cache_dir)
+{
+	GtkVlcWaveform *waveform = NULL;
+	const WaveformHeader *header;
+	GMappedFile *mapped;
+	gchar *filename;
+	gint64 size, mtime;
+	gsize length;
+
+	if (cache_dir == NULL || !stat_file(file, &size, &mtime))
+		return NULL;
+
+	filename = cache_filename(file, cache_dir);
+	mapped = g_mapped_file_new(filename, FALSE, NULL);
+	g_free(filename);
+	if (mapped == NULL)
+		return NULL;
+
+	length = g_mapped_file_get_length(mapped);
+	header = (const WaveformHeader *)g_mapped_file_get_contents(mapped);
+
+	if (length >= sizeof(WaveformHeader) &&
+	    !memcmp(header->magic, WAVEFORM_MAGIC, sizeof(header->magic)) &&
+	    header->version == WAVEFORM_VERSION &&
+	    header->byte_order == WAVEFORM_BYTE_ORDER &&
+	    header->size == size && header->mtime == mtime &&
+	    header->sample_rate > 0 &&
+	    length >= sizeof(WaveformHeader) + (gsize)header->n_buckets*2)
+		waveform = waveform_new((const gint8 *)(header + 1),
+					header->n_buckets, header->duration,
+					header->bucket_samples*1000. /
+					header->sample_rate);
+
+	g_mapped_file_unref(mapped);
+	return waveform;
+}
+
+/**
+ * @brief Build waveform overview of a media file in the background
+ *
+ * If there is a fresh cache entry for \e file, it is used immediately.
+ * Otherwise the first audio track is decoded faster than real time by a
+ * headless libVLC media player on a worker pool of bounded size.
+ * The waveform is saved to \e cache_dir, so it is available immediately
+ * next time.
+ *
+ * \e progress is invoked on the main loop (with the Gdk lock held)
+ * while decoding, at most every 100 milliseconds.
+ * \e callback is invoked on the main loop when the waveform is complete.
+ *
+ * @param file          Filename of media
+ * @param cache_dir     Directory of waveform cache files, \c NULL to
+ *                      disable caching
+ * @param cancellable   Optional \e GCancellable object, \c NULL to ignore
+ * @param progress      Callback to report progress with, or \c NULL
+ * @param progress_data Data to pass to \e progress
+ * @param callback      Callback to invoke when the request is satisfied
+ * @param user_data     The data to pass to \e callback
+ */
+void
+gtk_vlc_waveform_build_async(const gchar *file, const gchar *cache_dir,
+			     GCancellable *cancellable,
+			     GtkVlcWaveformProgressFunc progress,
+			     gpointer progress_data,
+			     GAsyncReadyCallback callback, gpointer user_data)
+{
+	GSimpleAsyncResult *result;
+	GtkVlcWaveform *cached;
+	BuildJob *job;
+
+	result = g_simple_async_result_new(NULL, callback, user_data,
+					   gtk_vlc_waveform_build_async);
+
+	cached = gtk_vlc_waveform_lookup(file, cache_dir);
+	if (cached != NULL) {
+		g_simple_async_result_set_op_res_gpointer(result, cached, NULL);
+		g_simple_async_result_complete_in_idle(result);
+		g_object_unref(result);
+		return;
+	}
+
+	job = g_new0(BuildJob, 1);
+	job->file = g_strdup(file);
+	job->cache_dir = g_strdup(cache_dir);
+	job->result = result;
+	job->cancellable = cancellable != NULL ? g_object_ref(cancellable)
+					       : NULL;
+
+	job->progress = progress;
+	job->progress_data = progress_data;
+	if (progress != NULL)
+		job->progress_id = gdk_threads_add_timeout(PROGRESS_INTERVAL,
+							   build_progress_cb,
+							   job);
+
+	job->buckets = g_byte_array_new();
+	job->bucket_min = G_MAXINT16;
+	job->bucket_max = G_MININT16;
+
+	job->mutex = g_mutex_new();
+	job->cond = g_cond_new();
+
+	if (g_once_init_enter(&build_pool_initialized)) {
+		build_pool = g_thread_pool_new(build_pool_worker, NULL,
+					       BUILD_MAX_WORKERS, FALSE, NULL);
+		g_once_init_leave(&build_pool_initialized, 1);
+	}
+	g_thread_pool_push(build_pool, job, NULL);
+}
+
+/**
+ * @brief Finish building started with \ref gtk_vlc_waveform_build_async
+ *
+ * @param result \e GAsyncResult passed to the callback
+ * @param error  Return location for a \e GError, or \c NULL
+ * @return Waveform, to be freed with \ref gtk_vlc_waveform_free,
+ *         or \c NULL on error or cancellation
+ */
+GtkVlcWaveform *
+gtk_vlc_waveform_build_finish(GAsyncResult *result, GError **error)
+{
+	GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT(result);
+
+	if (g_simple_async_result_propagate_error(simple, error))
+		return NULL;
+
+	return g_simple_async_result_get_op_res_gpointer(simple);
+}
+
+/**
+ * @brief Free waveform
+ *
+ * @param waveform Waveform
+ */
+void
+gtk_vlc_waveform_free(GtkVlcWaveform *waveform)
+{
+	for (guint l = 0; l < waveform->n_levels; l++)
+		g_free(waveform->levels[l]);
+	g_free(waveform->levels);
+	g_free(waveform->n_buckets);
+
+	g_free(waveform);
+}
+
+/**
+ * @brief Get duration of waveform's media
+ *
+ * @param waveform Waveform
+ * @return Duration in milliseconds (may be -1 if libVLC could not
+ *         determine it)
+ */
+gint64
+gtk_vlc_waveform_get_duration(const GtkVlcWaveform *waveform)
+{
+	return waveform->duration;
+}
+
+/**
+ * @brief Get number of resolution levels of waveform
+ *
+ * Level 0 is the finest level, every following level has half the
+ * resolution of the previous one. The last level has a single bucket.
+ *
+ * @param waveform Waveform
+ * @return Number of levels
+ */
+guint
+gtk_vlc_waveform_get_n_levels(const GtkVlcWaveform *waveform)
+{
+	return waveform->n_levels;
+}
+
+/**
+ * @brief Get buckets of a resolution level of the waveform
+ *
+ * Each bucket is a pair of the minimum and maximum sample value
+ * (-128 to 127) of the audio during the bucket's duration.
+ *
+ * @param waveform        Waveform
+ * @param level           Level (0 is the finest)
+ * @param n_buckets       Location to store number of buckets in
+ * @param bucket_duration Location to store the duration of a bucket
+ *                        (milliseconds) in, or \c NULL
+ * @return Array of (min, max) pairs, owned by \e waveform
+ */
+const gint8 *
+gtk_vlc_waveform_get_level(const GtkVlcWaveform *waveform, guint level,
+			   guint *n_buckets, gdouble *bucket_duration)
+{
+	g_return_val_if_fail(level < waveform->n_levels, NULL);
+
+	*n_buckets = waveform->n_buckets[level];
+	if (bucket_duration != NULL)
+		*bucket_duration = waveform->bucket_duration*(1 << level);
+
+	return waveform->levels[level];
+}
+
+/**
+ * @brief Reduce a range of the waveform for drawing
+ *
+ * The range is divided into \e n_buckets equally long buckets, e.g. one per
+ * pixel. Each is reduced from the coarsest level that still has at least
+ * one bucket per output bucket, so this is cheap at any zoom level.
+ * Values are scaled to -1.0 to 1.0.
+ *
+ * @param waveform  Waveform
+ * @param start     Start of range (milliseconds)
+ * @param end       End of range (milliseconds)
+ * @param n_buckets Number of buckets to compute
+ * @param min       Array of \e n_buckets to store minimums in
+ * @param max       Array of \e n_buckets to store maximums in
+ * @return Number of buckets computed. Buckets beyond the end of media
+ *         are not computed.
+ */
+guint
+gtk_vlc_waveform_get_range(const GtkVlcWaveform *waveform,
+			   gint64 start, gint64 end, guint n_buckets,
+			   gfloat *min, gfloat *max)
+{
+	gdouble span, duration;
+	const gint8 *level;
+	guint l = 0, n;
+
+	if (n_buckets == 0 || end <= start)
+		return 0;
+	span = (gdouble)(end - start)/n_buckets;
+
+	while (l + 1 < waveform->n_levels &&
+	       waveform->bucket_duration*(2 << l) <= span)
+		l++;
+	level = waveform->levels[l];
+	n = waveform->n_buckets[l];
+	duration = waveform->bucket_duration*(1 << l);
+
+	for (guint i = 0; i < n_buckets; i++) {
+		guint first = (guint)MAX((start + i*span)/duration, 0.);
+		guint last = (guint)MAX((start + (i + 1)*span)/duration, 0.);
+		gint8 lo = G_MAXINT8, hi = G_MININT8;
+
+		if (first >= n)
+			return i;
+		last = CLAMP(last, first + 1, n);
+
+		for (guint b = first; b < last; b++) {
+			lo = MIN(lo, level[2*b]);
+			hi = MAX(hi, level[2*b + 1]);
+		}
+
+		min[i] = lo/128.f;
+		max[i] = hi/128.f;
+	}
+
+	return n_buckets;
+}
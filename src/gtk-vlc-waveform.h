@@ -0,0 +1,71 @@
+/**
+ * @file
+ * Header file for GtkVlcWaveform, audio waveform overviews of media files
+ * (e.g. to be drawn behind a seek slider).
+ */
+
+/*
+ * Copyright (C) 2012-2013 Otto-von-Guericke-Universität Magdeburg
+ * Copyright (C) 2013 Robin Haberkorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_VLC_WAVEFORM_H
+#define __GTK_VLC_WAVEFORM_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Opaque waveform overview structure
+ */
+typedef struct _GtkVlcWaveform GtkVlcWaveform;
+
+/**
+ * Callback reporting the progress of building a waveform
+ *
+ * @param fraction  Fraction of the media analysed so far (0.0 to 1.0)
+ * @param user_data User data passed when building the waveform
+ */
+typedef void (*GtkVlcWaveformProgressFunc)(gdouble fraction, gpointer user_data);
+
+GtkVlcWaveform *gtk_vlc_waveform_lookup(const gchar *file,
+					const gchar *cache_dir);
+
+void gtk_vlc_waveform_build_async(const gchar *file, const gchar *cache_dir,
+				  GCancellable *cancellable,
+				  GtkVlcWaveformProgressFunc progress,
+				  gpointer progress_data,
+				  GAsyncReadyCallback callback,
+				  gpointer user_data);
+GtkVlcWaveform *gtk_vlc_waveform_build_finish(GAsyncResult *result,
+					      GError **error);
+
+void gtk_vlc_waveform_free(GtkVlcWaveform *waveform);
+
+gint64 gtk_vlc_waveform_get_duration(const GtkVlcWaveform *waveform);
+guint gtk_vlc_waveform_get_n_levels(const GtkVlcWaveform *waveform);
+const gint8 *gtk_vlc_waveform_get_level(const GtkVlcWaveform *waveform,
+					guint level, guint *n_buckets,
+					gdouble *bucket_duration);
+guint gtk_vlc_waveform_get_range(const GtkVlcWaveform *waveform,
+				 gint64 start, gint64 end, guint n_buckets,
+				 gfloat *min, gfloat *max);
+
+G_END_DECLS
+
+#endif